@@ -0,0 +1,432 @@
+#include "archive.hpp"
+#include "buffer.hpp"
+#include "region.hpp"
+#include "xxhash/xxh3.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+namespace
+{
+    uint64_t blockHash(const uint8_t *data, size_t size)
+    {
+        return XXH3_64bits(data, size);
+    }
+
+    // 源文件块摘要中 FILTER 位对应的名称，并清空位以便按本文件的名表重新置位；
+    // 溢出位对应第 kFilterOverflowBit 个及以后的全部名称，映射后只会多置位，块摘要仍然保守
+    std::vector<std::string> sourceFilters(const GscIndex &source, BlockIndexEntry &e)
+    {
+        std::vector<std::string> filters;
+        for (size_t f = 0; f < source.filters.size(); ++f)
+        {
+            if (e.zone.filterMask & filterBit(static_cast<uint32_t>(f)))
+            {
+                filters.push_back(source.filters[f]);
+            }
+        }
+        e.zone.filterMask = 0;
+        return filters;
+    }
+
+    uint64_t doubleBits(double v)
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &v, sizeof(bits));
+        return bits;
+    }
+
+    double bitsDouble(uint64_t bits)
+    {
+        double v = 0;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+}
+
+void checkOutputNotInput(const std::vector<std::string> &inputFiles, const std::string &outputFile)
+{
+    for (const std::string &input : inputFiles)
+    {
+        std::error_code err;
+        if (std::filesystem::equivalent(input, outputFile, err))
+        {
+            throw std::runtime_error("Output file must differ from input " + input + ": " + outputFile);
+        }
+    }
+}
+
+GscWriter::GscWriter(const std::string &path, const VcfHeader &header, const CodecParams &codec)
+    : GscWriter(path, header.text(), codec)
+{
+}
+
+GscWriter::GscWriter(const std::string &path, const std::string &text, const CodecParams &codec)
+    : path(path), tmpPath(path + ".tmp"), out(tmpPath, std::ios::binary)
+{
+    if (!out.is_open())
+    {
+        throw std::runtime_error("Failed to open output file: " + tmpPath);
+    }
+    // 先写占位文件头，close() 时回填
+    std::vector<uint8_t> placeholder(kGscHeaderSize, 0);
+    out.write(reinterpret_cast<const char *>(placeholder.data()), placeholder.size());
+
+    Codec used = Codec::Store;
+    std::vector<uint8_t> packed = compressStream(codec, reinterpret_cast<const uint8_t *>(text.data()), text.size(), used);
+    ByteWriter w;
+    w.putU8(static_cast<uint8_t>(used));
+    w.putVarint(text.size());
+    w.putVarint(packed.size());
+    w.putBytes(packed.data(), packed.size());
+    out.write(reinterpret_cast<const char *>(w.data.data()), w.size());
+    offset = kGscHeaderSize + w.size();
+}
+
+GscWriter::~GscWriter()
+{
+    // 未成功 close() 即析构（写出中途抛异常）时不补写索引，只删除临时文件，不留下半成品
+    if (!closed)
+    {
+        out.close();
+        std::error_code err;
+        std::filesystem::remove(tmpPath, err);
+    }
+}
+
+void GscWriter::writeBlock(const EncodedBlock &block)
+{
+    BlockIndexEntry e;
+    e.nRows = block.nRows;
+    e.minPos = block.minPos;
+    e.maxPos = block.maxPos;
+    e.zone = block.zone;
+    append(block.bytes, e, block.chrom, block.filters, block.ids);
+}
+
+void GscWriter::writeBlock(const std::vector<uint8_t> &bytes, const GscIndex &source, size_t i,
+                           const std::vector<std::pair<uint64_t, uint32_t>> &ids)
+{
+    BlockIndexEntry e = source.blocks.at(i);
+    std::vector<std::string> filters = sourceFilters(source, e);
+    append(bytes, e, source.chroms.at(e.chromId), filters, ids);
+}
+
+void GscWriter::copyBlock(const uint8_t *data, const GscIndex &source, size_t i,
+                          const std::vector<std::pair<uint64_t, uint32_t>> &ids)
+{
+    BlockIndexEntry e = source.blocks.at(i);
+    std::vector<std::string> filters = sourceFilters(source, e);
+    place(data, e, source.chroms.at(e.chromId), filters, ids);
+}
+
+void GscWriter::append(const std::vector<uint8_t> &bytes, BlockIndexEntry e, const std::string &chrom,
+                       const std::vector<std::string> &filters,
+                       const std::vector<std::pair<uint64_t, uint32_t>> &blockIds)
+{
+    e.size = bytes.size();
+    e.hash = blockHash(bytes.data(), bytes.size());
+    e.tableHash = blockHash(bytes.data(), BlockView(bytes.data(), bytes.size()).tableBytes());
+    place(bytes.data(), e, chrom, filters, blockIds);
+}
+
+void GscWriter::place(const uint8_t *data, BlockIndexEntry e, const std::string &chrom,
+                      const std::vector<std::string> &filters,
+                      const std::vector<std::pair<uint64_t, uint32_t>> &blockIds)
+{
+    e.offset = offset;
+    auto it = std::find(index.chroms.begin(), index.chroms.end(), chrom);
+    if (it == index.chroms.end())
+    {
+        it = index.chroms.insert(index.chroms.end(), chrom);
+    }
+    e.chromId = static_cast<uint32_t>(it - index.chroms.begin());
+    for (const auto &name : filters)
+    {
+        auto f = std::find(index.filters.begin(), index.filters.end(), name);
+        if (f == index.filters.end())
+        {
+            f = index.filters.insert(index.filters.end(), name);
+        }
+        e.zone.filterMask |= filterBit(static_cast<uint32_t>(f - index.filters.begin()));
+    }
+    index.chromSummaries.resize(index.chroms.size());
+    ChromSummary &summary = index.chromSummaries[e.chromId];
+    summary.minPos = summary.blocks ? std::min(summary.minPos, e.minPos) : e.minPos;
+    summary.maxPos = summary.blocks ? std::max(summary.maxPos, e.maxPos) : e.maxPos;
+    summary.records += e.nRows;
+    ++summary.blocks;
+    for (const auto &id : blockIds)
+    {
+        ids.add(id.first, static_cast<uint32_t>(index.blocks.size()), id.second);
+    }
+    index.blocks.push_back(e);
+
+    out.write(reinterpret_cast<const char *>(data), e.size);
+    offset += e.size;
+}
+
+void GscWriter::close()
+{
+    ByteWriter w;
+    w.putVarint(index.chroms.size());
+    for (const auto &c : index.chroms)
+    {
+        w.putString(c);
+    }
+    w.putVarint(index.filters.size());
+    for (const auto &f : index.filters)
+    {
+        w.putString(f);
+    }
+    for (const auto &e : index.blocks)
+    {
+        w.putU64(e.offset);
+        w.putU64(e.size);
+        w.putU64(e.hash);
+        w.putU64(e.tableHash);
+        w.putU32(e.nRows);
+        w.putU32(e.chromId);
+        w.putU64(static_cast<uint64_t>(e.minPos));
+        w.putU64(static_cast<uint64_t>(e.maxPos));
+        for (double v : {e.zone.minQual, e.zone.maxQual, e.zone.minAf, e.zone.maxAf})
+        {
+            w.putU64(doubleBits(v));
+        }
+        w.putU64(e.zone.filterMask);
+        w.putU8(e.zone.typeMask);
+    }
+    for (const auto &c : index.chromSummaries)
+    {
+        w.putU64(c.records);
+        w.putU32(c.blocks);
+        w.putU64(static_cast<uint64_t>(c.minPos));
+        w.putU64(static_cast<uint64_t>(c.maxPos));
+    }
+    out.write(reinterpret_cast<const char *>(w.data.data()), w.size());
+    uint64_t idOffset = 0;
+    if (!ids.empty())
+    {
+        idOffset = offset + w.size();
+        std::vector<uint8_t> section = ids.finish();
+        out.write(reinterpret_cast<const char *>(section.data()), section.size());
+    }
+
+    ByteWriter h;
+    h.putBytes(kGscMagic, sizeof(kGscMagic));
+    h.putU16(kGscVersion);
+    h.putU32(static_cast<uint32_t>(index.blocks.size()));
+    h.putU64(offset);
+    h.putU64(idOffset);
+    while (h.size() < kGscHeaderSize)
+    {
+        h.putU8(0);
+    }
+    out.seekp(0);
+    out.write(reinterpret_cast<const char *>(h.data.data()), h.size());
+    out.close();
+    if (!out)
+    {
+        throw std::runtime_error("Failed to write .gsc output");
+    }
+    std::error_code err;
+    std::filesystem::rename(tmpPath, path, err);
+    if (err)
+    {
+        throw std::runtime_error("Failed to rename " + tmpPath + " to " + path + ": " + err.message());
+    }
+    closed = true;
+}
+
+namespace
+{
+    mio::shared_mmap_source mapFile(const std::string &path)
+    {
+        std::error_code err;
+        mio::shared_mmap_source map;
+        map.map(path, err);
+        if (err)
+        {
+            throw std::runtime_error("Failed to map file: " + path + ": " + err.message());
+        }
+        return map;
+    }
+}
+
+GscReader::GscReader(const std::string &path) : GscReader(mapFile(path)) {}
+
+GscReader::GscReader(mio::shared_mmap_source source) : map(std::move(source)), lazy(std::make_shared<Lazy>())
+{
+    if (!map.is_open() || map.size() < kGscHeaderSize || memcmp(base(), kGscMagic, sizeof(kGscMagic)) != 0)
+    {
+        throw std::runtime_error("Not a .gsc file");
+    }
+    ByteReader h(base() + sizeof(kGscMagic), kGscHeaderSize - sizeof(kGscMagic));
+    uint16_t version = h.getU16();
+    if (version != kGscVersion)
+    {
+        throw std::runtime_error("Unsupported .gsc version " + std::to_string(version));
+    }
+    nBlocks = h.getU32();
+    indexOffset = h.getU64();
+    uint64_t idOffset = h.getU64();
+    if (indexOffset < kGscHeaderSize || indexOffset > map.size() || idOffset > map.size() ||
+        (idOffset != 0 && idOffset < indexOffset))
+    {
+        throw std::runtime_error("Corrupt .gsc file: index offset out of range");
+    }
+    if (idOffset != 0)
+    {
+        idIndex = IdIndexView(base() + idOffset, map.size() - idOffset);
+    }
+}
+
+const std::string &GscReader::headerText() const
+{
+    std::call_once(lazy->headerOnce,
+                   [this]
+                   {
+                       ByteReader meta(base() + kGscHeaderSize, indexOffset - kGscHeaderSize);
+                       Codec codec = static_cast<Codec>(meta.getU8());
+                       size_t rawSize = meta.getVarint();
+                       size_t packedSize = meta.getVarint();
+                       std::vector<uint8_t> text = decompressStream(codec, meta.getBytes(packedSize), packedSize, rawSize);
+                       std::string header(text.begin(), text.end());
+
+                       std::vector<std::string> names;
+                       size_t colLine = header.rfind("#CHROM");
+                       if (colLine != std::string::npos)
+                       {
+                           std::string_view line(header.data() + colLine, header.size() - colLine);
+                           if (!line.empty() && line.back() == '\n')
+                           {
+                               line.remove_suffix(1);
+                           }
+                           std::vector<std::string_view> cols;
+                           splitView(line, '\t', cols);
+                           for (size_t i = 9; i < cols.size(); ++i)
+                           {
+                               names.emplace_back(cols[i]);
+                           }
+                       }
+                       lazy->header = std::move(header);
+                       lazy->sampleNames = std::move(names);
+                   });
+    return lazy->header;
+}
+
+const std::vector<std::string> &GscReader::samples() const
+{
+    headerText();
+    return lazy->sampleNames;
+}
+
+const GscIndex &GscReader::index() const
+{
+    std::call_once(lazy->indexOnce,
+                   [this]
+                   {
+                       GscIndex idx;
+                       ByteReader r(base() + indexOffset, map.size() - indexOffset);
+                       size_t nChroms = r.getVarint();
+                       for (size_t i = 0; i < nChroms; ++i)
+                       {
+                           idx.chroms.emplace_back(r.getString());
+                       }
+                       size_t nFilters = r.getVarint();
+                       for (size_t i = 0; i < nFilters; ++i)
+                       {
+                           idx.filters.emplace_back(r.getString());
+                       }
+                       idx.blocks.resize(nBlocks);
+                       for (auto &e : idx.blocks)
+                       {
+                           e.offset = r.getU64();
+                           e.size = r.getU64();
+                           e.hash = r.getU64();
+                           e.tableHash = r.getU64();
+                           e.nRows = r.getU32();
+                           e.chromId = r.getU32();
+                           e.minPos = static_cast<int64_t>(r.getU64());
+                           e.maxPos = static_cast<int64_t>(r.getU64());
+                           for (double *v : {&e.zone.minQual, &e.zone.maxQual, &e.zone.minAf, &e.zone.maxAf})
+                           {
+                               *v = bitsDouble(r.getU64());
+                           }
+                           e.zone.filterMask = r.getU64();
+                           e.zone.typeMask = r.getU8();
+                           if (e.offset + e.size > indexOffset || e.chromId >= idx.chroms.size())
+                           {
+                               throw std::runtime_error("Corrupt .gsc file: block index out of range");
+                           }
+                       }
+                       idx.chromSummaries.resize(idx.chroms.size());
+                       for (auto &c : idx.chromSummaries)
+                       {
+                           c.records = r.getU64();
+                           c.blocks = r.getU32();
+                           c.minPos = static_cast<int64_t>(r.getU64());
+                           c.maxPos = static_cast<int64_t>(r.getU64());
+                       }
+                       lazy->idx = std::move(idx);
+                   });
+    return lazy->idx;
+}
+
+const RegionIndex &GscReader::regions() const
+{
+    const GscIndex &idx = index();
+    std::call_once(lazy->regionOnce, [&] { lazy->regions = std::make_shared<RegionIndex>(idx); });
+    return *lazy->regions;
+}
+
+const uint8_t *GscReader::blockBytes(size_t i) const
+{
+    block(i);
+    return base() + index().blocks[i].offset;
+}
+
+BlockView GscReader::block(size_t i, BlockPart part) const
+{
+    const BlockIndexEntry &e = index().blocks.at(i);
+    const uint8_t *data = base() + e.offset;
+    if (part == BlockPart::Partial)
+    {
+        BlockView view(data, e.size);
+        if (blockHash(data, view.tableBytes()) != e.tableHash)
+        {
+            throw std::runtime_error("Block " + std::to_string(i) + " segment table hash mismatch");
+        }
+        return view;
+    }
+    if (blockHash(data, e.size) != e.hash)
+    {
+        throw std::runtime_error("Block " + std::to_string(i) + " hash mismatch");
+    }
+    return BlockView(data, e.size);
+}
+
+void GscReader::query(const GenomicRegion &region, const std::vector<uint32_t> *samples, std::string &out) const
+{
+    const GscIndex &idx = index();
+    const uint32_t nSamples = static_cast<uint32_t>(this->samples().size());
+    const std::vector<PositionRange> ranges = {{region.start, region.end}};
+    for (size_t i : regions().blocksFor(region))
+    {
+        RenderOptions options;
+        options.ranges = &ranges;
+        options.samples = samples;
+        // 只校验、读入与区域重叠的段（样本子集时只含所选样本组的流）
+        renderBlockVcf(block(i, BlockPart::Partial), idx.chroms[idx.blocks[i].chromId], nSamples, options, out);
+    }
+}
+
+bool isGscFile(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    char magic[4] = {0};
+    in.read(magic, sizeof(magic));
+    return in.gcount() == sizeof(magic) && memcmp(magic, kGscMagic, sizeof(magic)) == 0;
+}
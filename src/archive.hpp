@@ -0,0 +1,170 @@
+#pragma once
+
+#include "block.hpp"
+#include "id_index.hpp"
+#include "vcf.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mio/shared_mmap.hpp>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// .gsc 文件结构
+//
+//   Header (34 bytes)
+//     魔数 "GSC1" (4) | 版本号 (2) | 块数量 (4) | 索引偏移 (8) | ID 索引偏移 (8，0 表示无) | 保留 (8)
+//   元数据区
+//     编码器 (1) | 原始长度 (varint) | 压缩长度 (varint) | VCF 头部文本
+//   数据区
+//     块 0 | 块 1 | ...            每块：段表 + 各段（流目录 + 站点流 + 样本流）
+//   索引区（位于索引偏移处）
+//     染色体名表 | FILTER 名表 | 每块：偏移 + 大小 + hash + 段表 hash + 行数 + 染色体 + POS 范围
+//       + 摘要（QUAL 范围、AF 范围，各为两个 f64；FILTER 位 u64；类型位 u8）
+//     | 每条染色体：记录数 + 块数 + POS 范围
+//   ID 索引区（可选，见 id_index.hpp）
+
+constexpr char kGscMagic[4] = {'G', 'S', 'C', '1'};
+constexpr uint16_t kGscVersion = 1;
+constexpr size_t kGscHeaderSize = 34;
+
+struct BlockIndexEntry
+{
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t hash = 0;
+    uint32_t nRows = 0;
+    uint32_t chromId = 0;
+    int64_t minPos = 0;
+    int64_t maxPos = 0;
+    ZoneMap zone;
+    uint64_t tableHash = 0; // 只覆盖段表（BlockView::tableBytes()），按需读取部分段与流时校验
+};
+
+// 每条染色体的汇总，计数与统计查询直接读取
+struct ChromSummary
+{
+    uint64_t records = 0;
+    uint32_t blocks = 0;
+    int64_t minPos = 0;
+    int64_t maxPos = 0;
+};
+
+struct GscIndex
+{
+    std::vector<std::string> chroms;
+    std::vector<std::string> filters; // 文件级 FILTER 名表，按首次出现顺序；ZoneMap::filterMask 的位号
+    std::vector<BlockIndexEntry> blocks;
+    std::vector<ChromSummary> chromSummaries; // 与 chroms 一一对应
+};
+
+// 由已有 .gsc 写新文件的命令（transcode、merge-samples、concat）在打开输出前调用：输出与某个输入是同一文件时抛出异常，
+// 否则 close() 时输出会替换掉输入
+void checkOutputNotInput(const std::vector<std::string> &inputFiles, const std::string &outputFile);
+
+class GscWriter
+{
+public:
+    GscWriter(const std::string &path, const VcfHeader &header, const CodecParams &codec);
+    GscWriter(const std::string &path, const std::string &headerText, const CodecParams &codec);
+    ~GscWriter();
+
+    void writeBlock(const EncodedBlock &block);
+
+    // 写入已编码的块字节（重编码或拼接已有文件时），不重新解析记录：行数、POS 范围与摘要取自 source 的第 i 块，
+    // FILTER 位按名称映射到本文件的名表；ids 为该块的 (ID 哈希, 块内行号)
+    void writeBlock(const std::vector<uint8_t> &bytes, const GscIndex &source, size_t i,
+                    const std::vector<std::pair<uint64_t, uint32_t>> &ids);
+
+    // 原样追加 source 第 i 块的字节（拼接文件时），块 hash 与段表 hash 沿用 source 的索引项，不再重算
+    void copyBlock(const uint8_t *data, const GscIndex &source, size_t i,
+                   const std::vector<std::pair<uint64_t, uint32_t>> &ids);
+
+    // 写索引并回填文件头，成功后才把临时文件改名为输出文件
+    void close();
+
+private:
+    std::string path;
+    // 写出期间的文件为 path + ".tmp"，未调用 close() 就析构时删除
+    std::string tmpPath;
+    std::ofstream out;
+    GscIndex index;
+    IdIndexBuilder ids;
+    uint64_t offset = 0;
+    bool closed = false;
+
+    void append(const std::vector<uint8_t> &bytes, BlockIndexEntry e, const std::string &chrom,
+                const std::vector<std::string> &filters, const std::vector<std::pair<uint64_t, uint32_t>> &blockIds);
+    // 写出 e.size 字节并登记索引项；e 的大小与 hash 由调用方填好
+    void place(const uint8_t *data, BlockIndexEntry e, const std::string &chrom,
+               const std::vector<std::string> &filters, const std::vector<std::pair<uint64_t, uint32_t>> &blockIds);
+};
+
+struct GenomicRegion;
+class RegionIndex;
+
+// 读取块的哪一部分：All 校验整块字节；Partial 只校验段表，取段时按段表校验该段流目录，加载流时按流目录
+// 校验该流，只读部分段或部分流（站点列、样本子集、区域与点查询）时未用到的字节不从磁盘读入
+enum class BlockPart : uint8_t
+{
+    All,
+    Partial,
+};
+
+// .gsc 读取器，可嵌入其他程序：
+//   - 打开时只映射文件并校验 34 字节文件头，头部文本与索引在首次使用时解析
+//   - 块在请求时才解码；解析完成后读路径只读共享状态，多线程并发调用无需加锁
+//   - 复制读取器与原读取器共享映射和已解析的状态
+class GscReader
+{
+public:
+    explicit GscReader(const std::string &path);
+    explicit GscReader(mio::shared_mmap_source map);
+
+    const std::string &headerText() const;
+    const std::vector<std::string> &samples() const;
+    const GscIndex &index() const;
+    size_t blockCount() const { return nBlocks; }
+
+    // 返回第 i 块的视图，校验块 hash；视图指向映射，读取器（或其副本）存活期间有效。
+    // part 为 Partial 时只校验段表，段与流在取用时逐级校验
+    BlockView block(size_t i, BlockPart part = BlockPart::All) const;
+
+    // 第 i 块校验 hash 后的原始字节（长度见索引项），供原样复制
+    const uint8_t *blockBytes(size_t i) const;
+
+    // 解码与区域重叠的记录，以 VCF 文本追加到 out；samples 为空指针表示全部样本
+    void query(const GenomicRegion &region, const std::vector<uint32_t> *samples, std::string &out) const;
+
+    const RegionIndex &regions() const;
+
+    bool hasIdIndex() const { return idIndex.valid(); }
+
+    // ID 索引中哈希匹配的候选位置；调用方需核对记录的 ID
+    std::vector<IdLocation> findId(std::string_view id) const { return idIndex.find(id); }
+    const IdIndexView &idIndexView() const { return idIndex; }
+
+private:
+    struct Lazy
+    {
+        std::once_flag headerOnce;
+        std::once_flag indexOnce;
+        std::once_flag regionOnce;
+        std::string header;
+        std::vector<std::string> sampleNames;
+        GscIndex idx;
+        std::shared_ptr<RegionIndex> regions;
+    };
+
+    mio::shared_mmap_source map;
+    uint32_t nBlocks = 0;
+    uint64_t indexOffset = 0;
+    IdIndexView idIndex;
+    std::shared_ptr<Lazy> lazy;
+
+    const uint8_t *base() const { return reinterpret_cast<const uint8_t *>(map.data()); }
+};
+
+bool isGscFile(const std::string &path);
@@ -0,0 +1,98 @@
+#include "bgzf.hpp"
+
+#include <algorithm>
+#include <oneapi/tbb/parallel_for.h>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+namespace
+{
+    constexpr size_t kHeaderSize = 18;
+    constexpr size_t kFooterSize = 8;
+
+    void putLe(uint8_t *p, uint32_t v, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            p[i] = static_cast<uint8_t>(v >> (8 * i));
+        }
+    }
+
+    // 原始 deflate 压缩到 dst，返回压缩长度；放不下时返回 0
+    size_t deflateRaw(const char *src, size_t n, uint8_t *dst, size_t cap, int level)
+    {
+        z_stream zs{};
+        if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw std::runtime_error("deflateInit2 failed");
+        }
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(src));
+        zs.avail_in = static_cast<uInt>(n);
+        zs.next_out = dst;
+        zs.avail_out = static_cast<uInt>(cap);
+        int rc = deflate(&zs, Z_FINISH);
+        size_t written = cap - zs.avail_out;
+        deflateEnd(&zs);
+        return rc == Z_STREAM_END ? written : 0;
+    }
+
+    // 压缩一个 member，返回其长度
+    size_t compressMember(const char *src, size_t n, uint8_t *dst, int level)
+    {
+        const size_t cap = kBgzfMaxMember - kHeaderSize - kFooterSize;
+        size_t csize = deflateRaw(src, n, dst + kHeaderSize, cap, level);
+        if (csize == 0)
+        {
+            // 不可压缩的数据按存储模式写出
+            csize = deflateRaw(src, n, dst + kHeaderSize, cap, 0);
+            if (csize == 0)
+            {
+                throw std::runtime_error("BGZF member exceeds 64 KiB");
+            }
+        }
+        const size_t total = kHeaderSize + csize + kFooterSize;
+        static const uint8_t kHeader[12] = {0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0};
+        std::copy(kHeader, kHeader + 12, dst);
+        dst[12] = 'B';
+        dst[13] = 'C';
+        putLe(dst + 14, 2, 2);
+        putLe(dst + 16, static_cast<uint32_t>(total - 1), 2);
+        uint8_t *footer = dst + kHeaderSize + csize;
+        putLe(footer, static_cast<uint32_t>(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef *>(src),
+                                                  static_cast<uInt>(n))),
+              4);
+        putLe(footer + 4, static_cast<uint32_t>(n), 4);
+        return total;
+    }
+}
+
+void bgzfCompress(const char *data, size_t size, std::string &out, std::vector<uint32_t> *memberSizes, int level)
+{
+    const size_t nMembers = (size + kBgzfBlockInput - 1) / kBgzfBlockInput;
+    std::vector<uint8_t> buf(nMembers * kBgzfMaxMember);
+    std::vector<size_t> sizes(nMembers);
+    tbb::parallel_for(size_t(0), nMembers,
+                      [&](size_t m)
+                      {
+                          const size_t offset = m * kBgzfBlockInput;
+                          sizes[m] = compressMember(data + offset, std::min(kBgzfBlockInput, size - offset),
+                                                    buf.data() + m * kBgzfMaxMember, level);
+                      });
+    for (size_t m = 0; m < nMembers; ++m)
+    {
+        out.append(reinterpret_cast<const char *>(buf.data() + m * kBgzfMaxMember), sizes[m]);
+        if (memberSizes)
+        {
+            memberSizes->push_back(static_cast<uint32_t>(sizes[m]));
+        }
+    }
+}
+
+const std::string &bgzfEofMarker()
+{
+    static const std::string kEof("\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43\x02\x00"
+                                  "\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00",
+                                  28);
+    return kEof;
+}
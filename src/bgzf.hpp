@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// BGZF（分块 gzip，samtools/htslib 规范）：每个 member 最多 64 KiB，
+// gzip 头部带 "BC" 扩展字段记录 member 长度，可被 tabix/bcftools 随机访问；
+// 文件以 28 字节的空 member 结束。
+
+constexpr size_t kBgzfBlockInput = 0xff00;  // 每个 member 最多压缩的输入字节数（同 bgzip）
+constexpr size_t kBgzfMaxMember = 0x10000;  // member 总长度上限
+
+// 把 data 压缩为连续的 BGZF member 追加到 out；输入较大时各 member 并行压缩。
+// 第 m 个 member 压缩 [m * kBgzfBlockInput, (m + 1) * kBgzfBlockInput) 的输入，
+// memberSizes 非空时追加各 member 的长度，供调用方换算虚拟偏移
+void bgzfCompress(const char *data, size_t size, std::string &out, std::vector<uint32_t> *memberSizes = nullptr,
+                  int level = -1);
+
+// 虚拟偏移：member 在文件中的起点 << 16 | member 内的解压后偏移
+inline uint64_t bgzfVirtualOffset(uint64_t memberStart, size_t inMember)
+{
+    return memberStart << 16 | inMember;
+}
+
+// 文件结尾的空 member
+const std::string &bgzfEofMarker();
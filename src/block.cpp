@@ -0,0 +1,2333 @@
+#include "block.hpp"
+#include "buffer.hpp"
+#include "fields.hpp"
+#include "format_matrix.hpp"
+#include "genotype.hpp"
+#include "gvcf.hpp"
+#include "id_index.hpp"
+#include "index_set.hpp"
+#include "itoa.hpp"
+#include "vcf.hpp"
+#include "xxhash/xxh3.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace
+{
+    bool formatHasGt(std::string_view format)
+    {
+        return format.size() >= 2 && format[0] == 'G' && format[1] == 'T' &&
+               (format.size() == 2 || format[2] == ':');
+    }
+
+    // FORMAT 键名：重复键加序号区分，样本格多出的字段用位置命名，保证无损
+    void rowFormatKeys(std::string_view format, std::vector<std::string> &keys)
+    {
+        std::vector<std::string_view> parts;
+        splitView(format, ':', parts);
+        keys.clear();
+        for (size_t k = 0; k < parts.size(); ++k)
+        {
+            std::string name(parts[k]);
+            size_t dup = std::count(parts.begin(), parts.begin() + k, parts[k]);
+            if (dup)
+            {
+                name += '\x01' + std::to_string(dup);
+            }
+            keys.push_back(std::move(name));
+        }
+    }
+
+    std::string extraFieldKey(size_t k)
+    {
+        return "\x01" + std::to_string(k);
+    }
+
+    void appendText(std::string &stream, std::string_view value)
+    {
+        stream.append(value.data(), value.size());
+        stream.push_back('\n');
+    }
+
+    // 把若干原始字段流压缩后拼成块：流目录 + 各流数据
+    class BlockBuilder
+    {
+    public:
+        explicit BlockBuilder(const CodecParams &params) : params(params) {}
+
+        void add(uint32_t id, const uint8_t *data, size_t size)
+        {
+            Codec used = Codec::Store;
+            payloads.push_back(compressStream(params, data, size, used));
+            StreamEntry e;
+            e.id = id;
+            e.codec = used;
+            e.rawSize = size;
+            e.size = payloads.back().size();
+            e.hash = XXH3_64bits(payloads.back().data(), payloads.back().size());
+            entries.push_back(e);
+        }
+
+        void add(uint32_t id, const std::string &text)
+        {
+            add(id, reinterpret_cast<const uint8_t *>(text.data()), text.size());
+        }
+
+        void add(uint32_t id, const std::vector<uint8_t> &bytes)
+        {
+            add(id, bytes.data(), bytes.size());
+        }
+
+        // 原样复制另一段中已压缩的流（校验 hash），newId 为写入的流编号
+        void copy(const SegmentView &segment, uint32_t id, uint32_t newId)
+        {
+            const StreamEntry &src = segment.entry(id);
+            const uint8_t *bytes = segment.payload(src);
+            if (XXH3_64bits(bytes, src.size) != src.hash)
+            {
+                throw std::runtime_error("Stream " + std::to_string(id) + " hash mismatch");
+            }
+            payloads.emplace_back(bytes, bytes + src.size);
+            StreamEntry e = src;
+            e.id = newId;
+            entries.push_back(e);
+        }
+
+        // 站点流排在样本流之前，只输出站点列时读到的是每段开头的一段连续字节
+        std::vector<uint8_t> finish()
+        {
+            std::vector<size_t> order(entries.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+            std::stable_partition(order.begin(), order.end(), [&](size_t i) { return !isSampleStream(entries[i].id); });
+            ByteWriter w;
+            w.putVarint(entries.size());
+            for (size_t i : order)
+            {
+                const StreamEntry &e = entries[i];
+                w.putVarint(e.id);
+                w.putU8(static_cast<uint8_t>(e.codec));
+                w.putVarint(e.rawSize);
+                w.putVarint(e.size);
+                w.putU64(e.hash);
+            }
+            for (size_t i : order)
+            {
+                w.putBytes(payloads[i].data(), payloads[i].size());
+            }
+            return std::move(w.data);
+        }
+
+    private:
+        const CodecParams &params;
+        std::vector<StreamEntry> entries;
+        std::vector<std::vector<uint8_t>> payloads;
+    };
+
+    uint32_t streamId(uint32_t base, StreamId id)
+    {
+        return base + static_cast<uint32_t>(id);
+    }
+
+    // 一组行（真实变异行或 gVCF 参考块行）的列式编码
+    class RowGroupEncoder
+    {
+    public:
+        RowGroupEncoder(uint32_t nSamples, bool refBlocks, uint32_t groupSize)
+            : nSamples(nSamples), refBlocks(refBlocks), groupSize(groupSize)
+        {
+            for (uint32_t g = 0; g * groupSize < nSamples; ++g)
+            {
+                gt.emplace_back(groupSamples(g));
+            }
+        }
+
+        uint32_t rows() const { return nRows; }
+
+        void add(const VcfRecord &rec, int64_t pos, int64_t end, uint8_t altCode)
+        {
+            addSite(rec.id, {rec.ref, rec.alt, rec.qual, rec.filter, rec.info}, pos, end, altCode);
+            if (nSamples > 0)
+            {
+                addSamples(rec);
+            }
+            endRow();
+        }
+
+        // 逐列写入一行：addSite，有样本时 beginSamples 后按样本递增逐格写入（行有 GT 时先 GT，再其余字段，
+        // 最后 endCell），最后 endRow
+        void addSite(std::string_view idText, const RowFields &site, int64_t pos, int64_t end, uint8_t altCode)
+        {
+            if (refBlocks)
+            {
+                intervals.add(pos, end, altCode);
+            }
+            else
+            {
+                posStream.putSVarint(pos - prevPos);
+                prevPos = pos;
+                appendText(alt, site.alt);
+                appendText(info, site.info);
+            }
+            appendText(id, idText);
+            appendText(ref, site.ref);
+            appendText(qual, site.qual);
+            appendText(filter, site.filter);
+        }
+
+        void beginSamples(std::string_view rowFormat)
+        {
+            appendText(format, rowFormat);
+            rowGt = formatHasGt(rowFormat);
+            rowFormatKeys(rowFormat, rowKeys);
+            rowKeyIds.assign(rowKeys.size(), 0);
+            for (size_t k = rowGt ? 1 : 0; k < rowKeys.size(); ++k)
+            {
+                rowKeyIds[k] = keyOf(rowKeys[k]);
+            }
+            for (auto &enc : gt)
+            {
+                enc.beginRow(rowGt);
+            }
+        }
+
+        // 当前行的 FORMAT 是否以 GT 开头
+        bool hasGt() const { return rowGt; }
+
+        GenotypeEncoder &genotypes(uint32_t s) { return gt[s / groupSize]; }
+
+        // 样本格第 k 个字段（k 超出 FORMAT 时按位置命名）
+        void addField(uint32_t s, size_t k, std::string_view value)
+        {
+            const uint32_t g = s / groupSize;
+            const uint32_t key = k < rowKeys.size() ? rowKeyIds[k] : keyOf(extraFieldKey(k));
+            keyEncoders[key][g].add(nRows, s - g * groupSize, value);
+        }
+
+        // 样本格共 nFields 个字段；与 FORMAT 键数不同时记入样本格形状
+        void endCell(uint32_t s, size_t nFields)
+        {
+            if (nFields != rowKeys.size())
+            {
+                const uint64_t cell = static_cast<uint64_t>(nRows) * nSamples + s;
+                shapeItems.putVarint(cell - shapePrev);
+                shapeItems.putVarint(nFields);
+                shapePrev = cell;
+                ++shapeCount;
+            }
+        }
+
+        // 合并样本时缺少该行的输入：每个样本格为单个缺失值（FORMAT 以 GT 开头时为 ./.，否则为 .）
+        void addMissingCells(uint32_t first, uint32_t count)
+        {
+            for (uint32_t s = first; s < first + count; ++s)
+            {
+                if (rowGt)
+                {
+                    genotypes(s).addGenotype("./.");
+                }
+                else
+                {
+                    addField(s, 0, ".");
+                }
+                endCell(s, 1);
+            }
+        }
+
+        void endRow() { ++nRows; }
+
+        // sites 为假时只写样本流，站点流由调用方从别处复制
+        void finish(BlockBuilder &builder, uint32_t base, GenotypeLayout gtLayout, bool sites = true)
+        {
+            if (sites)
+            {
+                if (refBlocks)
+                {
+                    builder.add(static_cast<uint32_t>(StreamId::RefInterval), intervals.finish());
+                }
+                else
+                {
+                    builder.add(streamId(base, StreamId::Pos), posStream.data);
+                    builder.add(streamId(base, StreamId::Alt), alt);
+                    builder.add(streamId(base, StreamId::Info), info);
+                }
+                builder.add(streamId(base, StreamId::Id), id);
+                builder.add(streamId(base, StreamId::Ref), ref);
+                builder.add(streamId(base, StreamId::Qual), qual);
+                builder.add(streamId(base, StreamId::Filter), filter);
+            }
+            if (nSamples == 0)
+            {
+                return;
+            }
+            builder.add(streamId(base, StreamId::Format), format);
+            for (uint32_t g = 0; g < gt.size(); ++g)
+            {
+                builder.add(groupStreamId(streamId(base, StreamId::Genotype), g), gt[g].finish(gtLayout));
+            }
+            ByteWriter names;
+            names.putVarint(keyNames.size());
+            for (const auto &name : keyNames)
+            {
+                names.putString(name);
+            }
+            builder.add(streamId(base, StreamId::FormatKeys), names.data);
+            ByteWriter shape;
+            shape.putVarint(shapeCount);
+            shape.putBytes(shapeItems.data.data(), shapeItems.size());
+            builder.add(streamId(base, StreamId::SampleShape), shape.data);
+            for (size_t k = 0; k < keyEncoders.size(); ++k)
+            {
+                for (uint32_t g = 0; g < keyEncoders[k].size(); ++g)
+                {
+                    builder.add(groupStreamId(base + kFormatKeyStreamBase + static_cast<uint32_t>(k), g),
+                                keyEncoders[k][g].finish(nRows));
+                }
+            }
+        }
+
+    private:
+        uint32_t nSamples;
+        bool refBlocks;
+        uint32_t groupSize;
+        uint32_t nRows = 0;
+
+        ByteWriter posStream;
+        int64_t prevPos = 0;
+        RefIntervalEncoder intervals;
+        std::string id, ref, alt, qual, filter, info, format;
+        std::vector<GenotypeEncoder> gt; // 每个样本组一个
+
+        // FORMAT 键名表与每键每样本组的编码器
+        std::unordered_map<std::string, uint32_t> keyIndex;
+        std::vector<std::string> keyNames;
+        std::vector<std::vector<FormatKeyEncoder>> keyEncoders;
+        ByteWriter shapeItems;
+        uint64_t shapePrev = 0;
+        uint64_t shapeCount = 0;
+        std::vector<std::string> rowKeys;
+        std::vector<uint32_t> rowKeyIds;
+        bool rowGt = false;
+        std::vector<std::string_view> fields;
+
+        uint32_t keyOf(const std::string &name)
+        {
+            auto it = keyIndex.find(name);
+            if (it != keyIndex.end())
+            {
+                return it->second;
+            }
+            uint32_t k = static_cast<uint32_t>(keyNames.size());
+            keyIndex.emplace(name, k);
+            keyNames.push_back(name);
+            keyEncoders.emplace_back();
+            for (uint32_t g = 0; g < gt.size(); ++g)
+            {
+                keyEncoders.back().emplace_back(groupSamples(g));
+            }
+            return k;
+        }
+
+        uint32_t groupSamples(uint32_t g) const { return std::min(groupSize, nSamples - g * groupSize); }
+
+        void addSamples(const VcfRecord &rec)
+        {
+            beginSamples(rec.format);
+            for (uint32_t s = 0; s < nSamples; ++s)
+            {
+                splitView(rec.samples[s], ':', fields);
+                if (rowGt)
+                {
+                    genotypes(s).addGenotype(fields[0]);
+                }
+                for (size_t k = rowGt ? 1 : 0; k < fields.size(); ++k)
+                {
+                    addField(s, k, fields[k]);
+                }
+                endCell(s, fields.size());
+            }
+        }
+    };
+
+    // 行组解码器加载的站点文本列（POS 与参考块区间总是加载）
+    constexpr uint8_t kSiteId = 0x01;
+    constexpr uint8_t kSiteRef = 0x02;
+    constexpr uint8_t kSiteAlt = 0x04;
+    constexpr uint8_t kSiteQual = 0x08;
+    constexpr uint8_t kSiteFilter = 0x10;
+    constexpr uint8_t kSiteInfo = 0x20;
+    constexpr uint8_t kAllSiteColumns = 0x3f;
+
+    // 行组解码：按组内行号还原 POS 之后的各列
+    class RowGroupDecoder
+    {
+    public:
+        // 构造时只加载 columns 所列的站点列；samples 为输出的样本（原始列号，递增），由 loadSamples 按需加载所在组的流
+        RowGroupDecoder(const SegmentView &block, uint32_t base, bool refBlocks, uint32_t nSamples,
+                        const std::vector<uint32_t> &samples, uint8_t columns = kAllSiteColumns)
+            : block(block), base(base), nSamples(nSamples), refBlocks(refBlocks), samples(samples)
+        {
+            if (refBlocks)
+            {
+                intervals = std::make_unique<RefIntervalDecoder>(block.load(StreamId::RefInterval));
+                nRows = intervals->size();
+            }
+            else
+            {
+                std::vector<uint8_t> posBytes = block.load(streamId(base, StreamId::Pos));
+                ByteReader posReader(posBytes);
+                int64_t prev = 0;
+                while (!posReader.eof())
+                {
+                    prev += posReader.getSVarint();
+                    pos.push_back(prev);
+                }
+                nRows = static_cast<uint32_t>(pos.size());
+                if (columns & kSiteAlt)
+                {
+                    alt.load(block, streamId(base, StreamId::Alt), nRows);
+                }
+                if (columns & kSiteInfo)
+                {
+                    info.load(block, streamId(base, StreamId::Info), nRows);
+                }
+            }
+            if (columns & kSiteId)
+            {
+                id.load(block, streamId(base, StreamId::Id), nRows);
+            }
+            if (columns & kSiteRef)
+            {
+                ref.load(block, streamId(base, StreamId::Ref), nRows);
+            }
+            if (columns & kSiteQual)
+            {
+                qual.load(block, streamId(base, StreamId::Qual), nRows);
+            }
+            if (columns & kSiteFilter)
+            {
+                filter.load(block, streamId(base, StreamId::Filter), nRows);
+            }
+        }
+
+        // 所选样本所在的组
+        void selectGroups()
+        {
+            if (nSamples == 0 || samples.empty() || !usedGroups.empty())
+            {
+                return;
+            }
+            groups = blockSampleGroups(block, nSamples);
+            usedGroups.assign(groups.count(), 0);
+            for (uint32_t s : samples)
+            {
+                if (s < nSamples)
+                {
+                    usedGroups[groups.of(s)] = 1;
+                    anyGroup = true;
+                }
+            }
+        }
+
+        // 只加载所选样本所在组的 GT 流
+        void loadGenotypes()
+        {
+            selectGroups();
+            gt.resize(usedGroups.size());
+            gtRows.resize(usedGroups.size());
+            for (uint32_t g = 0; g < usedGroups.size(); ++g)
+            {
+                if (!usedGroups[g] || gt[g])
+                {
+                    continue;
+                }
+                gt[g] = std::make_unique<GenotypeDecoder>(block.load(groupStreamId(streamId(base, StreamId::Genotype), g)));
+                if (gt[g]->rows() != nRows || gt[g]->samples() != groups.size(g))
+                {
+                    throw std::runtime_error("Genotype stream does not match block shape");
+                }
+                if (!firstGroup)
+                {
+                    firstGroup = gt[g].get();
+                }
+            }
+        }
+
+        // 加载所选样本所在组的 GT、FORMAT 与样本格形状流；有列投影时只加载所选的 GT 与 FORMAT 键
+        void loadSamples(const FieldProjection *projection = nullptr)
+        {
+            if (!projection || projection->wants(FieldProjection::Column::Gt))
+            {
+                loadGenotypes();
+            }
+            else
+            {
+                selectGroups();
+            }
+            if (!anyGroup || (projection && projection->formatKeys().empty()))
+            {
+                return;
+            }
+
+            format.load(block, streamId(base, StreamId::Format), nRows);
+            const uint32_t nGroups = static_cast<uint32_t>(usedGroups.size());
+            std::vector<uint8_t> names = block.load(streamId(base, StreamId::FormatKeys));
+            ByteReader nr(names);
+            size_t nKeys = nr.getVarint();
+            keyDecoders.resize(nKeys);
+            for (size_t k = 0; k < nKeys; ++k)
+            {
+                std::string name(nr.getString());
+                keyDecoders[k].resize(nGroups);
+                if (projection && std::find(projection->formatKeys().begin(), projection->formatKeys().end(), name) ==
+                                      projection->formatKeys().end())
+                {
+                    continue;
+                }
+                keyIndex.emplace(std::move(name), static_cast<uint32_t>(k));
+                for (uint32_t g = 0; g < nGroups; ++g)
+                {
+                    if (usedGroups[g])
+                    {
+                        keyDecoders[k][g] = std::make_unique<FormatKeyDecoder>(
+                            block.load(groupStreamId(base + kFormatKeyStreamBase + static_cast<uint32_t>(k), g)), nRows,
+                            groups.size(g));
+                    }
+                }
+            }
+            std::vector<uint8_t> shape = block.load(streamId(base, StreamId::SampleShape));
+            ByteReader sr(shape);
+            size_t nShape = sr.getVarint();
+            uint64_t prevCell = 0;
+            for (size_t i = 0; i < nShape; ++i)
+            {
+                prevCell += sr.getVarint();
+                shapeIndex.push_back(prevCell);
+                shapeFields.push_back(static_cast<uint32_t>(sr.getVarint()));
+            }
+        }
+
+        uint32_t rows() const { return nRows; }
+
+        int64_t position(uint32_t r) const { return refBlocks ? intervals->start(r) : pos[r]; }
+
+        // 供 --where 求值的站点列；参考块的 INFO 只有 END，不含可比较的字段
+        RowFields fields(uint32_t r) const
+        {
+            std::string_view altText = refBlocks ? refBlockAlt(intervals->altCode(r)) : alt.values[r];
+            return {ref.values[r], altText, qual.values[r], filter.values[r],
+                    refBlocks ? std::string_view() : info.values[r]};
+        }
+
+        // 记录覆盖的最后一个位置：参考块为 END，其余为 POS + len(REF) - 1
+        int64_t stop(uint32_t r) const
+        {
+            if (refBlocks)
+            {
+                return intervals->end(r);
+            }
+            return pos[r] + std::max<int64_t>(1, static_cast<int64_t>(ref.values[r].size())) - 1;
+        }
+
+        std::string_view idText(uint32_t r) const { return id.values[r]; }
+
+        uint8_t altCode(uint32_t r) const { return refBlocks ? intervals->altCode(r) : 0; }
+
+        bool isRefBlocks() const { return refBlocks; }
+
+        // FORMAT 列（需先 loadSamples）
+        std::string_view formatText(uint32_t r) const { return format.values[r]; }
+
+        // 把行 r 的全部样本写入合并输出的同一行，样本号从 firstSample 起（需先 loadSamples 且选中全部样本）。
+        // keys 为空指针时输出 FORMAT 与本行相同，样本格原样保留字段数；否则按合并后的键名 keys 重排，
+        // 缺少的键为缺失值，多出的字段丢弃
+        void mergeSamplesInto(uint32_t r, RowGroupEncoder &out, uint32_t firstSample,
+                              const std::vector<std::string_view> *keys)
+        {
+            const bool hasGt = firstGroup->hasGt(r);
+            for (size_t g = 0; hasGt && g < gt.size(); ++g)
+            {
+                gt[g]->decodeRow(r, gtRows[g]);
+            }
+            rowFormatKeys(format.values[r], rowKeys);
+            rowKeyIds.assign(rowKeys.size(), -1);
+            for (size_t k = hasGt ? 1 : 0; k < rowKeys.size(); ++k)
+            {
+                rowKeyIds[k] = keyId(rowKeys[k]);
+            }
+            // 同一 POS 上按 (REF, ALT) 配对的行可不按行号顺序合并，样本格形状从本行重新定位
+            shapeCursor = std::lower_bound(shapeIndex.begin(), shapeIndex.end(), static_cast<uint64_t>(r) * nSamples) -
+                          shapeIndex.begin();
+            if (keys)
+            {
+                std::vector<std::string_view> names;
+                splitView(format.values[r], ':', names);
+                mergeFrom.assign(keys->size(), -1);
+                for (size_t m = 0; m < keys->size(); ++m)
+                {
+                    auto it = std::find(names.begin(), names.end(), (*keys)[m]);
+                    mergeFrom[m] = it == names.end() ? -1 : it - names.begin();
+                }
+            }
+            for (uint32_t s = 0; s < nSamples; ++s)
+            {
+                const uint32_t g = groups.of(s);
+                const uint32_t local = s - groups.first(g);
+                const uint32_t o = firstSample + s;
+                const size_t nFields = cellFields(r, s);
+                if (!keys)
+                {
+                    if (hasGt)
+                    {
+                        out.genotypes(o).addGenotype(gtRows[g], local);
+                    }
+                    for (size_t k = hasGt ? 1 : 0; k < nFields; ++k)
+                    {
+                        mergeValue.clear();
+                        appendField(r, s, k, mergeValue);
+                        out.addField(o, k, mergeValue);
+                    }
+                    out.endCell(o, nFields);
+                    continue;
+                }
+                for (size_t m = 0; m < keys->size(); ++m)
+                {
+                    const int64_t k = mergeFrom[m];
+                    const bool present = k >= 0 && static_cast<size_t>(k) < nFields;
+                    const bool isGt = m == 0 && out.hasGt();
+                    if (isGt && present && k == 0 && hasGt)
+                    {
+                        out.genotypes(o).addGenotype(gtRows[g], local);
+                        continue;
+                    }
+                    mergeValue.clear();
+                    if (present)
+                    {
+                        appendField(r, s, k, mergeValue);
+                    }
+                    else
+                    {
+                        mergeValue = isGt ? "./." : ".";
+                    }
+                    if (isGt)
+                    {
+                        out.genotypes(o).addGenotype(mergeValue);
+                    }
+                    else
+                    {
+                        out.addField(o, m, mergeValue);
+                    }
+                }
+                out.endCell(o, keys->size());
+            }
+        }
+
+        // 全部样本组的 PLINK 编码拼成一行（需先 loadGenotypes 且选中全部样本）；组起点为 4 的倍数时按字节拼接
+        void packPlinkRow(uint32_t r, uint8_t *out, std::vector<uint8_t> &scratch) const
+        {
+            if (!firstGroup)
+            {
+                return;
+            }
+            for (size_t g = 0; g < gt.size(); ++g)
+            {
+                const uint32_t first = groups.first(static_cast<uint32_t>(g));
+                if (first % 4 == 0)
+                {
+                    gt[g]->packPlinkRow(r, out + first / 4);
+                    continue;
+                }
+                scratch.resize((gt[g]->samples() + 3) / 4);
+                gt[g]->packPlinkRow(r, scratch.data());
+                for (uint32_t s = 0; s < gt[g]->samples(); ++s)
+                {
+                    const uint32_t code = (scratch[s >> 2] >> (2 * (s & 3))) & 3;
+                    const uint32_t at = first + s;
+                    out[at >> 2] = static_cast<uint8_t>((out[at >> 2] & ~(3u << (2 * (at & 3)))) |
+                                                        (code << (2 * (at & 3))));
+                }
+            }
+        }
+
+        // 按 samples 的顺序写出矩阵的一行（需先 loadGenotypes）
+        void packMatrixRow(uint32_t r, MatrixKind kind, uint8_t *out)
+        {
+            if (!firstGroup)
+            {
+                return;
+            }
+            const bool hasGt = firstGroup->hasGt(r);
+            for (size_t g = 0; hasGt && g < gt.size(); ++g)
+            {
+                if (gt[g])
+                {
+                    gt[g]->decodeRow(r, gtRows[g]);
+                }
+            }
+            for (size_t i = 0; i < samples.size(); ++i)
+            {
+                const uint32_t g = groups.of(samples[i]);
+                const GenotypeRow &row = gtRows[g];
+                const uint32_t local = samples[i] - groups.first(g);
+                const uint8_t p = hasGt ? row.ploidy[local] : 0;
+                const uint16_t *a = row.alleles.data() + static_cast<size_t>(local) * row.blockPloidy;
+                if (kind == MatrixKind::Dosage)
+                {
+                    int dosage = p == 0 ? -1 : 0;
+                    for (uint8_t k = 0; k < p && dosage >= 0; ++k)
+                    {
+                        dosage = a[k] == kMissingAllele ? -1 : dosage + (a[k] != 0);
+                    }
+                    out[i] = static_cast<uint8_t>(static_cast<int8_t>(dosage));
+                    continue;
+                }
+                for (uint8_t k = 0; k < std::min<uint8_t>(p, 2); ++k)
+                {
+                    if (a[k] != 0 && a[k] != kMissingAllele)
+                    {
+                        const size_t col = 2 * i + k;
+                        out[col >> 3] |= static_cast<uint8_t>(0x80 >> (col & 7));
+                    }
+                }
+            }
+        }
+
+        // 追加 POS 之后的各列（含前导 tab，不含换行）；行号需递增，可跳行
+        void appendRow(uint32_t r, std::string &out)
+        {
+            std::string_view altText = refBlocks ? refBlockAlt(intervals->altCode(r)) : alt.values[r];
+            for (std::string_view col : {id.values[r], ref.values[r], altText, qual.values[r], filter.values[r]})
+            {
+                out += '\t';
+                out.append(col.data(), col.size());
+            }
+            if (refBlocks)
+            {
+                out += "\tEND=";
+                appendSigned(intervals->end(r), out);
+            }
+            else
+            {
+                out += '\t';
+                out.append(info.values[r].data(), info.values[r].size());
+            }
+            if (firstGroup)
+            {
+                appendSamples(r, out);
+            }
+        }
+
+        // 按列投影写出一行（不含换行）；需先 loadSamples(&projection)
+        void appendProjected(uint32_t r, const std::string &chrom, const FieldProjection &projection, std::string &out)
+        {
+            using Column = FieldProjection::Column;
+            const bool withGt = firstGroup != nullptr;
+            const bool hasGt = withGt && firstGroup->hasGt(r);
+            for (size_t g = 0; hasGt && g < gt.size(); ++g)
+            {
+                if (gt[g])
+                {
+                    gt[g]->decodeRow(r, gtRows[g]);
+                }
+            }
+            const std::vector<std::string> &keys = projection.formatKeys();
+            projectedPos.assign(keys.size(), -1);
+            if (anyGroup && !keys.empty())
+            {
+                rowFormatKeys(format.values[r], rowKeys);
+                rowKeyIds.assign(rowKeys.size(), -1);
+                for (size_t i = 0; i < keys.size(); ++i)
+                {
+                    auto it = std::find(rowKeys.begin(), rowKeys.end(), keys[i]);
+                    if (it != rowKeys.end())
+                    {
+                        projectedPos[i] = it - rowKeys.begin();
+                        rowKeyIds[projectedPos[i]] = keyId(keys[i]);
+                    }
+                }
+            }
+            auto appendGt = [&](uint32_t s)
+            {
+                const uint32_t g = groups.of(s);
+                if (hasGt)
+                {
+                    gt[g]->appender()(gtRows[g], s - groups.first(g), out);
+                }
+                else
+                {
+                    out += '.';
+                }
+            };
+
+            if (projection.tsv())
+            {
+                bool first = true;
+                for (const FieldProjection::Field &f : projection.siteFields())
+                {
+                    out += first ? "" : "\t";
+                    first = false;
+                    appendSiteField(r, chrom, f, out);
+                }
+                if (!anyGroup)
+                {
+                    return;
+                }
+                for (uint32_t s : samples)
+                {
+                    const size_t nFields = keys.empty() ? 0 : cellFields(r, s);
+                    for (const FieldProjection::Field &f : projection.sampleFields())
+                    {
+                        out += first ? "" : "\t";
+                        first = false;
+                        if (f.column == Column::Gt)
+                        {
+                            appendGt(s);
+                        }
+                        else
+                        {
+                            const size_t i = std::find(keys.begin(), keys.end(), f.key) - keys.begin();
+                            appendProjectedValue(r, s, i, nFields, out);
+                        }
+                    }
+                }
+                return;
+            }
+
+            out += chrom;
+            out += '\t';
+            appendSigned(position(r), out);
+            for (Column c : {Column::Id, Column::Ref, Column::Alt, Column::Qual, Column::Filter})
+            {
+                out += '\t';
+                if (projection.wants(c))
+                {
+                    appendSiteField(r, chrom, {c, ""}, out);
+                }
+                else
+                {
+                    out += '.';
+                }
+            }
+            out += '\t';
+            if (projection.wants(Column::Info) || projection.wants(Column::InfoKey))
+            {
+                projection.appendInfo(infoText(r), out);
+            }
+            else
+            {
+                out += '.';
+            }
+            if (!anyGroup || projection.sampleFields().empty())
+            {
+                return;
+            }
+            // FORMAT 列：GT 在前，其余为行内出现的所选键
+            out += '\t';
+            const size_t formatStart = out.size();
+            if (hasGt)
+            {
+                out += "GT";
+            }
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                if (projectedPos[i] >= 0)
+                {
+                    out += out.size() > formatStart ? ":" : "";
+                    out += keys[i];
+                }
+            }
+            if (out.size() == formatStart)
+            {
+                out += '.';
+                for (size_t i = 0; i < samples.size(); ++i)
+                {
+                    out += "\t.";
+                }
+                return;
+            }
+            for (uint32_t s : samples)
+            {
+                out += '\t';
+                const size_t nFields = keys.empty() ? 0 : cellFields(r, s);
+                bool colon = hasGt;
+                if (hasGt)
+                {
+                    appendGt(s);
+                }
+                for (size_t i = 0; i < keys.size(); ++i)
+                {
+                    if (projectedPos[i] >= 0)
+                    {
+                        out += colon ? ":" : "";
+                        colon = true;
+                        appendProjectedValue(r, s, i, nFields, out);
+                    }
+                }
+            }
+        }
+
+    private:
+        const SegmentView &block;
+        uint32_t base;
+        uint32_t nSamples;
+        bool refBlocks;
+        const std::vector<uint32_t> &samples;
+        SampleGroups groups;
+        uint32_t nRows = 0;
+
+        std::vector<int64_t> pos;
+        std::unique_ptr<RefIntervalDecoder> intervals;
+        TextColumn id, ref, alt, qual, filter, info, format;
+
+        // 按样本组索引，未选中的组为空
+        std::vector<uint8_t> usedGroups;
+        bool anyGroup = false;
+        std::vector<std::unique_ptr<GenotypeDecoder>> gt;
+        std::vector<GenotypeRow> gtRows;
+        const GenotypeDecoder *firstGroup = nullptr;
+        std::unordered_map<std::string, uint32_t> keyIndex;
+        std::vector<std::vector<std::unique_ptr<FormatKeyDecoder>>> keyDecoders;
+        std::vector<uint64_t> shapeIndex;
+        std::vector<uint32_t> shapeFields;
+        size_t shapeCursor = 0;
+        std::vector<std::string> rowKeys;
+        std::vector<int64_t> rowKeyIds;
+        std::vector<int64_t> projectedPos; // 列投影：各所选 FORMAT 键在行内的位置，-1 为行内没有
+        std::string refInfo;
+        std::vector<int64_t> mergeFrom; // 合并样本：合并后各 FORMAT 键在本行的位置，-1 为本行没有
+        std::string mergeValue;
+
+        int64_t keyId(const std::string &name) const
+        {
+            auto it = keyIndex.find(name);
+            return it == keyIndex.end() ? -1 : it->second;
+        }
+
+        // 样本格的字段数：默认与 FORMAT 键数相同，例外由形状流给出；样本需递增，shapeCursor 只前进
+        size_t cellFields(uint32_t r, uint32_t s)
+        {
+            const uint64_t cell = static_cast<uint64_t>(r) * nSamples + s;
+            while (shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] < cell)
+            {
+                ++shapeCursor;
+            }
+            if (shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] == cell)
+            {
+                return shapeFields[shapeCursor++];
+            }
+            return rowKeys.size();
+        }
+
+        // 所选 FORMAT 键第 i 个在样本格中的取值，缺失为 '.'
+        void appendProjectedValue(uint32_t r, uint32_t s, size_t i, size_t nFields, std::string &out)
+        {
+            const int64_t k = projectedPos[i];
+            if (k < 0 || static_cast<size_t>(k) >= nFields)
+            {
+                out += '.';
+                return;
+            }
+            const uint32_t g = groups.of(s);
+            keyDecoders[rowKeyIds[k]][g]->appendValue(r, s - groups.first(g), out);
+        }
+
+        // 样本格第 k 个字段的文本；行有 GT 时第 0 个字段为 GT（需先 decodeRow）
+        void appendField(uint32_t r, uint32_t s, size_t k, std::string &out)
+        {
+            const uint32_t g = groups.of(s);
+            const uint32_t local = s - groups.first(g);
+            if (k == 0 && firstGroup->hasGt(r))
+            {
+                gt[g]->appender()(gtRows[g], local, out);
+                return;
+            }
+            const int64_t key = k < rowKeys.size() ? rowKeyIds[k] : keyId(extraFieldKey(k));
+            if (key < 0)
+            {
+                throw std::runtime_error("Corrupt block: unknown FORMAT key stream");
+            }
+            keyDecoders[key][g]->appendValue(r, local, out);
+        }
+
+        // INFO 列的文本；参考块为 END=
+        std::string_view infoText(uint32_t r)
+        {
+            if (!refBlocks)
+            {
+                return info.values[r];
+            }
+            refInfo = "END=";
+            appendSigned(intervals->end(r), refInfo);
+            return refInfo;
+        }
+
+        void appendSiteField(uint32_t r, const std::string &chrom, const FieldProjection::Field &f, std::string &out)
+        {
+            using Column = FieldProjection::Column;
+            std::string_view text;
+            switch (f.column)
+            {
+            case Column::Chrom:
+                text = chrom;
+                break;
+            case Column::Pos:
+                appendSigned(position(r), out);
+                return;
+            case Column::Id:
+                text = id.values[r];
+                break;
+            case Column::Ref:
+                text = ref.values[r];
+                break;
+            case Column::Alt:
+                text = refBlocks ? refBlockAlt(intervals->altCode(r)) : alt.values[r];
+                break;
+            case Column::Qual:
+                text = qual.values[r];
+                break;
+            case Column::Filter:
+                text = filter.values[r];
+                break;
+            case Column::Info:
+                text = infoText(r);
+                break;
+            case Column::InfoKey:
+            {
+                std::string_view value;
+                text = !findInfoValue(infoText(r), f.key, value) ? "." : value.empty() ? "1" : value;
+                break;
+            }
+            default:
+                break;
+            }
+            out.append(text.data(), text.size());
+        }
+
+        // 行内是否有样本格字段数与 FORMAT 不一致；shapeCursor 只前进
+        bool rowHasShapeException(uint32_t r)
+        {
+            const uint64_t first = static_cast<uint64_t>(r) * nSamples;
+            while (shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] < first)
+            {
+                ++shapeCursor;
+            }
+            return shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] < first + nSamples;
+        }
+
+        void appendSamples(uint32_t r, std::string &out)
+        {
+            out += '\t';
+            out.append(format.values[r].data(), format.values[r].size());
+            const bool hasGt = firstGroup->hasGt(r);
+            const size_t first = hasGt ? 1 : 0;
+            if (hasGt && format.values[r] == "GT" && samples.size() == nSamples && !rowHasShapeException(r))
+            {
+                // 只有 GT 且输出全部样本：各组整行查 token 表写出
+                for (size_t g = 0; g < gt.size(); ++g)
+                {
+                    if (gt[g]->appendRowText(r, out))
+                    {
+                        continue;
+                    }
+                    gt[g]->decodeRow(r, gtRows[g]);
+                    for (uint32_t local = 0; local < gt[g]->samples(); ++local)
+                    {
+                        out += '\t';
+                        gt[g]->appender()(gtRows[g], local, out);
+                    }
+                }
+                return;
+            }
+            if (hasGt)
+            {
+                for (size_t g = 0; g < gt.size(); ++g)
+                {
+                    if (gt[g])
+                    {
+                        gt[g]->decodeRow(r, gtRows[g]);
+                    }
+                }
+            }
+            rowFormatKeys(format.values[r], rowKeys);
+            rowKeyIds.assign(rowKeys.size(), -1);
+            for (size_t k = first; k < rowKeys.size(); ++k)
+            {
+                rowKeyIds[k] = keyId(rowKeys[k]);
+            }
+            for (uint32_t s : samples)
+            {
+                const uint32_t g = groups.of(s);
+                const uint32_t local = s - groups.first(g);
+                out += '\t';
+                size_t nFields = rowKeys.size();
+                uint64_t cell = static_cast<uint64_t>(r) * nSamples + s;
+                while (shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] < cell)
+                {
+                    ++shapeCursor;
+                }
+                if (shapeCursor < shapeIndex.size() && shapeIndex[shapeCursor] == cell)
+                {
+                    nFields = shapeFields[shapeCursor++];
+                }
+                if (hasGt)
+                {
+                    gt[g]->appender()(gtRows[g], local, out);
+                }
+                for (size_t k = first; k < nFields; ++k)
+                {
+                    if (k)
+                    {
+                        out += ':';
+                    }
+                    int64_t key = k < rowKeys.size() ? rowKeyIds[k] : keyId(extraFieldKey(k));
+                    if (key < 0)
+                    {
+                        throw std::runtime_error("Corrupt block: unknown FORMAT key stream");
+                    }
+                    keyDecoders[key][g]->appendValue(r, local, out);
+                }
+            }
+        }
+    };
+
+    // 合并样本时各输入 FORMAT 键的并集，GT 在前
+    std::string unionFormat(const std::vector<std::string_view> &formats)
+    {
+        std::vector<std::string_view> keys;
+        std::vector<std::string_view> rowKeys;
+        bool hasGt = false;
+        for (std::string_view format : formats)
+        {
+            splitView(format, ':', rowKeys);
+            for (std::string_view key : rowKeys)
+            {
+                hasGt |= key == "GT";
+                if (key != "GT" && std::find(keys.begin(), keys.end(), key) == keys.end())
+                {
+                    keys.push_back(key);
+                }
+            }
+        }
+        std::string out = hasGt ? "GT" : "";
+        for (std::string_view key : keys)
+        {
+            out += out.empty() ? "" : ":";
+            out.append(key.data(), key.size());
+        }
+        return out;
+    }
+
+    // 块内第 row 行的站点计入区域图、FILTER 名表与 ID 哈希
+    void noteSite(EncodedBlock &block, std::string_view idText, const RowFields &fields, uint32_t row,
+                  bool collectIds)
+    {
+        block.zone.add(fields, variantTypeMask(fields.ref, fields.alt));
+        forEachFilter(fields.filter,
+                      [&](std::string_view name)
+                      {
+                          if (std::find(block.filters.begin(), block.filters.end(), name) == block.filters.end())
+                          {
+                              block.filters.emplace_back(name);
+                          }
+                      });
+        if (collectIds)
+        {
+            forEachId(idText, [&](std::string_view id) { block.ids.emplace_back(idHash(id), row); });
+        }
+    }
+
+    // 段表中一段的条目：行数、覆盖范围、长度与流目录 hash
+    void putSegmentEntry(ByteWriter &table, uint64_t nRows, int64_t minPos, int64_t maxPos,
+                         const std::vector<uint8_t> &segment)
+    {
+        table.putVarint(nRows);
+        table.putSVarint(minPos);
+        table.putVarint(static_cast<uint64_t>(maxPos - minPos));
+        table.putVarint(segment.size());
+        table.putU64(XXH3_64bits(segment.data(), SegmentView(segment.data(), segment.size()).directoryBytes()));
+    }
+}
+
+EncodedBlock encodeBlock(const std::vector<std::string> &lines, uint32_t nSamples, const BlockParams &params)
+{
+    return encodeRecords(lines.size(), nSamples, params,
+                         [&](size_t i, VcfRecord &rec)
+                         {
+                             if (!parseVcfRecord(lines[i], nSamples, rec))
+                             {
+                                 throw std::runtime_error("Unexpected number of columns in VCF line: " +
+                                                          lines[i].substr(0, 64));
+                             }
+                         });
+}
+
+EncodedBlock encodeRecords(size_t nRows, uint32_t nSamples, const BlockParams &params,
+                           const std::function<void(size_t, VcfRecord &)> &record)
+{
+    EncodedBlock block;
+    block.nRows = static_cast<uint32_t>(nRows);
+
+    const uint32_t groupSize = sampleGroupSize(nSamples, params.sampleGroupSize);
+    const size_t segmentRows = params.checkpointRows ? params.checkpointRows : std::max<size_t>(1, nRows);
+    VcfRecord rec;
+    ByteWriter table;
+    std::vector<uint8_t> body;
+    table.putVarint((nRows + segmentRows - 1) / segmentRows);
+
+    // 每段独立编码：POS 差分、GT 位平面与 FORMAT 矩阵都从段首重新开始，段内状态不跨段
+    for (size_t first = 0; first < nRows; first += segmentRows)
+    {
+        const size_t last = std::min(nRows, first + segmentRows);
+        RowGroupEncoder variants(nSamples, false, groupSize);
+        RowGroupEncoder refBlocks(nSamples, true, groupSize);
+        std::vector<uint64_t> refRows;
+        int64_t segMin = 0;
+        int64_t segMax = 0;
+        for (size_t i = first; i < last; ++i)
+        {
+            record(i, rec);
+            if (i == 0)
+            {
+                block.chrom = std::string(rec.chrom);
+            }
+            else if (rec.chrom != block.chrom)
+            {
+                throw std::runtime_error("Block spans more than one chromosome");
+            }
+            int64_t p = parsePos(rec.pos);
+            int64_t end = p + std::max<int64_t>(1, static_cast<int64_t>(rec.ref.size())) - 1;
+            uint8_t altCode = 0;
+            if (parseRefBlock(rec.alt, rec.info, p, end, altCode))
+            {
+                refRows.push_back(i - first);
+                refBlocks.add(rec, p, end, altCode);
+            }
+            else
+            {
+                variants.add(rec, p, end, altCode);
+            }
+            noteSite(block, rec.id, {rec.ref, rec.alt, rec.qual, rec.filter, rec.info}, static_cast<uint32_t>(i),
+                     params.collectIds);
+            // 区域查询按记录覆盖范围判断重叠：参考块到 END，其余到 REF 末端
+            segMin = i == first ? p : std::min(segMin, p);
+            segMax = i == first ? end : std::max(segMax, end);
+        }
+        block.minPos = first == 0 ? segMin : std::min(block.minPos, segMin);
+        block.maxPos = first == 0 ? segMax : std::max(block.maxPos, segMax);
+
+        BlockBuilder builder(params.codec);
+        if (nSamples > 0)
+        {
+            builder.add(static_cast<uint32_t>(StreamId::SampleGroups), SampleGroups(nSamples, groupSize).bytes());
+        }
+        variants.finish(builder, 0, params.gtLayout);
+        if (!refRows.empty())
+        {
+            ByteWriter rows;
+            IndexSet(std::move(refRows), static_cast<uint64_t>(last - first)).write(rows);
+            builder.add(static_cast<uint32_t>(StreamId::RefBlockRows), rows.data);
+            refBlocks.finish(builder, kRefBlockStreamBase, params.gtLayout);
+        }
+        std::vector<uint8_t> segment = builder.finish();
+        putSegmentEntry(table, last - first, segMin, segMax, segment);
+        body.insert(body.end(), segment.begin(), segment.end());
+    }
+    block.bytes = std::move(table.data);
+    block.bytes.insert(block.bytes.end(), body.begin(), body.end());
+    return block;
+}
+
+std::vector<uint8_t> recodeBlock(const BlockView &block, const CodecParams &codec)
+{
+    ByteWriter table;
+    std::vector<uint8_t> body;
+    table.putVarint(block.segments().size());
+    for (size_t i = 0; i < block.segments().size(); ++i)
+    {
+        const SegmentInfo &seg = block.segments()[i];
+        const SegmentView segment = block.segment(i);
+        // 流目录按编号排序，按偏移还原写入顺序
+        std::vector<StreamEntry> entries = segment.streams();
+        std::sort(entries.begin(), entries.end(),
+                  [](const StreamEntry &a, const StreamEntry &b) { return a.offset < b.offset; });
+        BlockBuilder builder(codec);
+        for (const StreamEntry &e : entries)
+        {
+            builder.add(e.id, segment.load(e.id));
+        }
+        std::vector<uint8_t> bytes = builder.finish();
+        putSegmentEntry(table, seg.nRows, seg.minPos, seg.maxPos, bytes);
+        body.insert(body.end(), bytes.begin(), bytes.end());
+    }
+    std::vector<uint8_t> out = std::move(table.data);
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+namespace
+{
+    // 段内一个行组（真实变异行或参考块行）的行数
+    uint32_t rowGroupRows(const SegmentView &segment, uint32_t base)
+    {
+        if (base == kRefBlockStreamBase)
+        {
+            return RefIntervalDecoder(segment.load(StreamId::RefInterval)).size();
+        }
+        std::vector<uint8_t> bytes = segment.load(streamId(base, StreamId::Pos));
+        ByteReader reader(bytes);
+        uint32_t n = 0;
+        for (; !reader.eof(); ++n)
+        {
+            reader.getSVarint();
+        }
+        return n;
+    }
+
+    // 一个行组的样本流按列拼接：GT 与 FORMAT 键流换编号复制，样本格形状的格号换算到合并后的样本数
+    void mergeRowGroupSamples(const std::vector<SegmentView> &segments, const std::vector<SampleGroups> &groups,
+                              const std::vector<uint32_t> &nSamples, uint32_t base, BlockBuilder &builder)
+    {
+        const uint32_t nRows = rowGroupRows(segments[0], base);
+        const uint64_t total = std::accumulate(nSamples.begin(), nSamples.end(), uint64_t(0));
+
+        // FORMAT 键名取并集；keyMap[j][k] 为第 j 块第 k 个键的新编号
+        std::vector<std::string> names;
+        std::vector<std::vector<uint32_t>> keyMap(segments.size());
+        for (size_t j = 0; j < segments.size(); ++j)
+        {
+            std::vector<uint8_t> bytes = segments[j].load(streamId(base, StreamId::FormatKeys));
+            ByteReader reader(bytes);
+            const size_t nKeys = reader.getVarint();
+            for (size_t k = 0; k < nKeys; ++k)
+            {
+                std::string name(reader.getString());
+                auto it = std::find(names.begin(), names.end(), name);
+                keyMap[j].push_back(static_cast<uint32_t>(it - names.begin()));
+                if (it == names.end())
+                {
+                    names.push_back(std::move(name));
+                }
+            }
+        }
+        ByteWriter keyNames;
+        keyNames.putVarint(names.size());
+        for (const std::string &name : names)
+        {
+            keyNames.putString(name);
+        }
+        builder.add(streamId(base, StreamId::FormatKeys), keyNames.data);
+
+        std::vector<std::pair<uint64_t, uint64_t>> shape;
+        uint32_t groupBase = 0;
+        uint64_t sampleBase = 0;
+        for (size_t j = 0; j < segments.size(); ++j)
+        {
+            const SegmentView &segment = segments[j];
+            const uint32_t nGroups = groups[j].count();
+            for (uint32_t g = 0; g < nGroups; ++g)
+            {
+                const uint32_t id = streamId(base, StreamId::Genotype);
+                builder.copy(segment, groupStreamId(id, g), groupStreamId(id, groupBase + g));
+            }
+            for (uint32_t m = 0; m < names.size(); ++m)
+            {
+                auto it = std::find(keyMap[j].begin(), keyMap[j].end(), m);
+                const uint32_t id = base + kFormatKeyStreamBase + m;
+                for (uint32_t g = 0; g < nGroups; ++g)
+                {
+                    if (it != keyMap[j].end())
+                    {
+                        const uint32_t k = static_cast<uint32_t>(it - keyMap[j].begin());
+                        builder.copy(segment, groupStreamId(base + kFormatKeyStreamBase + k, g),
+                                     groupStreamId(id, groupBase + g));
+                    }
+                    else
+                    {
+                        builder.add(groupStreamId(id, groupBase + g),
+                                    FormatKeyEncoder(groups[j].size(g)).finish(nRows));
+                    }
+                }
+            }
+            std::vector<uint8_t> bytes = segment.load(streamId(base, StreamId::SampleShape));
+            ByteReader reader(bytes);
+            const size_t nShape = reader.getVarint();
+            uint64_t cell = 0;
+            for (size_t i = 0; i < nShape; ++i)
+            {
+                cell += reader.getVarint();
+                const uint64_t row = cell / nSamples[j];
+                shape.emplace_back(row * total + sampleBase + cell % nSamples[j], reader.getVarint());
+            }
+            groupBase += nGroups;
+            sampleBase += nSamples[j];
+        }
+        std::sort(shape.begin(), shape.end());
+        ByteWriter shapeOut;
+        shapeOut.putVarint(shape.size());
+        uint64_t prev = 0;
+        for (const auto &[cell, nFields] : shape)
+        {
+            shapeOut.putVarint(cell - prev);
+            shapeOut.putVarint(nFields);
+            prev = cell;
+        }
+        builder.add(streamId(base, StreamId::SampleShape), shapeOut.data);
+    }
+}
+
+bool sameSegmentSites(const BlockView &a, size_t i, const BlockView &b, size_t k)
+{
+    const SegmentInfo &x = a.segments()[i];
+    const SegmentInfo &y = b.segments()[k];
+    if (x.nRows != y.nRows || x.minPos != y.minPos || x.maxPos != y.maxPos)
+    {
+        return false;
+    }
+    const uint32_t ids[] = {
+        streamId(0, StreamId::Pos),
+        streamId(0, StreamId::Ref),
+        streamId(0, StreamId::Alt),
+        streamId(0, StreamId::Format),
+        streamId(0, StreamId::RefBlockRows),
+        streamId(0, StreamId::RefInterval),
+        streamId(kRefBlockStreamBase, StreamId::Ref),
+        streamId(kRefBlockStreamBase, StreamId::Format),
+    };
+    const SegmentView sa = a.segment(i);
+    const SegmentView sb = b.segment(k);
+    for (uint32_t id : ids)
+    {
+        if (sa.has(id) != sb.has(id) || (sa.has(id) && sa.load(id) != sb.load(id)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameBlockSites(const BlockView &a, const BlockView &b)
+{
+    if (a.rows() != b.rows() || a.segments().size() != b.segments().size())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < a.segments().size(); ++i)
+    {
+        if (!sameSegmentSites(a, i, b, i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace
+{
+    // 按列拼接各输入对齐的一段，返回段数据
+    std::vector<uint8_t> mergeSegmentSamples(const std::vector<SegmentView> &segments,
+                                             const std::vector<uint32_t> &nSamples, const CodecParams &codec)
+    {
+        std::vector<SampleGroups> groups;
+        std::vector<uint32_t> sizes;
+        for (size_t j = 0; j < segments.size(); ++j)
+        {
+            groups.push_back(blockSampleGroups(segments[j], nSamples[j]));
+            for (uint32_t g = 0; g < groups[j].count(); ++g)
+            {
+                sizes.push_back(groups[j].size(g));
+            }
+        }
+        if (sizes.size() > kMaxSampleGroups)
+        {
+            throw std::runtime_error("Too many sample groups to merge");
+        }
+
+        BlockBuilder builder(codec);
+        builder.add(static_cast<uint32_t>(StreamId::SampleGroups), SampleGroups(sizes).bytes());
+        std::vector<StreamEntry> entries = segments[0].streams();
+        std::sort(entries.begin(), entries.end(),
+                  [](const StreamEntry &a, const StreamEntry &b) { return a.offset < b.offset; });
+        for (const StreamEntry &e : entries)
+        {
+            if (!isSampleStream(e.id) || e.id == streamId(0, StreamId::Format) ||
+                e.id == streamId(kRefBlockStreamBase, StreamId::Format))
+            {
+                builder.copy(segments[0], e.id, e.id);
+            }
+        }
+        for (uint32_t base : {0u, kRefBlockStreamBase})
+        {
+            if (segments[0].has(streamId(base, StreamId::Format)))
+            {
+                mergeRowGroupSamples(segments, groups, nSamples, base, builder);
+            }
+        }
+        return builder.finish();
+    }
+}
+
+std::vector<uint8_t> mergeBlockSamples(const std::vector<BlockView> &blocks, const std::vector<uint32_t> &nSamples,
+                                       const CodecParams &codec)
+{
+    ByteWriter table;
+    std::vector<uint8_t> body;
+    table.putVarint(blocks[0].segments().size());
+    for (size_t i = 0; i < blocks[0].segments().size(); ++i)
+    {
+        const SegmentInfo &seg = blocks[0].segments()[i];
+        std::vector<SegmentView> segments;
+        for (const BlockView &block : blocks)
+        {
+            segments.push_back(block.segment(i));
+        }
+        std::vector<uint8_t> bytes = mergeSegmentSamples(segments, nSamples, codec);
+        putSegmentEntry(table, seg.nRows, seg.minPos, seg.maxPos, bytes);
+        body.insert(body.end(), bytes.begin(), bytes.end());
+    }
+    std::vector<uint8_t> out = std::move(table.data);
+    out.insert(out.end(), body.begin(), body.end());
+    return out;
+}
+
+bool isSampleStream(uint32_t id)
+{
+    id &= 0xffff;
+    if (id >= kRefBlockStreamBase)
+    {
+        id -= kRefBlockStreamBase;
+    }
+    if (id >= kFormatKeyStreamBase)
+    {
+        return true;
+    }
+    switch (static_cast<StreamId>(id))
+    {
+    case StreamId::Format:
+    case StreamId::Genotype:
+    case StreamId::FormatKeys:
+    case StreamId::SampleShape:
+    case StreamId::SampleGroups:
+        return true;
+    default:
+        return false;
+    }
+}
+
+BlockView::BlockView(const uint8_t *data, size_t size) : data(data), size(size)
+{
+    ByteReader r(data, size);
+    size_t n = r.getVarint();
+    segs.resize(n);
+    uint32_t row = 0;
+    for (auto &seg : segs)
+    {
+        seg.firstRow = row;
+        seg.nRows = static_cast<uint32_t>(r.getVarint());
+        seg.minPos = r.getSVarint();
+        seg.maxPos = seg.minPos + static_cast<int64_t>(r.getVarint());
+        seg.size = r.getVarint();
+        seg.dirHash = r.getU64();
+        row += seg.nRows;
+    }
+    nRows = row;
+    uint64_t offset = r.position() - data;
+    tableEnd = offset;
+    for (auto &seg : segs)
+    {
+        seg.offset = offset;
+        offset += seg.size;
+    }
+    if (offset > size)
+    {
+        throw std::runtime_error("Corrupt block: segment table exceeds block size");
+    }
+}
+
+SegmentView BlockView::segment(size_t i) const
+{
+    const SegmentInfo &seg = segs.at(i);
+    SegmentView segment(data + seg.offset, seg.size);
+    if (XXH3_64bits(data + seg.offset, segment.directoryBytes()) != seg.dirHash)
+    {
+        throw std::runtime_error("Corrupt block: segment " + std::to_string(i) + " directory hash mismatch");
+    }
+    return segment;
+}
+
+size_t BlockView::segmentOfRow(uint32_t row) const
+{
+    auto it = std::upper_bound(segs.begin(), segs.end(), row,
+                               [](uint32_t r, const SegmentInfo &seg) { return r < seg.firstRow; });
+    if (it == segs.begin() || row >= nRows)
+    {
+        throw std::runtime_error("Block row out of range: " + std::to_string(row));
+    }
+    return static_cast<size_t>(it - segs.begin()) - 1;
+}
+
+SampleGroups blockSampleGroups(const BlockView &block, uint32_t nSamples)
+{
+    return block.segments().empty() ? SampleGroups(nSamples, std::max<uint32_t>(1, nSamples))
+                                    : blockSampleGroups(block.segment(0), nSamples);
+}
+
+SegmentView::SegmentView(const uint8_t *data, size_t size) : data(data), size(size)
+{
+    ByteReader r(data, size);
+    size_t n = r.getVarint();
+    entries.resize(n);
+    for (auto &e : entries)
+    {
+        e.id = static_cast<uint32_t>(r.getVarint());
+        e.codec = static_cast<Codec>(r.getU8());
+        e.rawSize = r.getVarint();
+        e.size = r.getVarint();
+        e.hash = r.getU64();
+    }
+    uint64_t offset = r.position() - data;
+    dirEnd = offset;
+    for (auto &e : entries)
+    {
+        e.offset = offset;
+        offset += e.size;
+    }
+    if (offset > size)
+    {
+        throw std::runtime_error("Corrupt block: stream directory exceeds segment size");
+    }
+    // 样本分组后一块可有上千个流，按编号排序以便二分查找
+    std::sort(entries.begin(), entries.end(), [](const StreamEntry &a, const StreamEntry &b) { return a.id < b.id; });
+}
+
+const StreamEntry *SegmentView::find(uint32_t id) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), id,
+                               [](const StreamEntry &e, uint32_t v) { return e.id < v; });
+    return it != entries.end() && it->id == id ? &*it : nullptr;
+}
+
+const StreamEntry &SegmentView::entry(uint32_t id) const
+{
+    const StreamEntry *e = find(id);
+    if (!e)
+    {
+        throw std::runtime_error("Missing stream " + std::to_string(id) + " in block");
+    }
+    return *e;
+}
+
+SampleGroups::SampleGroups(uint32_t nSamples, uint32_t groupSize) : uniform(std::max<uint32_t>(1, groupSize))
+{
+    while (starts.back() < nSamples)
+    {
+        starts.push_back(starts.back() + std::min(uniform, nSamples - starts.back()));
+    }
+}
+
+SampleGroups::SampleGroups(const std::vector<uint32_t> &sizes)
+{
+    for (uint32_t size : sizes)
+    {
+        if (size == 0)
+        {
+            throw std::runtime_error("Corrupt block: empty sample group");
+        }
+        starts.push_back(starts.back() + size);
+    }
+    // 除最后一组外等长且最后一组不更长时，仍按等长组存放与查找
+    if (sizes.empty() ||
+        (std::all_of(sizes.begin(), sizes.end() - 1, [&](uint32_t n) { return n == sizes[0]; }) &&
+         sizes.back() <= sizes[0]))
+    {
+        uniform = sizes.empty() ? 1 : sizes[0];
+        return;
+    }
+    uniform = 0;
+    groupOf.resize(samples());
+    for (uint32_t g = 0; g < count(); ++g)
+    {
+        std::fill(groupOf.begin() + first(g), groupOf.begin() + first(g) + size(g), g);
+    }
+}
+
+std::vector<uint8_t> SampleGroups::bytes() const
+{
+    ByteWriter w;
+    w.putVarint(uniform);
+    if (uniform == 0)
+    {
+        w.putVarint(count());
+        for (uint32_t g = 0; g < count(); ++g)
+        {
+            w.putVarint(size(g));
+        }
+    }
+    return std::move(w.data);
+}
+
+SampleGroups blockSampleGroups(const SegmentView &block, uint32_t nSamples)
+{
+    if (!block.has(StreamId::SampleGroups))
+    {
+        return SampleGroups(nSamples, std::max<uint32_t>(1, nSamples));
+    }
+    std::vector<uint8_t> bytes = block.load(StreamId::SampleGroups);
+    ByteReader r(bytes);
+    uint64_t size = r.getVarint();
+    if (size > UINT32_MAX)
+    {
+        throw std::runtime_error("Corrupt block: invalid sample group size");
+    }
+    if (size != 0)
+    {
+        return SampleGroups(nSamples, static_cast<uint32_t>(size));
+    }
+    const uint64_t count = r.getVarint();
+    if (count > kMaxSampleGroups)
+    {
+        throw std::runtime_error("Corrupt block: too many sample groups");
+    }
+    std::vector<uint32_t> sizes(count);
+    for (uint32_t &n : sizes)
+    {
+        n = static_cast<uint32_t>(r.getVarint());
+    }
+    SampleGroups groups(sizes);
+    if (groups.samples() != nSamples)
+    {
+        throw std::runtime_error("Corrupt block: sample groups do not cover all samples");
+    }
+    return groups;
+}
+
+bool SegmentView::has(uint32_t id) const
+{
+    return find(id) != nullptr;
+}
+
+std::vector<uint8_t> SegmentView::load(uint32_t id) const
+{
+    const StreamEntry *e = find(id);
+    if (!e)
+    {
+        throw std::runtime_error("Missing stream " + std::to_string(id) + " in block");
+    }
+    if (XXH3_64bits(data + e->offset, e->size) != e->hash)
+    {
+        throw std::runtime_error("Stream " + std::to_string(id) + " hash mismatch");
+    }
+    return decompressStream(e->codec, data + e->offset, e->size, e->rawSize);
+}
+
+void TextColumn::load(const SegmentView &segment, uint32_t id, uint32_t nRows)
+{
+    buf = segment.load(id);
+    values.clear();
+    values.reserve(nRows);
+    std::string_view all(reinterpret_cast<const char *>(buf.data()), buf.size());
+    size_t start = 0;
+    for (uint32_t i = 0; i < nRows; ++i)
+    {
+        size_t nl = all.find('\n', start);
+        if (nl == std::string_view::npos)
+        {
+            throw std::runtime_error("Corrupt text stream: fewer rows than expected");
+        }
+        values.push_back(all.substr(start, nl - start));
+        start = nl + 1;
+    }
+}
+
+bool overlapsAny(const std::vector<PositionRange> &ranges, int64_t pos, int64_t stop)
+{
+    // 区间互不重叠时终点也递增：找第一个终点 >= pos 的区间
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), pos,
+                               [](const PositionRange &r, int64_t v) { return r.second < v; });
+    return it != ranges.end() && it->first <= stop;
+}
+
+void renderBlockVcf(const BlockView &block, const std::string &chrom, uint32_t nSamples, std::string &out)
+{
+    renderBlockVcf(block, chrom, nSamples, RenderOptions(), out);
+}
+
+namespace
+{
+    // 需要加载的站点文本列：列投影所选的列，加上区域判断与行范围记录用的 REF、--where 用的各列
+    uint8_t siteColumns(const RenderOptions &options)
+    {
+        if (!options.fields || options.where)
+        {
+            return kAllSiteColumns;
+        }
+        using Column = FieldProjection::Column;
+        uint8_t columns = options.ranges || options.rows ? kSiteRef : 0;
+        for (const FieldProjection::Field &f : options.fields->siteFields())
+        {
+            switch (f.column)
+            {
+            case Column::Id:
+                columns |= kSiteId;
+                break;
+            case Column::Ref:
+                columns |= kSiteRef;
+                break;
+            case Column::Alt:
+                columns |= kSiteAlt;
+                break;
+            case Column::Qual:
+                columns |= kSiteQual;
+                break;
+            case Column::Filter:
+                columns |= kSiteFilter;
+                break;
+            case Column::Info:
+            case Column::InfoKey:
+                columns |= kSiteInfo;
+                break;
+            default:
+                break;
+            }
+        }
+        return columns;
+    }
+
+    // 段内的变异行组与参考块行组，以及按 RenderOptions 的站点条件选出的行（段内顺序）
+    struct SelectedRows
+    {
+        struct Row
+        {
+            RowGroupDecoder *group;
+            uint32_t row;
+        };
+
+        std::unique_ptr<RowGroupDecoder> variants;
+        std::unique_ptr<RowGroupDecoder> refBlocks;
+        std::vector<Row> rows;
+        bool anyVariant = false;
+        bool anyRef = false;
+
+        // options.blockRows 此处为段内行号
+        SelectedRows(const SegmentView &segment, uint32_t nSamples, const std::vector<uint32_t> &samples,
+                     const RenderOptions &options)
+        {
+            const uint8_t columns = siteColumns(options);
+            variants = std::make_unique<RowGroupDecoder>(segment, 0, false, nSamples, samples, columns);
+            IndexSet refRows;
+            if (segment.has(StreamId::RefBlockRows))
+            {
+                std::vector<uint8_t> bytes = segment.load(StreamId::RefBlockRows);
+                ByteReader rr(bytes);
+                refRows = IndexSet::read(rr);
+                refBlocks =
+                    std::make_unique<RowGroupDecoder>(segment, kRefBlockStreamBase, true, nSamples, samples, columns);
+            }
+            const uint32_t nRows = variants->rows() + (refBlocks ? refBlocks->rows() : 0);
+
+            uint32_t nextVariant = 0;
+            uint32_t nextRef = 0;
+            for (uint32_t r = 0; r < nRows; ++r)
+            {
+                bool isRef = refBlocks && refRows.contains(r);
+                RowGroupDecoder &group = isRef ? *refBlocks : *variants;
+                uint32_t gr = isRef ? nextRef++ : nextVariant++;
+                if (gr >= group.rows())
+                {
+                    throw std::runtime_error("Corrupt block: row groups do not match");
+                }
+                if (options.blockRows && !std::binary_search(options.blockRows->begin(), options.blockRows->end(), r))
+                {
+                    continue;
+                }
+                if (options.ranges && !overlapsAny(*options.ranges, group.position(gr), group.stop(gr)))
+                {
+                    continue;
+                }
+                if (options.where && !options.where->matches(group.fields(gr)))
+                {
+                    continue;
+                }
+                rows.push_back({&group, gr});
+                (isRef ? anyRef : anyVariant) = true;
+            }
+        }
+    };
+
+    // 由段表判断段内是否可能有输出行；blockRows 非空时把落在段内的行换算为段内行号写入 localRows
+    bool segmentWanted(const SegmentInfo &seg, const RenderOptions &options, std::vector<uint32_t> &localRows)
+    {
+        if (options.ranges && !overlapsAny(*options.ranges, seg.minPos, seg.maxPos))
+        {
+            return false;
+        }
+        if (!options.blockRows)
+        {
+            return true;
+        }
+        localRows.clear();
+        auto it = std::lower_bound(options.blockRows->begin(), options.blockRows->end(), seg.firstRow);
+        for (; it != options.blockRows->end() && *it < seg.firstRow + seg.nRows; ++it)
+        {
+            localRows.push_back(*it - seg.firstRow);
+        }
+        return !localRows.empty();
+    }
+}
+
+void renderBlockVcf(const BlockView &block, const std::string &chrom, uint32_t nSamples, const RenderOptions &options,
+                    std::string &out)
+{
+    std::vector<uint32_t> allSamples;
+    if (!options.samples)
+    {
+        allSamples.resize(nSamples);
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            allSamples[s] = s;
+        }
+    }
+    const std::vector<uint32_t> &samples = options.samples ? *options.samples : allSamples;
+
+    std::vector<uint32_t> localRows;
+    for (const SegmentInfo &seg : block.segments())
+    {
+        // 段表先排除整段，单行查询只解码所在的段
+        if (!segmentWanted(seg, options, localRows))
+        {
+            continue;
+        }
+        RenderOptions local = options;
+        local.blockRows = options.blockRows ? &localRows : nullptr;
+        const SegmentView segment = block.segment(&seg - block.segments().data());
+
+        // 先按站点列选出输出行，只为有输出行的行组加载样本流
+        SelectedRows selected(segment, nSamples, samples, local);
+        if (selected.anyVariant)
+        {
+            selected.variants->loadSamples(options.fields);
+        }
+        if (selected.anyRef)
+        {
+            selected.refBlocks->loadSamples(options.fields);
+        }
+
+        for (const SelectedRows::Row &sel : selected.rows)
+        {
+            RowGroupDecoder &group = *sel.group;
+            const uint32_t gr = sel.row;
+            const size_t offset = out.size();
+            if (options.fields)
+            {
+                group.appendProjected(gr, chrom, *options.fields, out);
+            }
+            else
+            {
+                out += chrom;
+                out += '\t';
+                appendSigned(group.position(gr), out);
+                group.appendRow(gr, out);
+            }
+            out += '\n';
+            if (options.rows)
+            {
+                options.rows->push_back({offset, out.size() - offset, group.position(gr), group.stop(gr)});
+            }
+        }
+    }
+}
+
+struct DecodedSegment::State
+{
+    SegmentView segment;
+    std::vector<uint32_t> samples;
+    SelectedRows selected;
+
+    State(const SegmentView &view, uint32_t nSamples)
+        : segment(view), samples(iotaSamples(nSamples)), selected(segment, nSamples, samples, RenderOptions())
+    {
+        if (selected.anyVariant)
+        {
+            selected.variants->loadSamples();
+        }
+        if (selected.anyRef)
+        {
+            selected.refBlocks->loadSamples();
+        }
+    }
+
+    static std::vector<uint32_t> iotaSamples(uint32_t n)
+    {
+        std::vector<uint32_t> samples(n);
+        std::iota(samples.begin(), samples.end(), 0u);
+        return samples;
+    }
+};
+
+DecodedSegment::DecodedSegment(const SegmentView &segment, uint32_t nSamples)
+    : state(std::make_unique<State>(segment, nSamples))
+{
+}
+
+DecodedSegment::~DecodedSegment() = default;
+
+uint32_t DecodedSegment::rows() const
+{
+    return static_cast<uint32_t>(state->selected.rows.size());
+}
+
+int64_t DecodedSegment::position(uint32_t r) const
+{
+    const SelectedRows::Row &row = state->selected.rows[r];
+    return row.group->position(row.row);
+}
+
+std::string_view DecodedSegment::ref(uint32_t r) const
+{
+    const SelectedRows::Row &row = state->selected.rows[r];
+    return row.group->fields(row.row).ref;
+}
+
+std::string_view DecodedSegment::alt(uint32_t r) const
+{
+    const SelectedRows::Row &row = state->selected.rows[r];
+    return row.group->fields(row.row).alt;
+}
+
+struct MergedBlockBuilder::State
+{
+    std::vector<uint32_t> nSamples;
+    uint32_t totalSamples = 0;
+    uint32_t groupSize = 0;
+    BlockParams params;
+
+    // 已完成的段
+    EncodedBlock block;
+    ByteWriter table;
+    std::vector<uint8_t> body;
+    uint64_t nSegments = 0;
+
+    // 逐行合并中的段；carrier 为段内各行站点所在的输入段，各行依次取自其第 0 行起的连续行时 carrierRows 为真
+    std::unique_ptr<RowGroupEncoder> variants;
+    std::unique_ptr<RowGroupEncoder> refBlocks;
+    std::vector<uint64_t> refRows;
+    uint32_t segRows = 0;
+    int64_t segMin = 0;
+    int64_t segMax = 0;
+    const DecodedSegment *carrier = nullptr;
+    uint32_t carrierNext = 0;
+    bool carrierRows = false;
+
+    std::vector<std::string_view> formats;
+    std::string format;
+    std::vector<std::string_view> keys;
+
+    // 块内一行的站点统计与覆盖范围
+    void noteRow(std::string_view idText, const RowFields &fields, int64_t pos, int64_t stop)
+    {
+        noteSite(block, idText, fields, block.nRows, params.collectIds);
+        block.minPos = block.nRows == 0 ? pos : std::min(block.minPos, pos);
+        block.maxPos = block.nRows == 0 ? stop : std::max(block.maxPos, stop);
+        ++block.nRows;
+    }
+
+    void addSegment(uint64_t nRows, int64_t minPos, int64_t maxPos, const std::vector<uint8_t> &segment)
+    {
+        putSegmentEntry(table, nRows, minPos, maxPos, segment);
+        body.insert(body.end(), segment.begin(), segment.end());
+        ++nSegments;
+    }
+
+    // 结束逐行合并中的段；copySites 为真时站点流原样复制 carrier 段的
+    void closeSegment(bool copySites)
+    {
+        if (segRows == 0)
+        {
+            return;
+        }
+        BlockBuilder builder(params.codec);
+        builder.add(static_cast<uint32_t>(StreamId::SampleGroups), SampleGroups(totalSamples, groupSize).bytes());
+        if (copySites)
+        {
+            const SegmentView &segment = carrier->state->segment;
+            std::vector<StreamEntry> entries = segment.streams();
+            std::sort(entries.begin(), entries.end(),
+                      [](const StreamEntry &a, const StreamEntry &b) { return a.offset < b.offset; });
+            for (const StreamEntry &e : entries)
+            {
+                if (!isSampleStream(e.id))
+                {
+                    builder.copy(segment, e.id, e.id);
+                }
+            }
+        }
+        variants->finish(builder, 0, params.gtLayout, !copySites);
+        if (!refRows.empty())
+        {
+            if (!copySites)
+            {
+                ByteWriter rows;
+                IndexSet(std::move(refRows), segRows).write(rows);
+                builder.add(static_cast<uint32_t>(StreamId::RefBlockRows), rows.data);
+            }
+            refBlocks->finish(builder, kRefBlockStreamBase, params.gtLayout, !copySites);
+        }
+        addSegment(segRows, segMin, segMax, builder.finish());
+        refRows.clear();
+        segRows = 0;
+    }
+};
+
+MergedBlockBuilder::MergedBlockBuilder(const std::vector<uint32_t> &nSamples, const BlockParams &params)
+    : state(std::make_unique<State>())
+{
+    state->nSamples = nSamples;
+    state->totalSamples = std::accumulate(nSamples.begin(), nSamples.end(), 0u);
+    state->groupSize = sampleGroupSize(state->totalSamples, params.sampleGroupSize);
+    state->params = params;
+}
+
+MergedBlockBuilder::~MergedBlockBuilder() = default;
+
+uint32_t MergedBlockBuilder::rows() const
+{
+    return state->block.nRows;
+}
+
+void MergedBlockBuilder::addSegment(const std::vector<BlockView> &blocks, const std::vector<size_t> &segments)
+{
+    State &st = *state;
+    st.closeSegment(false);
+    std::vector<SegmentView> views;
+    for (size_t j = 0; j < blocks.size(); ++j)
+    {
+        views.push_back(blocks[j].segment(segments[j]));
+    }
+    const SegmentInfo &seg = blocks[0].segments()[segments[0]];
+    st.addSegment(seg.nRows, seg.minPos, seg.maxPos, mergeSegmentSamples(views, st.nSamples, st.params.codec));
+
+    // 站点一致，区域图、FILTER 与 ID 只需第一个输入的站点列
+    const std::vector<uint32_t> none;
+    const SelectedRows sites(views[0], st.nSamples[0], none, RenderOptions());
+    for (const SelectedRows::Row &row : sites.rows)
+    {
+        RowGroupDecoder &group = *row.group;
+        st.noteRow(group.idText(row.row), group.fields(row.row), group.position(row.row), group.stop(row.row));
+    }
+}
+
+void MergedBlockBuilder::addRow(const std::vector<MergeRowPart> &parts)
+{
+    State &st = *state;
+    const MergeRowPart &site =
+        *std::find_if(parts.begin(), parts.end(), [](const MergeRowPart &p) { return p.segment != nullptr; });
+    const SelectedRows::Row &siteRow = site.segment->state->selected.rows[site.row];
+    RowGroupDecoder &from = *siteRow.group;
+    const uint32_t r = siteRow.row;
+
+    if (st.segRows == 0)
+    {
+        st.variants = std::make_unique<RowGroupEncoder>(st.totalSamples, false, st.groupSize);
+        st.refBlocks = std::make_unique<RowGroupEncoder>(st.totalSamples, true, st.groupSize);
+        st.carrier = site.segment;
+        st.carrierNext = 0;
+        st.carrierRows = true;
+    }
+    st.carrierRows = st.carrierRows && st.carrier == site.segment && st.carrierNext == site.row;
+    ++st.carrierNext;
+
+    const RowFields fields = from.fields(r);
+    const int64_t pos = from.position(r);
+    const int64_t stop = from.stop(r);
+    if (from.isRefBlocks())
+    {
+        st.refRows.push_back(st.segRows);
+    }
+    RowGroupEncoder &out = from.isRefBlocks() ? *st.refBlocks : *st.variants;
+    out.addSite(from.idText(r), fields, pos, stop, from.altCode(r));
+
+    // FORMAT：各输入相同时沿用，否则取键的并集（GT 在前）
+    st.formats.clear();
+    for (const MergeRowPart &p : parts)
+    {
+        if (p.segment)
+        {
+            const SelectedRows::Row &row = p.segment->state->selected.rows[p.row];
+            st.formats.push_back(row.group->formatText(row.row));
+        }
+    }
+    const bool sameFormat = std::all_of(st.formats.begin(), st.formats.end(),
+                                        [&](std::string_view f) { return f == st.formats[0]; });
+    st.format = sameFormat ? std::string(st.formats[0]) : unionFormat(st.formats);
+    splitView(st.format, ':', st.keys);
+    out.beginSamples(st.format);
+    uint32_t firstSample = 0;
+    for (size_t j = 0; j < parts.size(); ++j)
+    {
+        if (parts[j].segment)
+        {
+            // FORMAT 与合并后相同的输入样本格原样保留
+            const SelectedRows::Row &row = parts[j].segment->state->selected.rows[parts[j].row];
+            const bool same = sameFormat || row.group->formatText(row.row) == st.format;
+            row.group->mergeSamplesInto(row.row, out, firstSample, same ? nullptr : &st.keys);
+        }
+        else
+        {
+            out.addMissingCells(firstSample, st.nSamples[j]);
+        }
+        firstSample += st.nSamples[j];
+    }
+    out.endRow();
+
+    st.segMin = st.segRows == 0 ? pos : std::min(st.segMin, pos);
+    st.segMax = st.segRows == 0 ? stop : std::max(st.segMax, stop);
+    ++st.segRows;
+    st.noteRow(from.idText(r), fields, pos, stop);
+    if (st.carrierRows && st.carrierNext == st.carrier->rows())
+    {
+        st.closeSegment(true);
+    }
+    else if (st.params.checkpointRows && st.segRows >= st.params.checkpointRows)
+    {
+        st.closeSegment(false);
+    }
+}
+
+EncodedBlock MergedBlockBuilder::finish(const std::string &chrom)
+{
+    State &st = *state;
+    st.closeSegment(false);
+    EncodedBlock out = std::move(st.block);
+    out.chrom = chrom;
+    ByteWriter head;
+    head.putVarint(st.nSegments);
+    out.bytes = std::move(head.data);
+    out.bytes.insert(out.bytes.end(), st.table.data.begin(), st.table.data.end());
+    out.bytes.insert(out.bytes.end(), st.body.begin(), st.body.end());
+    st.block = EncodedBlock();
+    st.table = ByteWriter();
+    st.body.clear();
+    st.nSegments = 0;
+    return out;
+}
+
+uint32_t countBlockRows(const BlockView &block, uint32_t nSamples, const RenderOptions &options)
+{
+    const std::vector<uint32_t> noSamples;
+    std::vector<uint32_t> localRows;
+    uint32_t n = 0;
+    for (const SegmentInfo &seg : block.segments())
+    {
+        if (!segmentWanted(seg, options, localRows))
+        {
+            continue;
+        }
+        // 段完全落在某个区间内且没有其他条件时直接取段表中的行数
+        if (!options.where && !options.blockRows && options.ranges)
+        {
+            auto it = std::upper_bound(options.ranges->begin(), options.ranges->end(), seg.minPos,
+                                       [](int64_t pos, const PositionRange &r) { return pos < r.first; });
+            if (it != options.ranges->begin() && std::prev(it)->second >= seg.maxPos)
+            {
+                n += seg.nRows;
+                continue;
+            }
+        }
+        RenderOptions local = options;
+        local.blockRows = options.blockRows ? &localRows : nullptr;
+        const SegmentView segment = block.segment(&seg - block.segments().data());
+        n += static_cast<uint32_t>(SelectedRows(segment, nSamples, noSamples, local).rows.size());
+    }
+    return n;
+}
+
+void packBlockPlink(const BlockView &block, const std::string &chrom, uint32_t nSamples, PlinkRows &out)
+{
+    std::vector<uint32_t> allSamples(nSamples);
+    for (uint32_t s = 0; s < nSamples; ++s)
+    {
+        allSamples[s] = s;
+    }
+    const size_t rowBytes = (static_cast<size_t>(nSamples) + 3) / 4;
+    std::vector<uint8_t> scratch;
+    for (size_t i = 0; i < block.segments().size(); ++i)
+    {
+        const SegmentView segment = block.segment(i);
+        RowGroupDecoder variants(segment, 0, false, nSamples, allSamples);
+        out.skipped += block.segments()[i].nRows - variants.rows();
+        variants.loadGenotypes();
+        for (uint32_t r = 0; r < variants.rows(); ++r)
+        {
+            const RowFields f = variants.fields(r);
+            if (f.alt.find(',') != std::string_view::npos)
+            {
+                ++out.skipped;
+                continue;
+            }
+            // chrom  ID  cM  POS  A1(ALT)  A2(REF)
+            out.bim += chrom;
+            out.bim += '\t';
+            out.bim += variants.idText(r);
+            out.bim += "\t0\t";
+            appendSigned(variants.position(r), out.bim);
+            out.bim += '\t';
+            out.bim += f.alt == "." ? std::string_view("0") : f.alt;
+            out.bim += '\t';
+            out.bim += f.ref;
+            out.bim += '\n';
+            out.bed.resize(out.bed.size() + rowBytes);
+            variants.packPlinkRow(r, out.bed.data() + out.bed.size() - rowBytes, scratch);
+            ++out.variants;
+        }
+    }
+}
+
+uint32_t packBlockMatrix(const BlockView &block, uint32_t nSamples, const RenderOptions &options, MatrixKind kind,
+                         uint8_t *out)
+{
+    std::vector<uint32_t> allSamples;
+    if (!options.samples)
+    {
+        allSamples.resize(nSamples);
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            allSamples[s] = s;
+        }
+    }
+    const std::vector<uint32_t> &samples = options.samples ? *options.samples : allSamples;
+    const size_t rowBytes = matrixRowBytes(kind, samples.size());
+
+    std::vector<uint32_t> localRows;
+    uint32_t n = 0;
+    for (const SegmentInfo &seg : block.segments())
+    {
+        if (!segmentWanted(seg, options, localRows))
+        {
+            continue;
+        }
+        RenderOptions local = options;
+        local.blockRows = options.blockRows ? &localRows : nullptr;
+        const SegmentView segment = block.segment(&seg - block.segments().data());
+        SelectedRows selected(segment, nSamples, samples, local);
+        if (selected.anyVariant)
+        {
+            selected.variants->loadGenotypes();
+        }
+        if (selected.anyRef)
+        {
+            selected.refBlocks->loadGenotypes();
+        }
+        for (const SelectedRows::Row &sel : selected.rows)
+        {
+            sel.group->packMatrixRow(sel.row, kind, out + static_cast<size_t>(n) * rowBytes);
+            ++n;
+        }
+    }
+    return n;
+}
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "codec.hpp"
+#include "genotype.hpp"
+#include "vcf.hpp"
+#include "zone_map.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 块内字段流编号，写入文件，不可修改已有取值
+enum class StreamId : uint16_t
+{
+    Pos = 1,
+    Id = 2,
+    Ref = 3,
+    Alt = 4,
+    Qual = 5,
+    Filter = 6,
+    Info = 7,
+    Format = 8,
+    Genotype = 9,
+    FormatKeys = 10,  // 块内出现的 FORMAT 键（GT 除外）名表
+    SampleShape = 11, // 样本格字段数与 FORMAT 键数不一致的例外
+    RefBlockRows = 12, // gVCF 参考块所在行
+    RefInterval = 13,  // 参考块区间流
+    SampleGroups = 14, // 样本组大小
+};
+
+// 第 k 个 FORMAT 键的列流编号
+constexpr uint32_t kFormatKeyStreamBase = 0x100;
+
+// gVCF 参考块行组的流编号偏移（ID/REF/QUAL/FILTER/FORMAT/样本列）
+constexpr uint32_t kRefBlockStreamBase = 0x1000;
+
+// 样本分组：GT 与各 FORMAT 键流按连续样本组拆开，第 g 组的流编号为 编号 | (g << 16)，
+// 按样本子集解码时只读取所选样本所在的组
+constexpr uint32_t kDefaultSampleGroupSize = 1024;
+
+// 组号占流编号的高 16 位，一段最多 0xffff 组
+constexpr uint32_t kMaxSampleGroups = 0xffff;
+
+// 实际使用的组大小：组数超过 kMaxSampleGroups 时加大组大小
+inline uint32_t sampleGroupSize(uint32_t nSamples, uint32_t requested)
+{
+    const uint32_t size = std::max<uint32_t>(1, requested);
+    const uint32_t minSize = static_cast<uint32_t>((static_cast<uint64_t>(nSamples) + kMaxSampleGroups - 1) /
+                                                   kMaxSampleGroups);
+    return std::max(size, minSize);
+}
+
+inline uint32_t groupStreamId(uint32_t id, uint32_t group)
+{
+    return id | (group << 16);
+}
+
+struct BlockParams
+{
+    CodecParams codec;
+    GenotypeLayout gtLayout = GenotypeLayout::VariantMajor; // GT 位平面布局
+    uint32_t sampleGroupSize = kDefaultSampleGroupSize;
+    bool collectIds = false; // 收集 ID 哈希供文件级 ID 索引使用
+    uint32_t checkpointRows = 0; // 行检查点间隔：每 N 行切成独立编码的段，0 表示整块一段
+};
+
+// 样本列的流（FORMAT、GT、各 FORMAT 键、样本格形状与样本组大小，含参考块行组与各样本组的流）；其余为站点列
+bool isSampleStream(uint32_t id);
+
+// 字段流在段数据中的位置（offset 相对段起点）；hash 为压缩后字节的 XXH3，加载时校验，
+// 只校验段表的块视图（BlockPart::Partial）由此只读入并校验实际加载的流
+struct StreamEntry
+{
+    uint32_t id = 0;
+    Codec codec = Codec::Store;
+    uint64_t rawSize = 0;
+    uint64_t offset = 0;
+    uint64_t size = 0;
+    uint64_t hash = 0;
+};
+
+struct EncodedBlock
+{
+    std::string chrom;
+    uint32_t nRows = 0;
+    int64_t minPos = 0;
+    int64_t maxPos = 0;
+    std::vector<uint8_t> bytes;
+    std::vector<std::pair<uint64_t, uint32_t>> ids; // (ID 哈希, 块内行号)，仅 collectIds 时填写
+    ZoneMap zone;                     // QUAL/AF 范围与类型位；FILTER 位由写入端按文件级名表设置
+    std::vector<std::string> filters; // 块内出现的 FILTER 名，按首次出现顺序
+};
+
+// 编码一个块；lines 为同一条染色体上的连续数据行
+EncodedBlock encodeBlock(const std::vector<std::string> &lines, uint32_t nSamples, const BlockParams &params);
+
+// 逐行取已切分的记录编码一个块；record(i, rec) 按 i 递增调用，rec 中的视图在取下一行前有效
+EncodedBlock encodeRecords(size_t nRows, uint32_t nSamples, const BlockParams &params,
+                           const std::function<void(size_t, VcfRecord &)> &record);
+
+// 段数据视图：解析流目录，按需校验并解压单个字段流
+class SegmentView
+{
+public:
+    SegmentView(const uint8_t *data, size_t size);
+
+    bool has(StreamId id) const { return has(static_cast<uint32_t>(id)); }
+    std::vector<uint8_t> load(StreamId id) const { return load(static_cast<uint32_t>(id)); }
+    bool has(uint32_t id) const;
+    std::vector<uint8_t> load(uint32_t id) const;
+    const std::vector<StreamEntry> &streams() const { return entries; }
+
+    // 流目录项与压缩字节（未校验），供原样复制；没有该流时抛出异常
+    const StreamEntry &entry(uint32_t id) const;
+    const uint8_t *payload(const StreamEntry &e) const { return data + e.offset; }
+
+    // 流目录（段首到第一个流）的字节数，段表中的流目录 hash 覆盖这段字节
+    uint64_t directoryBytes() const { return dirEnd; }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    uint64_t dirEnd = 0;
+    std::vector<StreamEntry> entries;
+
+    const StreamEntry *find(uint32_t id) const;
+};
+
+// 行检查点：块按每 checkpointRows 行切成段，各段的字段流独立编码（POS 差分、GT 位平面、
+// FORMAT 矩阵都从段首开始），段表记录每段的行数、覆盖范围与字节范围。
+// 块布局：段数 (varint) | 每段：行数 (varint) + minPos (svarint) + maxPos - minPos (varint) + 长度 (varint)
+//         + 流目录 hash (u64) | 各段数据
+struct SegmentInfo
+{
+    uint32_t firstRow = 0;
+    uint32_t nRows = 0;
+    int64_t minPos = 0;
+    int64_t maxPos = 0;
+    uint64_t offset = 0; // 相对块起点
+    uint64_t size = 0;
+    uint64_t dirHash = 0; // 段的流目录的 XXH3，取段时校验
+};
+
+// 块数据视图：解析段表，按需取单个段
+class BlockView
+{
+public:
+    BlockView(const uint8_t *data, size_t size);
+
+    uint32_t rows() const { return nRows; }
+    const std::vector<SegmentInfo> &segments() const { return segs; }
+    // 第 i 段的视图，校验其流目录 hash
+    SegmentView segment(size_t i) const;
+
+    // 块内行号所在的段
+    size_t segmentOfRow(uint32_t row) const;
+
+    // 段表（块首到第一段）的字节数，索引中的段表 hash 覆盖这段字节
+    uint64_t tableBytes() const { return tableEnd; }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    uint32_t nRows = 0;
+    uint64_t tableEnd = 0;
+    std::vector<SegmentInfo> segs;
+};
+
+// 以新的编码器重新压缩块内每个字段流（逐流校验、解压后再压缩），段表、流编号与流顺序不变
+std::vector<uint8_t> recodeBlock(const BlockView &block, const CodecParams &codec);
+
+// a 的第 i 段与 b 的第 k 段的行数、POS/REF/ALT、参考块区间与 FORMAT 列完全一致，样本可按列直接拼接
+bool sameSegmentSites(const BlockView &a, size_t i, const BlockView &b, size_t k);
+
+// 两块的段划分一致且各段 sameSegmentSites
+bool sameBlockSites(const BlockView &a, const BlockView &b);
+
+// 按列拼接各块的样本（各块需与第一块 sameBlockSites）：站点流与 FORMAT 列取第一块的压缩字节，
+// 各块的 GT 与 FORMAT 键流原样复制并依次编排样本组，FORMAT 键名取并集，块中没有的键补空流
+std::vector<uint8_t> mergeBlockSamples(const std::vector<BlockView> &blocks, const std::vector<uint32_t> &nSamples,
+                                       const CodecParams &codec);
+
+// merge-samples 逐行合并时一个输入的一段：解码全部站点列与样本列；行号为段内顺序
+class DecodedSegment
+{
+public:
+    DecodedSegment(const SegmentView &segment, uint32_t nSamples);
+    ~DecodedSegment();
+
+    uint32_t rows() const;
+    int64_t position(uint32_t r) const;
+    // 参考块行的 ALT 为符号等位基因
+    std::string_view ref(uint32_t r) const;
+    std::string_view alt(uint32_t r) const;
+
+private:
+    friend class MergedBlockBuilder;
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+// 合并的一行在某个输入中的位置；segment 为空指针表示该输入没有此行
+struct MergeRowPart
+{
+    DecodedSegment *segment = nullptr;
+    uint32_t row = 0;
+};
+
+// merge-samples 的输出块，依次写入按列拼接的段与逐行合并的行：
+//   - addSegment：各输入对齐的一段（需 sameSegmentSites），同 mergeBlockSamples
+//   - addRow：站点列取第一个含该行的输入，样本列由各输入解码出的 GT 与 FORMAT 值直接编码，缺少该行的输入为缺失值；
+//     逐行合并的行按 checkpointRows 切段，一段的各行依次取自某输入一段的全部行时，站点流原样复制该段的
+class MergedBlockBuilder
+{
+public:
+    MergedBlockBuilder(const std::vector<uint32_t> &nSamples, const BlockParams &params);
+    ~MergedBlockBuilder();
+
+    // 当前块已写入的行数
+    uint32_t rows() const;
+
+    void addSegment(const std::vector<BlockView> &blocks, const std::vector<size_t> &segments);
+    void addRow(const std::vector<MergeRowPart> &parts);
+
+    // 取出当前块（无行时 nRows 为 0），之后继续写入下一块
+    EncodedBlock finish(const std::string &chrom);
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+// 按行切分的文本列
+struct TextColumn
+{
+    std::vector<uint8_t> buf;
+    std::vector<std::string_view> values;
+
+    void load(const SegmentView &segment, uint32_t id, uint32_t nRows);
+};
+
+// 解码整块并以 VCF 文本追加到 out
+void renderBlockVcf(const BlockView &block, const std::string &chrom, uint32_t nSamples, std::string &out);
+
+// 样本组划分：编码时为等长组（最后一组可较短）；merge-samples 按列拼接的块中各输入的组首尾相接，组长可不等。
+// 样本组流：组长 (varint)；组长不等时为 0 + 组数 (varint) + 各组长 (varint)
+class SampleGroups
+{
+public:
+    SampleGroups() = default;
+    SampleGroups(uint32_t nSamples, uint32_t groupSize);
+    explicit SampleGroups(const std::vector<uint32_t> &sizes);
+
+    uint32_t count() const { return static_cast<uint32_t>(starts.size() - 1); }
+    uint32_t samples() const { return starts.back(); }
+    uint32_t first(uint32_t g) const { return starts[g]; }
+    uint32_t size(uint32_t g) const { return starts[g + 1] - starts[g]; }
+
+    // 样本所在的组；等长组直接相除
+    uint32_t of(uint32_t s) const { return uniform ? s / uniform : groupOf[s]; }
+
+    // 样本组流的内容
+    std::vector<uint8_t> bytes() const;
+
+private:
+    uint32_t uniform = 1; // 等长组的组长，组长不等时为 0
+    std::vector<uint32_t> starts{0};
+    std::vector<uint32_t> groupOf;
+};
+
+// 块内样本组划分；无样本组流时全部样本为一组
+SampleGroups blockSampleGroups(const SegmentView &segment, uint32_t nSamples);
+SampleGroups blockSampleGroups(const BlockView &block, uint32_t nSamples);
+
+// 位置闭区间 [first, second]
+using PositionRange = std::pair<int64_t, int64_t>;
+
+// ranges 按起点排序且互不重叠；判断 [pos, stop] 是否与其中某个区间重叠
+bool overlapsAny(const std::vector<PositionRange> &ranges, int64_t pos, int64_t stop);
+
+// 渲染出的一行在输出文本中的位置（含换行）及其覆盖范围
+struct RenderedRow
+{
+    size_t offset = 0;
+    size_t length = 0;
+    int64_t pos = 0;
+    int64_t stop = 0;
+};
+
+class FieldProjection;
+
+struct RenderOptions
+{
+    const std::vector<PositionRange> *ranges = nullptr; // 只输出与其中某区间重叠的行，空指针表示不限
+    const std::vector<uint32_t> *samples = nullptr; // 输出的样本（原始列号，递增），空指针表示全部
+    const std::vector<uint32_t> *blockRows = nullptr; // 只输出这些块内行（递增），空指针表示全部；只解码所在的段
+    std::vector<RenderedRow> *rows = nullptr;       // 可选：记录每行的位置，供缓存后按区间裁剪
+    const WhereFilter *where = nullptr; // 按站点列逐行过滤，在解码基因型之前求值；块内无命中行时不加载样本流
+    const FieldProjection *fields = nullptr; // 列投影：只加载并输出所选的列与 INFO/FORMAT 键，空指针表示整行
+};
+
+void renderBlockVcf(const BlockView &block, const std::string &chrom, uint32_t nSamples, const RenderOptions &options,
+                    std::string &out);
+
+// 满足 options 中 ranges/blockRows/where 的行数；只解码站点列，不加载样本流
+uint32_t countBlockRows(const BlockView &block, uint32_t nSamples, const RenderOptions &options);
+
+// PLINK 1 导出：块内双等位变异行的 .bim 文本与 .bed 行（每行 (样本数 + 3) / 4 字节），不生成 VCF 文本
+struct PlinkRows
+{
+    std::string bim;
+    std::vector<uint8_t> bed;
+    uint32_t variants = 0;
+    uint32_t skipped = 0; // 多等位行与 gVCF 参考块
+};
+
+void packBlockPlink(const BlockView &block, const std::string &chrom, uint32_t nSamples, PlinkRows &out);
+
+// 基因型矩阵导出：每个输出行一行，列为所选样本
+enum class MatrixKind : uint8_t
+{
+    Dosage,        // int8：非 REF 等位基因个数，缺失或非常规文本为 -1
+    HaplotypeBits, // 每样本 2 个单倍型位（非 REF 为 1，缺失与非常规文本为 0），逐行按 MSB 在前打包，同 numpy.packbits
+};
+
+inline size_t matrixRowBytes(MatrixKind kind, size_t nSamples)
+{
+    return kind == MatrixKind::Dosage ? nSamples : (2 * nSamples + 7) / 8;
+}
+
+// 满足 options 中 ranges 的行（样本取 options.samples，空指针为全部）依次写入 out，每行 matrixRowBytes 字节，
+// out 需由调用方清零；只加载站点列与所选样本组的 GT 流，返回写出的行数
+uint32_t packBlockMatrix(const BlockView &block, uint32_t nSamples, const RenderOptions &options, MatrixKind kind,
+                         uint8_t *out);
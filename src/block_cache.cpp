@@ -0,0 +1,138 @@
+#include "block_cache.hpp"
+#include "xxhash/xxh3.h"
+
+#include <stdexcept>
+
+namespace
+{
+    // 两个字段集是否为同一样本子集：hash 相同时再比较样本列表，排除碰撞
+    bool sameSamples(const BlockCache::FieldSet &a, const BlockCache::FieldSet &b)
+    {
+        if (a.samples == b.samples)
+        {
+            return true;
+        }
+        return a.samples && b.samples && *a.samples == *b.samples;
+    }
+}
+
+void DecodedBlock::appendRanges(const std::vector<PositionRange> *ranges, std::string &out) const
+{
+    if (!ranges)
+    {
+        out += text;
+        return;
+    }
+    for (const auto &row : rows)
+    {
+        if (overlapsAny(*ranges, row.pos, row.stop))
+        {
+            out.append(text, row.offset, row.length);
+        }
+    }
+}
+
+BlockCache::BlockCache(const GscReader &reader, size_t byteBudget) : reader(reader), byteBudget(byteBudget) {}
+
+BlockCache::FieldSet BlockCache::fieldSet(const std::vector<uint32_t> *samples)
+{
+    FieldSet f;
+    if (samples)
+    {
+        f.samples = std::make_shared<const std::vector<uint32_t>>(*samples);
+        // 全部样本的 hash 为 0，子集（含空子集）以种子 1 求 hash 与之区分
+        f.hash = XXH3_64bits_withSeed(samples->data(), samples->size() * sizeof(uint32_t), 1) | 1;
+    }
+    return f;
+}
+
+BlockCache::Value BlockCache::decode(size_t block, const FieldSet &fieldSet) const
+{
+    const GscIndex &index = reader.index();
+    auto decoded = std::make_shared<DecodedBlock>();
+    RenderOptions options;
+    options.samples = fieldSet.samples.get();
+    options.rows = &decoded->rows;
+    // 样本子集只读入、校验所选样本组的流
+    const BlockPart part = fieldSet.samples ? BlockPart::Partial : BlockPart::All;
+    renderBlockVcf(reader.block(block, part), index.chroms.at(index.blocks.at(block).chromId),
+                   static_cast<uint32_t>(reader.samples().size()), options, decoded->text);
+    return decoded;
+}
+
+void BlockCache::evict()
+{
+    while (total > byteBudget && !lru.empty())
+    {
+        auto it = map.find(lru.back());
+        total -= it->second.bytes;
+        lru.pop_back();
+        map.erase(it);
+    }
+}
+
+std::shared_ptr<const DecodedBlock> BlockCache::get(size_t block, const FieldSet &fieldSet)
+{
+    const Key key{fieldSet.hash, block};
+    std::promise<Value> promise;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto it = map.find(key);
+        if (it != map.end())
+        {
+            Entry &e = it->second;
+            if (!sameSamples(e.fieldSet, fieldSet))
+            {
+                // hash 碰撞：不缓存，直接解码
+                lock.unlock();
+                return decode(block, fieldSet);
+            }
+            if (e.ready)
+            {
+                lru.splice(lru.begin(), lru, e.lruPos);
+            }
+            std::shared_future<Value> value = e.value;
+            lock.unlock();
+            // 解码中的块等待解码线程的结果，解码失败时在此抛出同一异常
+            return value.get();
+        }
+        Entry &e = map[key];
+        e.fieldSet = fieldSet;
+        e.value = promise.get_future().share();
+    }
+
+    Value value;
+    try
+    {
+        value = decode(block, fieldSet);
+    }
+    catch (...)
+    {
+        promise.set_exception(std::current_exception());
+        std::lock_guard<std::mutex> lock(mutex);
+        map.erase(key);
+        throw;
+    }
+    promise.set_value(value);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry &e = map.at(key);
+    e.ready = true;
+    e.bytes = value->bytes();
+    e.lruPos = lru.insert(lru.begin(), key);
+    total += e.bytes;
+    evict();
+    return value;
+}
+
+size_t BlockCache::bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return total;
+}
+
+size_t BlockCache::entries() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "archive.hpp"
+
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 整块解码结果：VCF 文本及每行位置，不可变，可被多个查询共享
+struct DecodedBlock
+{
+    std::string text;
+    std::vector<RenderedRow> rows;
+
+    size_t bytes() const { return sizeof(DecodedBlock) + text.capacity() + rows.capacity() * sizeof(RenderedRow); }
+
+    // 把与 ranges 中某区间重叠的行追加到 out；ranges 为空指针时追加整块
+    void appendRanges(const std::vector<PositionRange> *ranges, std::string &out) const;
+};
+
+// 查询路径的解码块缓存，按字节计的 LRU：
+//   - 键为 (字段集 hash, 块号)，字段集目前为输出的样本子集；条目持有字段集，字段集随其最后一个条目一同淘汰
+//   - 多个线程同时请求同一块时只有一个线程解码，其余等待共享结果；解码失败不缓存
+//   - 每个条目按 DecodedBlock::bytes() 计入总量，超出预算时从最久未用的条目淘汰，大于预算的块用后即淘汰
+class BlockCache
+{
+public:
+    // 样本子集，samples 为空指针表示全部样本；调用方构造一次，各次 get 复用
+    struct FieldSet
+    {
+        std::shared_ptr<const std::vector<uint32_t>> samples;
+        uint64_t hash = 0;
+    };
+
+    BlockCache(const GscReader &reader, size_t byteBudget);
+
+    static FieldSet fieldSet(const std::vector<uint32_t> *samples);
+
+    std::shared_ptr<const DecodedBlock> get(size_t block, const FieldSet &fieldSet);
+
+    // 当前缓存的字节数与条目数（不含解码中的块）
+    size_t bytes() const;
+    size_t entries() const;
+
+private:
+    using Value = std::shared_ptr<const DecodedBlock>;
+
+    struct Key
+    {
+        uint64_t fieldSet = 0;
+        size_t block = 0;
+
+        bool operator==(const Key &o) const { return fieldSet == o.fieldSet && block == o.block; }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key &k) const
+        {
+            return static_cast<size_t>(k.fieldSet ^ (static_cast<uint64_t>(k.block) * 0x9e3779b97f4a7c15ull));
+        }
+    };
+
+    struct Entry
+    {
+        FieldSet fieldSet;
+        std::shared_future<Value> value;
+        bool ready = false;
+        size_t bytes = 0;
+        std::list<Key>::iterator lruPos; // ready 时有效
+    };
+
+    const GscReader &reader;
+    size_t byteBudget;
+
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> map;
+    std::list<Key> lru; // 已解码的条目，最近使用的在前
+    size_t total = 0;
+
+    Value decode(size_t block, const FieldSet &fieldSet) const;
+    void evict();
+};
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 字节流写入：小端定长整数 + LEB128 变长整数
+class ByteWriter
+{
+public:
+    std::vector<uint8_t> data;
+
+    void putU8(uint8_t v) { data.push_back(v); }
+
+    void putU16(uint16_t v) { putFixed(v, 2); }
+    void putU32(uint32_t v) { putFixed(v, 4); }
+    void putU64(uint64_t v) { putFixed(v, 8); }
+
+    void putVarint(uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(v));
+    }
+
+    // 有符号整数先 zigzag 再变长编码
+    void putSVarint(int64_t v)
+    {
+        putVarint((static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+    }
+
+    void putBytes(const void *p, size_t n)
+    {
+        const uint8_t *b = static_cast<const uint8_t *>(p);
+        data.insert(data.end(), b, b + n);
+    }
+
+    // 长度前缀字符串
+    void putString(std::string_view s)
+    {
+        putVarint(s.size());
+        putBytes(s.data(), s.size());
+    }
+
+    size_t size() const { return data.size(); }
+
+private:
+    void putFixed(uint64_t v, int n)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            data.push_back(static_cast<uint8_t>(v >> (8 * i)));
+        }
+    }
+};
+
+// 字节流读取，越界时抛出异常
+class ByteReader
+{
+public:
+    ByteReader(const uint8_t *p, size_t n) : cur(p), end(p + n) {}
+    explicit ByteReader(const std::vector<uint8_t> &v) : ByteReader(v.data(), v.size()) {}
+
+    uint8_t getU8()
+    {
+        need(1);
+        return *cur++;
+    }
+
+    uint16_t getU16() { return static_cast<uint16_t>(getFixed(2)); }
+    uint32_t getU32() { return static_cast<uint32_t>(getFixed(4)); }
+    uint64_t getU64() { return getFixed(8); }
+
+    uint64_t getVarint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            need(1);
+            uint8_t b = *cur++;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80))
+            {
+                return v;
+            }
+        }
+        throw std::runtime_error("Malformed varint");
+    }
+
+    int64_t getSVarint()
+    {
+        uint64_t v = getVarint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    const uint8_t *getBytes(size_t n)
+    {
+        need(n);
+        const uint8_t *p = cur;
+        cur += n;
+        return p;
+    }
+
+    std::string_view getString()
+    {
+        size_t n = getVarint();
+        return std::string_view(reinterpret_cast<const char *>(getBytes(n)), n);
+    }
+
+    const uint8_t *position() const { return cur; }
+    size_t remaining() const { return end - cur; }
+    bool eof() const { return cur == end; }
+
+private:
+    const uint8_t *cur;
+    const uint8_t *end;
+
+    void need(size_t n) const
+    {
+        if (static_cast<size_t>(end - cur) < n)
+        {
+            throw std::runtime_error("Unexpected end of buffer");
+        }
+    }
+
+    uint64_t getFixed(int n)
+    {
+        need(n);
+        uint64_t v = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            v |= static_cast<uint64_t>(cur[i]) << (8 * i);
+        }
+        cur += n;
+        return v;
+    }
+};
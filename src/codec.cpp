@@ -0,0 +1,184 @@
+#include "codec.hpp"
+#include "brotli.hpp"
+#include "libbsc.h"
+
+#include <algorithm>
+#include <climits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+
+namespace
+{
+    // 小于该长度的流压缩收益为负，直接存储
+    constexpr size_t kMinCompressSize = 64;
+
+    // 块级已经并行，bsc 内部不再开线程
+    constexpr int kBscFeatures = LIBBSC_FEATURE_FASTMODE;
+
+    void initBsc()
+    {
+        static std::once_flag once;
+        std::call_once(once,
+                       []
+                       {
+                           if (bsc_init(kBscFeatures) != LIBBSC_NO_ERROR)
+                           {
+                               throw std::runtime_error("bsc_init failed");
+                           }
+                       });
+    }
+
+    // 压缩失败或超出 int 长度时返回 false，由调用方改为直接存储
+    bool bscCompress(const uint8_t *data, size_t size, std::vector<uint8_t> &out)
+    {
+        if (size > static_cast<size_t>(INT_MAX - LIBBSC_HEADER_SIZE))
+        {
+            return false;
+        }
+        initBsc();
+        out.resize(size + LIBBSC_HEADER_SIZE);
+        int n = bsc_compress(data, out.data(), static_cast<int>(size), LIBBSC_DEFAULT_LZPHASHSIZE,
+                             LIBBSC_DEFAULT_LZPMINLEN, LIBBSC_BLOCKSORTER_BWT, LIBBSC_CODER_QLFC_ADAPTIVE,
+                             kBscFeatures);
+        if (n < 0)
+        {
+            return false;
+        }
+        out.resize(static_cast<size_t>(n));
+        return true;
+    }
+
+    void bscDecompress(const uint8_t *data, size_t size, size_t rawSize, std::vector<uint8_t> &out)
+    {
+        initBsc();
+        int blockSize = 0;
+        int dataSize = 0;
+        if (size > INT_MAX ||
+            bsc_block_info(data, static_cast<int>(size), &blockSize, &dataSize, kBscFeatures) != LIBBSC_NO_ERROR ||
+            static_cast<size_t>(blockSize) != size || static_cast<size_t>(dataSize) != rawSize)
+        {
+            throw std::runtime_error("Corrupt bsc stream");
+        }
+        out.resize(rawSize);
+        if (bsc_decompress(data, blockSize, out.data(), dataSize, kBscFeatures) != LIBBSC_NO_ERROR)
+        {
+            throw std::runtime_error("Corrupt bsc stream");
+        }
+    }
+
+    void zlibCompress(const uint8_t *data, size_t size, int level, std::vector<uint8_t> &out)
+    {
+        uLongf n = compressBound(static_cast<uLong>(size));
+        out.resize(n);
+        if (compress2(out.data(), &n, data, static_cast<uLong>(size), std::clamp(level, 1, 9)) != Z_OK)
+        {
+            throw std::runtime_error("zlib compress2 failed");
+        }
+        out.resize(n);
+    }
+
+    void zlibDecompress(const uint8_t *data, size_t size, size_t rawSize, std::vector<uint8_t> &out)
+    {
+        out.resize(rawSize);
+        uLongf n = static_cast<uLongf>(rawSize);
+        if (uncompress(out.data(), &n, data, static_cast<uLong>(size)) != Z_OK)
+        {
+            throw std::runtime_error("Corrupt zlib stream");
+        }
+        out.resize(n);
+    }
+}
+
+const char *codecName(Codec codec)
+{
+    switch (codec)
+    {
+    case Codec::Store:
+        return "store";
+    case Codec::Brotli:
+        return "brotli";
+    case Codec::Bsc:
+        return "bsc";
+    case Codec::Zlib:
+        return "zlib";
+    }
+    return "unknown";
+}
+
+Codec parseCodec(const std::string &name)
+{
+    for (Codec c : {Codec::Store, Codec::Brotli, Codec::Bsc, Codec::Zlib})
+    {
+        if (name == codecName(c))
+        {
+            return c;
+        }
+    }
+    throw std::runtime_error("Unknown codec: " + name);
+}
+
+std::vector<uint8_t> compressStream(const CodecParams &params, const uint8_t *data, size_t size, Codec &used)
+{
+    std::vector<uint8_t> out;
+    if (params.codec != Codec::Store && size >= kMinCompressSize)
+    {
+        bool ok = true;
+        switch (params.codec)
+        {
+        case Codec::Brotli:
+        {
+            BrotliCompressor compressor(params.level, params.window);
+            compressor.compressData(data, size, out);
+            break;
+        }
+        case Codec::Bsc:
+            ok = bscCompress(data, size, out);
+            break;
+        case Codec::Zlib:
+            zlibCompress(data, size, params.level, out);
+            break;
+        default:
+            throw std::runtime_error("Unknown stream codec " + std::to_string(static_cast<int>(params.codec)));
+        }
+        if (ok && out.size() < size)
+        {
+            used = params.codec;
+            return out;
+        }
+    }
+    used = Codec::Store;
+    out.assign(data, data + size);
+    return out;
+}
+
+std::vector<uint8_t> decompressStream(Codec codec, const uint8_t *data, size_t size, size_t rawSize)
+{
+    std::vector<uint8_t> out;
+    switch (codec)
+    {
+    case Codec::Store:
+        out.assign(data, data + size);
+        break;
+    case Codec::Brotli:
+    {
+        BrotliDecompressor decompressor;
+        decompressor.decompressData(data, size, out);
+        break;
+    }
+    case Codec::Bsc:
+        bscDecompress(data, size, rawSize, out);
+        break;
+    case Codec::Zlib:
+        zlibDecompress(data, size, rawSize, out);
+        break;
+    default:
+        throw std::runtime_error("Unknown stream codec " + std::to_string(static_cast<int>(codec)));
+    }
+    if (out.size() != rawSize)
+    {
+        throw std::runtime_error("Stream size mismatch after decompression");
+    }
+    return out;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 字段流使用的后端编码器，编号写入文件，不可修改已有取值
+enum class Codec : uint8_t
+{
+    Store = 0,
+    Brotli = 1,
+    Bsc = 2,  // libbsc：BWT + 自适应 QLFC，压缩率高、速度慢，适合冷数据
+    Zlib = 3, // zlib deflate，解压最快
+};
+
+struct CodecParams
+{
+    Codec codec = Codec::Brotli;
+    int level = 9;   // brotli quality 0-11；zlib 取 min(level, 9)；bsc 不使用
+    int window = 24; // brotli lgwin 10-24
+};
+
+const char *codecName(Codec codec);
+
+// store / brotli / bsc / zlib；未知名称时抛出异常
+Codec parseCodec(const std::string &name);
+
+// 压缩一个字段流；数据很小时直接存储
+std::vector<uint8_t> compressStream(const CodecParams &params, const uint8_t *data, size_t size, Codec &used);
+
+// 解压一个字段流，rawSize 为压缩前长度
+std::vector<uint8_t> decompressStream(Codec codec, const uint8_t *data, size_t size, size_t rawSize);
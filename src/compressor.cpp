@@ -0,0 +1,106 @@
+#include "compressor.hpp"
+#include "archive.hpp"
+#include "block.hpp"
+#include "vcf.hpp"
+#include "view.hpp"
+
+#include <memory>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_pipeline.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+
+namespace
+{
+    struct LineBatch
+    {
+        std::vector<std::string> lines;
+    };
+
+    std::string_view chromOf(const std::string &line)
+    {
+        return std::string_view(line).substr(0, line.find('\t'));
+    }
+
+    size_t pipelineTokens(size_t requested)
+    {
+        if (requested > 0)
+        {
+            return requested;
+        }
+        return static_cast<size_t>(tbb::info::default_concurrency()) * 2;
+    }
+}
+
+void compressVcfFile(const std::string &inputFile, const std::string &outputFile, const CompressOptions &options)
+{
+    VcfReader reader(inputFile);
+    const uint32_t nSamples = static_cast<uint32_t>(reader.header().samples.size());
+    GscWriter writer(outputFile, reader.header(), options.codec);
+    BlockParams params;
+    params.codec = options.codec;
+    params.gtLayout = options.gtLayout;
+    params.sampleGroupSize = options.sampleGroupSize;
+    params.collectIds = options.idIndex;
+    params.checkpointRows = options.checkpointRows;
+
+    std::string pending;
+    bool havePending = reader.nextLine(pending);
+    uint64_t nVariants = 0;
+    uint64_t nBlocks = 0;
+
+    tbb::parallel_pipeline(
+        pipelineTokens(options.maxTokens),
+        // 读取阶段：按块大小与染色体边界切分
+        tbb::make_filter<void, std::shared_ptr<LineBatch>>(
+            tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control &fc) -> std::shared_ptr<LineBatch>
+            {
+                if (!havePending)
+                {
+                    fc.stop();
+                    return nullptr;
+                }
+                auto batch = std::make_shared<LineBatch>();
+                std::string chrom(chromOf(pending));
+                batch->lines.push_back(std::move(pending));
+                while (batch->lines.size() < options.blockSize)
+                {
+                    havePending = reader.nextLine(pending);
+                    if (!havePending || chromOf(pending) != chrom)
+                    {
+                        return batch;
+                    }
+                    batch->lines.push_back(std::move(pending));
+                }
+                havePending = reader.nextLine(pending);
+                return batch;
+            }) &
+            // 编码阶段
+            tbb::make_filter<std::shared_ptr<LineBatch>, std::shared_ptr<EncodedBlock>>(
+                tbb::filter_mode::parallel,
+                [&](std::shared_ptr<LineBatch> batch)
+                {
+                    return std::make_shared<EncodedBlock>(encodeBlock(batch->lines, nSamples, params));
+                }) &
+            // 写出阶段
+            tbb::make_filter<std::shared_ptr<EncodedBlock>, void>(
+                tbb::filter_mode::serial_in_order,
+                [&](std::shared_ptr<EncodedBlock> block)
+                {
+                    writer.writeBlock(*block);
+                    nVariants += block->nRows;
+                    ++nBlocks;
+                }));
+
+    writer.close();
+    spdlog::info("Compressed {} variants x {} samples into {} blocks", nVariants, nSamples, nBlocks);
+}
+
+void decompressGscFile(const std::string &inputFile, const std::string &outputFile)
+{
+    // 输出名以 .gz 结尾时直接写 BGZF
+    ViewOptions options;
+    options.bgzf = outputFile.size() > 3 && outputFile.compare(outputFile.size() - 3, 3, ".gz") == 0;
+    viewGscFile(inputFile, outputFile, options);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "block.hpp"
+#include "codec.hpp"
+#include "genotype.hpp"
+
+#include <cstdint>
+#include <string>
+
+struct CompressOptions
+{
+    uint32_t blockSize = 8192; // 每块最多变异数，块同时在染色体边界处切开
+    CodecParams codec;
+    size_t maxTokens = 0;      // 流水线同时在途的块数，0 表示按线程数自动选择
+    GenotypeLayout gtLayout = GenotypeLayout::VariantMajor; // 按样本访问为主时选 SampleMajor
+    uint32_t sampleGroupSize = kDefaultSampleGroupSize;     // GT/FORMAT 按样本分组成流的组大小
+    bool idIndex = false;                                   // 写入变异 ID 索引（view -i）
+    uint32_t checkpointRows = 0;                            // 块内行检查点间隔，0 表示不切段
+};
+
+// VCF/VCF.GZ -> .gsc
+void compressVcfFile(const std::string &inputFile, const std::string &outputFile, const CompressOptions &options);
+
+// .gsc -> VCF
+void decompressGscFile(const std::string &inputFile, const std::string &outputFile);
@@ -0,0 +1,140 @@
+#include "concat.hpp"
+#include "archive.hpp"
+#include "vcf.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace
+{
+    // 决定字段含义与类型的头部行，各输入必须一致
+    bool isDefinitionLine(const std::string &line)
+    {
+        for (const char *prefix : {"##fileformat=", "##INFO=", "##FORMAT="})
+        {
+            if (line.compare(0, std::char_traits<char>::length(prefix), prefix) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    VcfHeader splitHeader(const std::string &text)
+    {
+        VcfHeader header;
+        size_t start = 0;
+        while (start < text.size())
+        {
+            size_t end = text.find('\n', start);
+            end = end == std::string::npos ? text.size() : end;
+            std::string line = text.substr(start, end - start);
+            start = end + 1;
+            if (line.compare(0, 2, "##") == 0)
+            {
+                header.metaLines.push_back(std::move(line));
+            }
+            else if (line.compare(0, 6, "#CHROM") == 0)
+            {
+                header.columnLine = std::move(line);
+            }
+        }
+        return header;
+    }
+
+    std::vector<std::string> definitions(const VcfHeader &header)
+    {
+        std::vector<std::string> lines;
+        std::copy_if(header.metaLines.begin(), header.metaLines.end(), std::back_inserter(lines), isDefinitionLine);
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+}
+
+ConcatSummary concatGsc(const std::vector<std::string> &inputFiles, const std::string &outputFile)
+{
+    if (inputFiles.empty())
+    {
+        throw std::runtime_error("concat needs at least one input");
+    }
+    checkOutputNotInput(inputFiles, outputFile);
+    std::vector<std::unique_ptr<GscReader>> readers;
+    VcfHeader header;
+    std::vector<std::string> firstDefinitions;
+    std::unordered_set<std::string> seen;
+    bool allIds = true;
+    bool anyIds = false;
+    for (const std::string &path : inputFiles)
+    {
+        readers.push_back(std::make_unique<GscReader>(path));
+        const GscReader &reader = *readers.back();
+        VcfHeader h = splitHeader(reader.headerText());
+        if (readers.size() == 1)
+        {
+            header = h;
+            header.samples = reader.samples();
+            firstDefinitions = definitions(h);
+            seen.insert(h.metaLines.begin(), h.metaLines.end());
+        }
+        else if (reader.samples() != header.samples || h.columnLine != header.columnLine)
+        {
+            throw std::runtime_error("Samples of " + path + " do not match " + inputFiles[0]);
+        }
+        else if (definitions(h) != firstDefinitions)
+        {
+            throw std::runtime_error("INFO/FORMAT definitions of " + path + " do not match " + inputFiles[0]);
+        }
+        for (std::string &line : h.metaLines)
+        {
+            if (seen.insert(line).second)
+            {
+                header.metaLines.push_back(std::move(line));
+            }
+        }
+        allIds = allIds && reader.hasIdIndex();
+        anyIds = anyIds || reader.hasIdIndex();
+    }
+
+    ConcatSummary summary;
+    summary.idIndex = allIds;
+    summary.droppedIds = anyIds && !allIds;
+    GscWriter writer(outputFile, header, CodecParams());
+    std::unordered_set<std::string> chroms;
+    std::string lastChrom;
+    int64_t lastMinPos = 0;
+    const std::vector<std::pair<uint64_t, uint32_t>> noIds;
+    for (size_t j = 0; j < readers.size(); ++j)
+    {
+        const GscReader &reader = *readers[j];
+        const GscIndex &index = reader.index();
+        const auto ids = allIds ? reader.idIndexView().byBlock(static_cast<uint32_t>(index.blocks.size()))
+                                : std::vector<std::vector<std::pair<uint64_t, uint32_t>>>();
+        for (size_t b = 0; b < index.blocks.size(); ++b)
+        {
+            const BlockIndexEntry &e = index.blocks[b];
+            const std::string &chrom = index.chroms[e.chromId];
+            if (chrom != lastChrom && !chroms.insert(chrom).second)
+            {
+                throw std::runtime_error("Chromosome " + chrom + " of " + inputFiles[j] +
+                                         " already appeared in an earlier input");
+            }
+            // 同一条染色体跨输入续接时 POS 须前进，否则区域查询的块顺序失效（也拦下重复给出的同一文件）
+            if (b == 0 && chrom == lastChrom && e.minPos <= lastMinPos)
+            {
+                throw std::runtime_error("Chromosome " + chrom + " of " + inputFiles[j] +
+                                         " does not continue the previous input in POS order");
+            }
+            lastChrom = chrom;
+            lastMinPos = e.minPos;
+            writer.copyBlock(reader.blockBytes(b), index, b, allIds ? ids[b] : noIds);
+            ++summary.blocks;
+            summary.records += e.nRows;
+            summary.bytes += e.size;
+        }
+    }
+    writer.close();
+    return summary;
+}
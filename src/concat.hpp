@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// gsc concat：按顺序拼接多个 .gsc（如各染色体分别压缩的文件），块字节原样复制，不解码。
+// 各输入的样本列与 ##fileformat/##INFO/##FORMAT 行须一致；输出头部为第一个输入的头部，补上其余输入中不重复的 ## 行。
+// 一条染色体只能出现在一个输入中，或紧接着上一个输入的最后一条染色体继续且 POS 前进。
+// 块按索引校验 hash 后写出，索引项沿用源文件的行数、POS 范围、摘要与 hash，只重算偏移与 FILTER 位；
+// 全部输入都有 ID 索引时合并 ID 索引，否则输出不带 ID 索引
+
+struct ConcatSummary
+{
+    uint64_t blocks = 0;
+    uint64_t records = 0;
+    uint64_t bytes = 0; // 块数据字节数
+    bool idIndex = false;
+    bool droppedIds = false; // 只有部分输入带 ID 索引，输出不带
+};
+
+ConcatSummary concatGsc(const std::vector<std::string> &inputFiles, const std::string &outputFile);
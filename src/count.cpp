@@ -0,0 +1,121 @@
+#include "count.hpp"
+#include "archive.hpp"
+#include "region.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <oneapi/tbb/parallel_for.h>
+#include <stdexcept>
+
+namespace
+{
+    std::string regionLabel(const GenomicRegion &region)
+    {
+        if (region.start == 1 && region.end == INT64_MAX)
+        {
+            return region.chrom;
+        }
+        std::string label = region.chrom + ":" + std::to_string(region.start) + "-";
+        if (region.end != INT64_MAX)
+        {
+            label += std::to_string(region.end);
+        }
+        return label;
+    }
+}
+
+RegionCount countRegion(const GscReader &reader, const GenomicRegion &region, const WhereFilter &where)
+{
+    RegionCount result;
+    const GscIndex &index = reader.index();
+    if (where.empty() && region.start <= 1 && region.end == INT64_MAX)
+    {
+        auto it = std::find(index.chroms.begin(), index.chroms.end(), region.chrom);
+        if (it != index.chroms.end())
+        {
+            result.records = index.chromSummaries[it - index.chroms.begin()].records;
+        }
+        return result;
+    }
+
+    std::vector<size_t> partial;
+    for (size_t i : reader.regions().blocksFor(region))
+    {
+        const BlockIndexEntry &e = index.blocks[i];
+        if (!where.empty() && !where.mayMatch(e.zone, index.filters))
+        {
+            continue;
+        }
+        if (where.empty() && e.minPos >= region.start && e.maxPos <= region.end)
+        {
+            result.records += e.nRows;
+        }
+        else
+        {
+            partial.push_back(i);
+        }
+    }
+
+    const std::vector<PositionRange> ranges = {{region.start, region.end}};
+    const uint32_t nSamples = static_cast<uint32_t>(reader.samples().size());
+    std::atomic<uint64_t> counted{0};
+    tbb::parallel_for(size_t(0), partial.size(),
+                      [&](size_t k)
+                      {
+                          RenderOptions options;
+                          options.ranges = &ranges;
+                          options.where = where.empty() ? nullptr : &where;
+                          counted += countBlockRows(reader.block(partial[k], BlockPart::Partial), nSamples, options);
+                      });
+    result.records += counted;
+    result.decodedBlocks = partial.size();
+    return result;
+}
+
+void countGscFile(const std::string &inputFile, const std::string &outputFile, const CountOptions &options)
+{
+    GscReader reader(inputFile);
+    std::ofstream file;
+    std::ostream *out = &std::cout;
+    if (outputFile != "-")
+    {
+        file.open(outputFile, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open output file: " + outputFile);
+        }
+        out = &file;
+    }
+
+    const WhereFilter where = WhereFilter::parse(options.where);
+    std::vector<GenomicRegion> regions;
+    if (!options.regionsFile.empty())
+    {
+        regions = readBedFile(options.regionsFile);
+    }
+    for (const auto &text : options.regions)
+    {
+        regions.push_back(parseRegion(text));
+    }
+    if (regions.empty())
+    {
+        for (const auto &chrom : reader.index().chroms)
+        {
+            GenomicRegion whole;
+            whole.chrom = chrom;
+            regions.push_back(whole);
+        }
+    }
+    for (const GenomicRegion &region : regions)
+    {
+        *out << regionLabel(region) << '\t' << countRegion(reader, region, where).records << '\n';
+    }
+
+    out->flush();
+    if (!*out)
+    {
+        throw std::runtime_error("Failed to write output file: " + outputFile);
+    }
+}
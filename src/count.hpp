@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class GscReader;
+class WhereFilter;
+struct GenomicRegion;
+
+struct CountOptions
+{
+    std::vector<std::string> regions; // -r：chr[:start[-end]]，每个区域单独计数
+    std::string regionsFile;          // -R：BED 文件
+    std::string where;                // --where：只计满足条件的记录
+};
+
+struct RegionCount
+{
+    uint64_t records = 0;
+    size_t decodedBlocks = 0; // 实际解码站点列的块数
+};
+
+// 与区域重叠（且满足 where）的记录数：整条染色体取索引中的汇总，完全落在区域内的块取块行数，
+// 只解码被区域切开的边缘块；where 非空时先用块摘要排除，其余块逐行求值
+RegionCount countRegion(const GscReader &reader, const GenomicRegion &region, const WhereFilter &where);
+
+// 无区域时每条染色体一行 "染色体\t记录数"；有区域时每个区域一行 "区域\t记录数"，按给出的顺序
+void countGscFile(const std::string &inputFile, const std::string &outputFile, const CountOptions &options);
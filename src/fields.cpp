@@ -0,0 +1,201 @@
+#include "fields.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    struct NamedColumn
+    {
+        const char *name;
+        FieldProjection::Column column;
+    };
+
+    constexpr NamedColumn kColumns[] = {
+        {"CHROM", FieldProjection::Column::Chrom},
+        {"POS", FieldProjection::Column::Pos},
+        {"ID", FieldProjection::Column::Id},
+        {"REF", FieldProjection::Column::Ref},
+        {"ALT", FieldProjection::Column::Alt},
+        {"QUAL", FieldProjection::Column::Qual},
+        {"FILTER", FieldProjection::Column::Filter},
+        {"INFO", FieldProjection::Column::Info},
+        {"GT", FieldProjection::Column::Gt},
+    };
+
+    std::string fieldName(const FieldProjection::Field &f)
+    {
+        if (f.column == FieldProjection::Column::InfoKey)
+        {
+            return "INFO/" + f.key;
+        }
+        if (f.column == FieldProjection::Column::FormatKey)
+        {
+            return "FORMAT/" + f.key;
+        }
+        for (const NamedColumn &c : kColumns)
+        {
+            if (c.column == f.column)
+            {
+                return c.name;
+            }
+        }
+        return "";
+    }
+
+    // 对 INFO 的每一项（key, value, 整项文本）调用 f；f 返回 false 时停止
+    template <class F>
+    void forEachInfo(std::string_view info, F &&f)
+    {
+        if (info == ".")
+        {
+            return;
+        }
+        size_t start = 0;
+        while (start < info.size())
+        {
+            size_t end = info.find(';', start);
+            if (end == std::string_view::npos)
+            {
+                end = info.size();
+            }
+            std::string_view item = info.substr(start, end - start);
+            size_t eq = item.find('=');
+            std::string_view key = item.substr(0, eq);
+            std::string_view value = eq == std::string_view::npos ? std::string_view() : item.substr(eq + 1);
+            if (!item.empty() && !f(key, value, item))
+            {
+                return;
+            }
+            start = end + 1;
+        }
+    }
+}
+
+bool findInfoValue(std::string_view info, std::string_view key, std::string_view &value)
+{
+    bool found = false;
+    forEachInfo(info,
+                [&](std::string_view k, std::string_view v, std::string_view)
+                {
+                    found = k == key;
+                    value = found ? v : value;
+                    return !found;
+                });
+    return found;
+}
+
+FieldProjection FieldProjection::parse(const std::string &list, bool tsv)
+{
+    FieldProjection p;
+    p.tsvOutput = tsv;
+    size_t start = 0;
+    while (start <= list.size())
+    {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+        std::string name = list.substr(start, end - start);
+        start = end + 1;
+        if (name.empty())
+        {
+            continue;
+        }
+        Field f;
+        if (name.compare(0, 5, "INFO/") == 0 && name.size() > 5)
+        {
+            f.column = Column::InfoKey;
+            f.key = name.substr(5);
+        }
+        else if (name.compare(0, 7, "FORMAT/") == 0 && name.size() > 7)
+        {
+            f.column = name == "FORMAT/GT" ? Column::Gt : Column::FormatKey;
+            f.key = f.column == Column::Gt ? "" : name.substr(7);
+        }
+        else
+        {
+            auto it = std::find_if(std::begin(kColumns), std::end(kColumns),
+                                   [&](const NamedColumn &c) { return name == c.name; });
+            if (it == std::end(kColumns))
+            {
+                throw std::runtime_error("Unknown field: " + name);
+            }
+            f.column = it->column;
+        }
+        if (f.column == Column::Gt || f.column == Column::FormatKey)
+        {
+            if (f.column == Column::FormatKey &&
+                std::find(p.formatKeyNames.begin(), p.formatKeyNames.end(), f.key) == p.formatKeyNames.end())
+            {
+                p.formatKeyNames.push_back(f.key);
+            }
+            p.sampleCols.push_back(std::move(f));
+        }
+        else
+        {
+            p.sites.push_back(std::move(f));
+        }
+    }
+    if (p.sites.empty() && p.sampleCols.empty())
+    {
+        throw std::runtime_error("No fields given");
+    }
+    return p;
+}
+
+bool FieldProjection::wants(Column column) const
+{
+    const std::vector<Field> &list = column == Column::Gt || column == Column::FormatKey ? sampleCols : sites;
+    return std::any_of(list.begin(), list.end(), [&](const Field &f) { return f.column == column; });
+}
+
+void FieldProjection::appendInfo(std::string_view info, std::string &out) const
+{
+    if (wants(Column::Info))
+    {
+        out.append(info.data(), info.size());
+        return;
+    }
+    const size_t begin = out.size();
+    forEachInfo(info,
+                [&](std::string_view key, std::string_view, std::string_view item)
+                {
+                    if (std::any_of(sites.begin(), sites.end(),
+                                    [&](const Field &f) { return f.column == Column::InfoKey && f.key == key; }))
+                    {
+                        if (out.size() > begin)
+                        {
+                            out += ';';
+                        }
+                        out.append(item.data(), item.size());
+                    }
+                    return true;
+                });
+    if (out.size() == begin)
+    {
+        out += '.';
+    }
+}
+
+std::string FieldProjection::tsvHeader(const std::vector<std::string> &sampleNames,
+                                       const std::vector<uint32_t> &samples) const
+{
+    std::string out = "#";
+    for (const Field &f : sites)
+    {
+        out += out.size() > 1 ? "\t" : "";
+        out += fieldName(f);
+    }
+    for (uint32_t s : samples)
+    {
+        for (const Field &f : sampleCols)
+        {
+            out += out.size() > 1 ? "\t" : "";
+            out += sampleNames[s] + ":" + fieldName(f);
+        }
+    }
+    out += '\n';
+    return out;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 列投影（view --fields）：只输出所列的 VCF 列与 INFO/FORMAT 键，解码时只加载对应的字段流
+//
+// 字段名逗号分隔：CHROM POS ID REF ALT QUAL FILTER INFO（整列）INFO/<键> GT FORMAT/<键>
+//   VCF：保留 8 个站点列，未选的列为 '.'，INFO 只保留所选键；有样本字段时 FORMAT 列为行内出现的所选键
+//        （GT 在前），样本格中该样本缺少的字段为 '.'
+//   TSV：每行依次为所选站点字段，再按样本依次为所选样本字段；缺失值为 '.'，INFO 中的 flag 为 1
+class FieldProjection
+{
+public:
+    enum class Column : uint8_t
+    {
+        Chrom,
+        Pos,
+        Id,
+        Ref,
+        Alt,
+        Qual,
+        Filter,
+        Info,
+        InfoKey,
+        Gt,
+        FormatKey,
+    };
+
+    struct Field
+    {
+        Column column = Column::Chrom;
+        std::string key; // InfoKey / FormatKey 的键名
+    };
+
+    // 未知字段名或空列表时抛出异常
+    static FieldProjection parse(const std::string &list, bool tsv);
+
+    bool tsv() const { return tsvOutput; }
+    bool wants(Column column) const;
+
+    // 站点字段与样本字段（GT、FORMAT 键），各按请求顺序
+    const std::vector<Field> &siteFields() const { return sites; }
+    const std::vector<Field> &sampleFields() const { return sampleCols; }
+    const std::vector<std::string> &formatKeys() const { return formatKeyNames; }
+
+    // VCF 的 INFO 列：整列、所选键或 '.'
+    void appendInfo(std::string_view info, std::string &out) const;
+
+    // TSV 首行（含换行）：站点字段名，随后为 样本:字段
+    std::string tsvHeader(const std::vector<std::string> &sampleNames, const std::vector<uint32_t> &samples) const;
+
+private:
+    bool tsvOutput = false;
+    std::vector<Field> sites;
+    std::vector<Field> sampleCols;
+    std::vector<std::string> formatKeyNames;
+};
+
+// INFO 中 key 的取值；flag 的取值为空。没有该键时返回 false
+bool findInfoValue(std::string_view info, std::string_view key, std::string_view &value);
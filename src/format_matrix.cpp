@@ -0,0 +1,498 @@
+#include "format_matrix.hpp"
+#include "itoa.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    constexpr int32_t kMissingValue = std::numeric_limits<int32_t>::min();
+    constexpr uint8_t kModeText = 0;
+    constexpr uint8_t kModeInt = 1;
+
+    enum TileMode : uint8_t
+    {
+        kTileRaw = 0,
+        kTileDeltaSamples = 1,
+        kTileDeltaRows = 2,
+    };
+
+    size_t svarintSize(int64_t v)
+    {
+        uint64_t u = (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+        size_t n = 1;
+        while (u >= 0x80)
+        {
+            u >>= 7;
+            ++n;
+        }
+        return n;
+    }
+
+    void appendInt(int32_t v, std::string &out)
+    {
+        if (v == kMissingValue)
+        {
+            out.push_back('.');
+            return;
+        }
+        appendSigned(v, out);
+    }
+}
+
+FormatKeyEncoder::FormatKeyEncoder(uint32_t nSamples) : nSamples(nSamples) {}
+
+void FormatKeyEncoder::padTo(uint64_t cell)
+{
+    while (nCells < cell)
+    {
+        if (intMode)
+        {
+            counts.push_back(0);
+        }
+        else
+        {
+            text.push_back('\n');
+        }
+        ++nCells;
+    }
+}
+
+bool FormatKeyEncoder::parseInts(std::string_view value)
+{
+    size_t before = comps.size();
+    size_t start = 0;
+    while (true)
+    {
+        size_t comma = value.find(',', start);
+        std::string_view c = value.substr(start, comma == std::string_view::npos ? std::string_view::npos : comma - start);
+        if (c == ".")
+        {
+            comps.push_back(kMissingValue);
+        }
+        else
+        {
+            // 只接受可以原样还原的十进制写法
+            int32_t v = 0;
+            auto res = std::from_chars(c.data(), c.data() + c.size(), v);
+            bool canonical = res.ec == std::errc() && res.ptr == c.data() + c.size() && v != kMissingValue &&
+                             !(c.size() > 1 && c[0] == '0') && !(c.size() > 2 && c[0] == '-' && c[1] == '0') &&
+                             c != "-0";
+            if (!canonical)
+            {
+                comps.resize(before);
+                return false;
+            }
+            comps.push_back(v);
+        }
+        if (comma == std::string_view::npos)
+        {
+            break;
+        }
+        start = comma + 1;
+    }
+    size_t n = comps.size() - before;
+    if (n > std::numeric_limits<uint16_t>::max())
+    {
+        comps.resize(before);
+        return false;
+    }
+    counts.push_back(static_cast<uint16_t>(n));
+    return true;
+}
+
+void FormatKeyEncoder::switchToText()
+{
+    // 已编码的整数格子按原样转回文本
+    size_t c = 0;
+    for (uint16_t n : counts)
+    {
+        for (uint16_t k = 0; k < n; ++k, ++c)
+        {
+            if (k)
+            {
+                text.push_back(',');
+            }
+            appendInt(comps[c], text);
+        }
+        text.push_back('\n');
+    }
+    counts = std::vector<uint16_t>();
+    comps = std::vector<int32_t>();
+    intMode = false;
+}
+
+void FormatKeyEncoder::add(uint32_t row, uint32_t sample, std::string_view value)
+{
+    padTo(static_cast<uint64_t>(row) * nSamples + sample);
+    if (intMode && !parseInts(value))
+    {
+        switchToText();
+    }
+    if (!intMode)
+    {
+        text.append(value.data(), value.size());
+        text.push_back('\n');
+    }
+    ++nCells;
+}
+
+std::vector<uint8_t> FormatKeyEncoder::finish(uint32_t nRows)
+{
+    padTo(static_cast<uint64_t>(nRows) * nSamples);
+    ByteWriter w;
+    if (!intMode)
+    {
+        w.putU8(kModeText);
+        w.putBytes(text.data(), text.size());
+        return std::move(w.data);
+    }
+
+    const uint64_t total = static_cast<uint64_t>(nRows) * nSamples;
+    std::vector<uint32_t> start(total + 1, 0);
+    uint32_t nPlanes = 0;
+    for (uint64_t i = 0; i < total; ++i)
+    {
+        start[i + 1] = start[i] + counts[i];
+        nPlanes = std::max<uint32_t>(nPlanes, counts[i]);
+    }
+
+    w.putU8(kModeInt);
+    w.putVarint(nPlanes);
+
+    // 分量数通道：每行主导值 + 例外
+    std::vector<std::pair<uint64_t, uint16_t>> exceptions;
+    std::vector<uint32_t> histogram;
+    for (uint32_t r = 0; r < nRows; ++r)
+    {
+        const uint16_t *rc = counts.data() + static_cast<uint64_t>(r) * nSamples;
+        histogram.assign(nPlanes + 1, 0);
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            ++histogram[rc[s]];
+        }
+        uint32_t dominant = static_cast<uint32_t>(std::max_element(histogram.begin(), histogram.end()) - histogram.begin());
+        w.putVarint(dominant);
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            if (rc[s] != dominant)
+            {
+                exceptions.emplace_back(static_cast<uint64_t>(r) * nSamples + s, rc[s]);
+            }
+        }
+    }
+    w.putVarint(exceptions.size());
+    uint64_t prev = 0;
+    for (const auto &e : exceptions)
+    {
+        w.putVarint(e.first - prev);
+        w.putVarint(e.second);
+        prev = e.first;
+    }
+
+    // 每个平面的缺失集合
+    for (uint32_t j = 0; j < nPlanes; ++j)
+    {
+        std::vector<uint64_t> items;
+        for (uint64_t i = 0; i < total; ++i)
+        {
+            if (counts[i] > j && comps[start[i] + j] == kMissingValue)
+            {
+                items.push_back(i);
+            }
+        }
+        IndexSet(std::move(items), total).write(w);
+    }
+
+    // 行带 × 样本分块 × 平面
+    const uint32_t nBands = (nRows + kTileRows - 1) / kTileRows;
+    std::vector<ByteWriter> bands(nBands);
+    for (uint32_t b = 0; b < nBands; ++b)
+    {
+        ByteWriter &bw = bands[b];
+        const uint32_t r0 = b * kTileRows;
+        const uint32_t r1 = std::min(nRows, r0 + kTileRows);
+        for (uint32_t s0 = 0; s0 < nSamples; s0 += kTileSamples)
+        {
+            const uint32_t s1 = std::min(nSamples, s0 + kTileSamples);
+            for (uint32_t j = 0; j < nPlanes; ++j)
+            {
+                auto valid = [&](uint32_t r, uint32_t s, int32_t &v) {
+                    uint64_t i = static_cast<uint64_t>(r) * nSamples + s;
+                    if (counts[i] <= j)
+                    {
+                        return false;
+                    }
+                    v = comps[start[i] + j];
+                    return v != kMissingValue;
+                };
+
+                size_t cost[3] = {0, 0, 0};
+                int32_t v = 0;
+                for (uint32_t r = r0; r < r1; ++r)
+                {
+                    int64_t prevS = 0;
+                    for (uint32_t s = s0; s < s1; ++s)
+                    {
+                        if (valid(r, s, v))
+                        {
+                            cost[kTileRaw] += svarintSize(v);
+                            cost[kTileDeltaSamples] += svarintSize(v - prevS);
+                            prevS = v;
+                        }
+                    }
+                }
+                for (uint32_t s = s0; s < s1; ++s)
+                {
+                    int64_t prevR = 0;
+                    for (uint32_t r = r0; r < r1; ++r)
+                    {
+                        if (valid(r, s, v))
+                        {
+                            cost[kTileDeltaRows] += svarintSize(v - prevR);
+                            prevR = v;
+                        }
+                    }
+                }
+                uint8_t mode = static_cast<uint8_t>(std::min_element(cost, cost + 3) - cost);
+                bw.putU8(mode);
+                if (mode == kTileDeltaRows)
+                {
+                    for (uint32_t s = s0; s < s1; ++s)
+                    {
+                        int64_t p = 0;
+                        for (uint32_t r = r0; r < r1; ++r)
+                        {
+                            if (valid(r, s, v))
+                            {
+                                bw.putSVarint(v - p);
+                                p = v;
+                            }
+                        }
+                    }
+                    continue;
+                }
+                for (uint32_t r = r0; r < r1; ++r)
+                {
+                    int64_t p = 0;
+                    for (uint32_t s = s0; s < s1; ++s)
+                    {
+                        if (valid(r, s, v))
+                        {
+                            bw.putSVarint(mode == kTileRaw ? v : v - p);
+                            p = v;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    w.putVarint(nBands);
+    for (const auto &bw : bands)
+    {
+        w.putVarint(bw.size());
+    }
+    for (const auto &bw : bands)
+    {
+        w.putBytes(bw.data.data(), bw.size());
+    }
+    return std::move(w.data);
+}
+
+FormatKeyDecoder::FormatKeyDecoder(std::vector<uint8_t> stream, uint32_t nRows, uint32_t nSamples)
+    : data(std::move(stream)), nRows(nRows), nSamples(nSamples)
+{
+    ByteReader r(data);
+    uint8_t mode = r.getU8();
+    if (mode == kModeText)
+    {
+        intMode = false;
+        const uint64_t total = static_cast<uint64_t>(nRows) * nSamples;
+        values.reserve(total);
+        std::string_view all(reinterpret_cast<const char *>(r.position()), r.remaining());
+        size_t start = 0;
+        for (uint64_t i = 0; i < total; ++i)
+        {
+            size_t nl = all.find('\n', start);
+            if (nl == std::string_view::npos)
+            {
+                throw std::runtime_error("Corrupt FORMAT text stream");
+            }
+            values.push_back(all.substr(start, nl - start));
+            start = nl + 1;
+        }
+        return;
+    }
+    if (mode != kModeInt)
+    {
+        throw std::runtime_error("Unknown FORMAT stream mode");
+    }
+    intMode = true;
+    nPlanes = static_cast<uint32_t>(r.getVarint());
+    rowCount.resize(nRows);
+    for (auto &c : rowCount)
+    {
+        c = static_cast<uint32_t>(r.getVarint());
+    }
+    size_t nExc = r.getVarint();
+    excIndex.resize(nExc);
+    excCount.resize(nExc);
+    uint64_t prev = 0;
+    for (size_t i = 0; i < nExc; ++i)
+    {
+        prev += r.getVarint();
+        excIndex[i] = prev;
+        excCount[i] = static_cast<uint16_t>(r.getVarint());
+    }
+    for (uint32_t j = 0; j < nPlanes; ++j)
+    {
+        missing.push_back(IndexSet::read(r));
+    }
+    size_t nBands = r.getVarint();
+    bandSize.resize(nBands);
+    for (auto &s : bandSize)
+    {
+        s = r.getVarint();
+    }
+    for (size_t b = 0; b < nBands; ++b)
+    {
+        bandData.push_back(r.getBytes(bandSize[b]));
+    }
+}
+
+void FormatKeyDecoder::decodeBand(uint32_t b)
+{
+    const uint32_t r0 = b * kTileRows;
+    const uint32_t r1 = std::min(nRows, r0 + kTileRows);
+    const uint64_t c0 = static_cast<uint64_t>(r0) * nSamples;
+    const uint64_t c1 = static_cast<uint64_t>(r1) * nSamples;
+
+    // 分量数：行主导值 + 例外
+    std::vector<uint16_t> cnt(c1 - c0);
+    for (uint32_t r = r0; r < r1; ++r)
+    {
+        std::fill(cnt.begin() + (static_cast<uint64_t>(r - r0) * nSamples),
+                  cnt.begin() + (static_cast<uint64_t>(r - r0 + 1) * nSamples), static_cast<uint16_t>(rowCount[r]));
+    }
+    size_t lo = std::lower_bound(excIndex.begin(), excIndex.end(), c0) - excIndex.begin();
+    for (size_t i = lo; i < excIndex.size() && excIndex[i] < c1; ++i)
+    {
+        cnt[excIndex[i] - c0] = excCount[i];
+    }
+    cellStart.assign(cnt.size() + 1, 0);
+    for (size_t i = 0; i < cnt.size(); ++i)
+    {
+        cellStart[i + 1] = cellStart[i] + cnt[i];
+    }
+    cellComps.assign(cellStart.back(), 0);
+    for (uint32_t j = 0; j < nPlanes; ++j)
+    {
+        missing[j].forEachInRange(c0, c1, [&](uint64_t i) { cellComps[cellStart[i - c0] + j] = kMissingValue; });
+    }
+
+    ByteReader br(bandData[b], bandSize[b]);
+    for (uint32_t s0 = 0; s0 < nSamples; s0 += kTileSamples)
+    {
+        const uint32_t s1 = std::min(nSamples, s0 + kTileSamples);
+        for (uint32_t j = 0; j < nPlanes; ++j)
+        {
+            auto slot = [&](uint32_t r, uint32_t s) -> int32_t * {
+                uint64_t i = static_cast<uint64_t>(r - r0) * nSamples + s;
+                if (cnt[i] <= j)
+                {
+                    return nullptr;
+                }
+                int32_t *p = &cellComps[cellStart[i] + j];
+                return *p == kMissingValue ? nullptr : p;
+            };
+            uint8_t mode = br.getU8();
+            if (mode == kTileDeltaRows)
+            {
+                for (uint32_t s = s0; s < s1; ++s)
+                {
+                    int64_t p = 0;
+                    for (uint32_t r = r0; r < r1; ++r)
+                    {
+                        if (int32_t *dst = slot(r, s))
+                        {
+                            p += br.getSVarint();
+                            *dst = static_cast<int32_t>(p);
+                        }
+                    }
+                }
+                continue;
+            }
+            for (uint32_t r = r0; r < r1; ++r)
+            {
+                int64_t p = 0;
+                for (uint32_t s = s0; s < s1; ++s)
+                {
+                    if (int32_t *dst = slot(r, s))
+                    {
+                        int64_t v = br.getSVarint();
+                        p = mode == kTileRaw ? v : p + v;
+                        *dst = static_cast<int32_t>(p);
+                    }
+                }
+            }
+        }
+    }
+    band = b;
+}
+
+void FormatKeyDecoder::appendValue(uint32_t row, uint32_t sample, std::string &out)
+{
+    if (!intMode)
+    {
+        out.append(values[static_cast<uint64_t>(row) * nSamples + sample]);
+        return;
+    }
+    uint32_t b = row / kTileRows;
+    if (b != band)
+    {
+        decodeBand(b);
+    }
+    uint64_t i = static_cast<uint64_t>(row - b * kTileRows) * nSamples + sample;
+    for (uint32_t c = cellStart[i]; c < cellStart[i + 1]; ++c)
+    {
+        if (c != cellStart[i])
+        {
+            out.push_back(',');
+        }
+        appendInt(cellComps[c], out);
+    }
+}
+
+bool FormatKeyDecoder::intValue(uint32_t row, uint32_t sample, uint32_t comp, int32_t &value)
+{
+    if (!intMode)
+    {
+        std::string_view text = values[static_cast<uint64_t>(row) * nSamples + sample];
+        for (uint32_t c = 0; c < comp; ++c)
+        {
+            size_t comma = text.find(',');
+            if (comma == std::string_view::npos)
+            {
+                return false;
+            }
+            text.remove_prefix(comma + 1);
+        }
+        text = text.substr(0, text.find(','));
+        auto res = std::from_chars(text.data(), text.data() + text.size(), value);
+        return res.ec == std::errc() && res.ptr == text.data() + text.size();
+    }
+    uint32_t b = row / kTileRows;
+    if (b != band)
+    {
+        decodeBand(b);
+    }
+    uint64_t i = static_cast<uint64_t>(row - b * kTileRows) * nSamples + sample;
+    if (cellStart[i] + comp >= cellStart[i + 1])
+    {
+        return false;
+    }
+    value = cellComps[cellStart[i] + comp];
+    return value != kMissingValue;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "index_set.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// FORMAT 字段（GT 以外）的列式编码：每个键一个流，互不依赖。
+//
+// 整数键（块内所有取值均为规范十进制整数或 '.'，含 Number=A/R/G 的逗号向量）
+// 编码为 变异 × 样本 的整数矩阵：
+//   - 分量数通道：每行主导分量数 + 例外（0 表示该样本无此键）
+//   - 向量按分量拆成独立平面（AD 的 ref/alt、PL 的各基因型）
+//   - 每个平面按 kTileRows × kTileSamples 分块，块内在「原值 / 沿样本差分 / 沿变异差分」
+//     中取编码长度最小者，沿变异差分时按转置顺序写出
+//   - '.' 分量记入每个平面的缺失集合
+// 其余键按原文本逐格保存。
+
+constexpr uint32_t kTileRows = 128;
+constexpr uint32_t kTileSamples = 128;
+
+class FormatKeyEncoder
+{
+public:
+    explicit FormatKeyEncoder(uint32_t nSamples);
+
+    // 按 (row, sample) 递增顺序调用；未调用的格子视为该样本无此键
+    void add(uint32_t row, uint32_t sample, std::string_view value);
+
+    std::vector<uint8_t> finish(uint32_t nRows);
+
+    bool isInteger() const { return intMode; }
+
+private:
+    uint32_t nSamples;
+    uint64_t nCells = 0;           // 已写入（含缺席填充）的格子数
+    bool intMode = true;
+
+    // 整数模式
+    std::vector<uint16_t> counts;  // 每格分量数
+    std::vector<int32_t> comps;    // 各格分量顺序排列，'.' 为 kMissingValue
+    // 文本模式：每格一个值，以 '\n' 结尾
+    std::string text;
+
+    void padTo(uint64_t cell);
+    void switchToText();
+    bool parseInts(std::string_view value);
+};
+
+class FormatKeyDecoder
+{
+public:
+    FormatKeyDecoder(std::vector<uint8_t> stream, uint32_t nRows, uint32_t nSamples);
+
+    FormatKeyDecoder(const FormatKeyDecoder &) = delete;
+    FormatKeyDecoder &operator=(const FormatKeyDecoder &) = delete;
+    FormatKeyDecoder(FormatKeyDecoder &&) = default;
+    FormatKeyDecoder &operator=(FormatKeyDecoder &&) = default;
+
+    bool isInteger() const { return intMode; }
+
+    // 把 (row, sample) 的值以文本追加到 out；整数模式按行带解码，顺序访问最快
+    void appendValue(uint32_t row, uint32_t sample, std::string &out);
+
+    // 读取 (row, sample) 第 comp 个分量的整数值；无此键、缺失或非整数时返回 false
+    bool intValue(uint32_t row, uint32_t sample, uint32_t comp, int32_t &value);
+
+private:
+    std::vector<uint8_t> data;
+    uint32_t nRows;
+    uint32_t nSamples;
+    bool intMode = false;
+
+    // 文本模式
+    std::vector<std::string_view> values;
+
+    // 整数模式
+    uint32_t nPlanes = 0;
+    std::vector<uint32_t> rowCount;
+    std::vector<uint64_t> excIndex;
+    std::vector<uint16_t> excCount;
+    std::vector<IndexSet> missing;
+    std::vector<const uint8_t *> bandData;
+    std::vector<size_t> bandSize;
+
+    // 当前已解码的行带
+    uint32_t band = UINT32_MAX;
+    std::vector<uint32_t> cellStart;
+    std::vector<int32_t> cellComps;
+
+    void decodeBand(uint32_t b);
+};
@@ -0,0 +1,859 @@
+#include "genotype.hpp"
+#include "itoa.hpp"
+#include "transpose.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint8_t kMetaPhased = 0x10;
+    constexpr uint8_t kMetaIrregular = 0x20;
+    constexpr uint8_t kFlagPhased = 0x01;
+    constexpr uint8_t kFlagSampleMajor = 0x02;
+
+    // 解析一个 GT 文本；返回 false 表示需要按原文保存
+    bool parseGenotype(std::string_view text, uint16_t *out, uint8_t &ploidy, char &sep)
+    {
+        ploidy = 0;
+        sep = 0;
+        size_t i = 0;
+        while (true)
+        {
+            if (ploidy == kMaxPloidy || i >= text.size())
+            {
+                return false;
+            }
+            if (text[i] == '.')
+            {
+                out[ploidy++] = kMissingAllele;
+                ++i;
+            }
+            else
+            {
+                if (text[i] < '0' || text[i] > '9' || (text[i] == '0' && i + 1 < text.size() &&
+                                                        text[i + 1] >= '0' && text[i + 1] <= '9'))
+                {
+                    return false;
+                }
+                uint32_t v = 0;
+                while (i < text.size() && text[i] >= '0' && text[i] <= '9')
+                {
+                    v = v * 10 + (text[i] - '0');
+                    if (v > kMaxAlleleValue)
+                    {
+                        return false;
+                    }
+                    ++i;
+                }
+                out[ploidy++] = static_cast<uint16_t>(v);
+            }
+            if (i == text.size())
+            {
+                return true;
+            }
+            char c = text[i++];
+            if ((c != '|' && c != '/') || (sep != 0 && c != sep))
+            {
+                return false;
+            }
+            sep = c;
+        }
+    }
+
+    uint8_t bitWidth(uint16_t v)
+    {
+        uint8_t n = 1;
+        while (v >> n)
+        {
+            ++n;
+        }
+        return n;
+    }
+
+    inline uint64_t loadWord(const uint8_t *p)
+    {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        return w;
+    }
+
+    // 位平面 -> 等位基因编号；Bits 为 0 时按运行时位数处理
+    template <uint8_t Bits>
+    void unpackPlanes(const uint8_t *rowBits, size_t W, uint8_t nBits, uint16_t *dst)
+    {
+        if constexpr (Bits != 0)
+        {
+            nBits = Bits;
+        }
+        for (size_t w = 0; w < W; ++w, dst += 64)
+        {
+            uint64_t word = loadWord(rowBits + w * 8);
+            for (int j = 0; j < 64; ++j)
+            {
+                dst[j] = static_cast<uint16_t>((word >> j) & 1);
+            }
+            if constexpr (Bits == 1)
+            {
+                continue;
+            }
+            for (uint8_t b = 1; b < nBits; ++b)
+            {
+                word = loadWord(rowBits + (b * W + w) * 8);
+                for (int j = 0; j < 64; ++j)
+                {
+                    dst[j] |= static_cast<uint16_t>(((word >> j) & 1) << b);
+                }
+            }
+        }
+    }
+
+    // 二倍体第 0 平面 -> PLINK 编码：每样本的两位 (a, b) 为 ALT 计数，0/1/2 个 ALT 分别得 11/10/00
+    inline uint64_t plinkCodes(uint64_t bits)
+    {
+        constexpr uint64_t kLow = 0x5555555555555555ull;
+        const uint64_t a = bits & kLow;
+        const uint64_t b = (bits >> 1) & kLow;
+        return (~(a | b) & kLow) | ((~(a & b) & kLow) << 1);
+    }
+
+    // 同 plinkCodes，一次 4 个字；返回处理的字数
+    size_t plinkCodesAvx2(const uint8_t *src, size_t nWords, uint8_t *dst)
+    {
+        size_t w = 0;
+#ifdef __AVX2__
+        const __m256i low = _mm256_set1_epi64x(0x5555555555555555ll);
+        for (; w + 4 <= nWords; w += 4)
+        {
+            __m256i bits = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + w * 8));
+            __m256i a = _mm256_and_si256(bits, low);
+            __m256i b = _mm256_and_si256(_mm256_srli_epi64(bits, 1), low);
+            __m256i lo = _mm256_andnot_si256(_mm256_or_si256(a, b), low);
+            __m256i hi = _mm256_andnot_si256(_mm256_and_si256(a, b), low);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + w * 8),
+                                _mm256_or_si256(lo, _mm256_slli_epi64(hi, 1)));
+        }
+#else
+        (void)src;
+        (void)nWords;
+        (void)dst;
+#endif
+        return w;
+    }
+
+    // 平面字节 -> token：二倍体每字节 4 个样本 "\ta|b"，单倍体每字节 8 个样本 "\ta"，都是 16 字节
+    struct ByteTokens
+    {
+        char text[256][16];
+    };
+
+    ByteTokens makeByteTokens(uint8_t ploidy, char sep)
+    {
+        ByteTokens t;
+        for (int v = 0; v < 256; ++v)
+        {
+            char *p = t.text[v];
+            for (int bit = 0; bit < 8; bit += ploidy)
+            {
+                *p++ = '\t';
+                *p++ = static_cast<char>('0' + ((v >> bit) & 1));
+                if (ploidy == 2)
+                {
+                    *p++ = sep;
+                    *p++ = static_cast<char>('0' + ((v >> (bit + 1)) & 1));
+                }
+            }
+        }
+        return t;
+    }
+
+    // 一位数等位基因对 (a, b) -> "\ta|b"
+    struct PairTokens
+    {
+        char text[64][4];
+    };
+
+    PairTokens makePairTokens(char sep)
+    {
+        PairTokens t;
+        for (int a = 0; a < 8; ++a)
+        {
+            for (int b = 0; b < 8; ++b)
+            {
+                t.text[a * 8 + b][0] = '\t';
+                t.text[a * 8 + b][1] = static_cast<char>('0' + a);
+                t.text[a * 8 + b][2] = sep;
+                t.text[a * 8 + b][3] = static_cast<char>('0' + b);
+            }
+        }
+        return t;
+    }
+
+    const ByteTokens kPhasedBytes = makeByteTokens(2, '|');
+    const ByteTokens kUnphasedBytes = makeByteTokens(2, '/');
+    const ByteTokens kHaploidBytes = makeByteTokens(1, 0);
+    const PairTokens kPhasedPairs = makePairTokens('|');
+    const PairTokens kUnphasedPairs = makePairTokens('/');
+
+    inline void setPlinkCode(uint8_t *out, uint32_t sample, uint8_t code)
+    {
+        const int shift = 2 * (sample & 3);
+        out[sample >> 2] = static_cast<uint8_t>((out[sample >> 2] & ~(3 << shift)) | (code << shift));
+    }
+
+    // 通用路径：任意倍性、多位数等位基因、缺失与非常规文本
+    void appendGeneric(const GenotypeRow &row, uint32_t sample, uint8_t blockPloidy, std::string &out)
+    {
+        uint8_t p = row.ploidy[sample];
+        if (p == 0)
+        {
+            for (const auto &e : row.irregular)
+            {
+                if (e.first == sample)
+                {
+                    out.append(e.second);
+                    return;
+                }
+            }
+            return;
+        }
+        const uint16_t *a = row.alleles.data() + static_cast<size_t>(sample) * blockPloidy;
+        char sep = row.phased[sample] ? '|' : '/';
+        for (uint8_t k = 0; k < p; ++k)
+        {
+            if (k)
+            {
+                out.push_back(sep);
+            }
+            if (a[k] == kMissingAllele)
+            {
+                out.push_back('.');
+            }
+            else
+            {
+                appendUnsigned(a[k], out);
+            }
+        }
+    }
+
+    // Ploidy 为 0 表示运行时倍性；SingleDigit 表示块内等位基因编号都小于 10
+    template <uint8_t Ploidy, bool SingleDigit>
+    void appendSpecialized(const GenotypeRow &row, uint32_t sample, std::string &out)
+    {
+        if constexpr (Ploidy == 0 || !SingleDigit)
+        {
+            appendGeneric(row, sample, row.blockPloidy, out);
+        }
+        else
+        {
+            const uint16_t *a = row.alleles.data() + static_cast<size_t>(sample) * Ploidy;
+            if (row.ploidy[sample] != Ploidy)
+            {
+                appendGeneric(row, sample, Ploidy, out);
+                return;
+            }
+            // 常见情形：固定长度的直线写出，缺失映射为 '.'
+            char buf[Ploidy * 2 - 1];
+            const char sep = row.phased[sample] ? '|' : '/';
+            for (uint8_t k = 0; k < Ploidy; ++k)
+            {
+                buf[k * 2] = a[k] == kMissingAllele ? '.' : static_cast<char>('0' + a[k]);
+                if constexpr (Ploidy > 1)
+                {
+                    if (k + 1 < Ploidy)
+                    {
+                        buf[k * 2 + 1] = sep;
+                    }
+                }
+            }
+            out.append(buf, sizeof(buf));
+        }
+    }
+
+    GenotypeAppender selectAppender(uint8_t ploidy, uint8_t nBits)
+    {
+        // 位数 <= 3 时编号最大为 7，一位数字
+        const bool single = nBits <= 3;
+        switch (ploidy)
+        {
+        case 1:
+            return single ? appendSpecialized<1, true> : appendSpecialized<0, false>;
+        case 2:
+            return single ? appendSpecialized<2, true> : appendSpecialized<0, false>;
+        default:
+            return appendSpecialized<0, false>;
+        }
+    }
+}
+
+GenotypeEncoder::GenotypeEncoder(uint32_t nSamples) : nSamples(nSamples) {}
+
+void GenotypeEncoder::beginRow(bool hasGt)
+{
+    rowHasGt.push_back(hasGt ? 1 : 0);
+    ++nRows;
+    curSample = 0;
+}
+
+void GenotypeEncoder::addGenotype(std::string_view text)
+{
+    uint16_t buf[kMaxPloidy];
+    uint8_t ploidy = 0;
+    char sep = 0;
+    if (!parseGenotype(text, buf, ploidy, sep))
+    {
+        addIrregular(text);
+        return;
+    }
+    addParsed(buf, ploidy, sep);
+}
+
+void GenotypeEncoder::addGenotype(const GenotypeRow &row, uint32_t sample)
+{
+    const uint8_t ploidy = row.ploidy[sample];
+    if (ploidy == 0)
+    {
+        // irregular 按样本递增
+        using Irregular = std::pair<uint32_t, std::string_view>;
+        auto it = std::lower_bound(row.irregular.begin(), row.irregular.end(), sample,
+                                   [](const Irregular &e, uint32_t s) { return e.first < s; });
+        addIrregular(it == row.irregular.end() || it->first != sample ? std::string_view(".") : it->second);
+        return;
+    }
+    // 单倍体没有分隔符，与文本输入一致不计相位
+    const char sep = ploidy < 2 ? 0 : row.phased[sample] ? '|' : '/';
+    addParsed(row.alleles.data() + static_cast<size_t>(sample) * row.blockPloidy, ploidy, sep);
+}
+
+void GenotypeEncoder::addIrregular(std::string_view text)
+{
+    const uint32_t s = curSample++;
+    meta.push_back(kMetaIrregular);
+    irregular.emplace_back(static_cast<uint64_t>(nRows - 1) * nSamples + s, std::string(text));
+}
+
+void GenotypeEncoder::addParsed(const uint16_t *buf, uint8_t ploidy, char sep)
+{
+    ++curSample;
+    uint8_t m = ploidy;
+    if (sep == '|')
+    {
+        m |= kMetaPhased;
+        ++nPhased;
+    }
+    else if (sep == '/')
+    {
+        ++nUnphased;
+    }
+    meta.push_back(m);
+    maxPloidy = std::max(maxPloidy, ploidy);
+    for (uint8_t k = 0; k < ploidy; ++k)
+    {
+        alleles.push_back(buf[k]);
+        if (buf[k] != kMissingAllele)
+        {
+            maxAllele = std::max(maxAllele, buf[k]);
+        }
+    }
+}
+
+std::vector<uint8_t> GenotypeEncoder::finish(GenotypeLayout layout) const
+{
+    const uint8_t P = maxPloidy;
+    const uint8_t B = bitWidth(maxAllele);
+    const bool phasedDefault = nPhased >= nUnphased;
+    const uint64_t slots = static_cast<uint64_t>(nSamples) * P;
+    const size_t W = (slots + 63) / 64;
+
+    std::vector<uint64_t> noGt;
+    std::vector<uint64_t> phaseExc;
+    std::vector<uint64_t> missing;
+    std::vector<std::pair<uint64_t, uint8_t>> ploidyExc;
+    std::vector<uint64_t> planes(static_cast<size_t>(nRows) * B * W, 0);
+
+    size_t g = 0;
+    size_t a = 0;
+    for (uint32_t r = 0; r < nRows; ++r)
+    {
+        if (!rowHasGt[r])
+        {
+            noGt.push_back(r);
+            continue;
+        }
+        uint64_t *rowPlanes = planes.data() + static_cast<size_t>(r) * B * W;
+        for (uint32_t s = 0; s < nSamples; ++s, ++g)
+        {
+            uint8_t m = meta[g];
+            if (m & kMetaIrregular)
+            {
+                continue;
+            }
+            uint64_t gi = static_cast<uint64_t>(r) * nSamples + s;
+            uint8_t p = m & 0x0F;
+            if (p != P)
+            {
+                ploidyExc.emplace_back(gi, p);
+            }
+            if (p >= 2 && static_cast<bool>(m & kMetaPhased) != phasedDefault)
+            {
+                phaseExc.push_back(gi);
+            }
+            for (uint8_t k = 0; k < p; ++k, ++a)
+            {
+                uint64_t slot = static_cast<uint64_t>(s) * P + k;
+                uint16_t v = alleles[a];
+                if (v == kMissingAllele)
+                {
+                    missing.push_back(gi * P + k);
+                    continue;
+                }
+                for (uint8_t b = 0; b < B; ++b)
+                {
+                    rowPlanes[b * W + (slot >> 6)] |= static_cast<uint64_t>((v >> b) & 1) << (slot & 63);
+                }
+            }
+        }
+    }
+
+    ByteWriter w;
+    w.putVarint(nRows);
+    w.putVarint(nSamples);
+    w.putU8(P);
+    w.putU8(B);
+    const bool sampleMajor = layout == GenotypeLayout::SampleMajor;
+    w.putU8((phasedDefault ? kFlagPhased : 0) | (sampleMajor ? kFlagSampleMajor : 0));
+    IndexSet(std::move(noGt), nRows).write(w);
+    IndexSet(std::move(phaseExc), static_cast<uint64_t>(nRows) * nSamples).write(w);
+    IndexSet(std::move(missing), static_cast<uint64_t>(nRows) * nSamples * P).write(w);
+
+    w.putVarint(ploidyExc.size());
+    uint64_t prev = 0;
+    for (const auto &e : ploidyExc)
+    {
+        w.putVarint(e.first - prev);
+        w.putU8(e.second);
+        prev = e.first;
+    }
+    w.putVarint(irregular.size());
+    prev = 0;
+    for (const auto &e : irregular)
+    {
+        w.putVarint(e.first - prev);
+        w.putString(e.second);
+        prev = e.first;
+    }
+    if (!sampleMajor)
+    {
+        for (uint64_t word : planes)
+        {
+            w.putU64(word);
+        }
+        return std::move(w.data);
+    }
+
+    // 样本主序：[平面][槽位][64 行一字]，行数补齐到 64 的倍数
+    const size_t RW = (nRows + 63) / 64;
+    std::vector<uint64_t> transposed(static_cast<size_t>(B) * W * 64 * RW);
+    uint64_t tile[64];
+    for (size_t t = 0; t < RW; ++t)
+    {
+        for (uint8_t b = 0; b < B; ++b)
+        {
+            for (size_t wi = 0; wi < W; ++wi)
+            {
+                for (size_t i = 0; i < 64; ++i)
+                {
+                    size_t r = t * 64 + i;
+                    tile[i] = r < nRows ? planes[(r * B + b) * W + wi] : 0;
+                }
+                transpose64(tile);
+                uint64_t *dst = transposed.data() + (static_cast<size_t>(b) * W + wi) * 64 * RW + t;
+                for (size_t j = 0; j < 64; ++j)
+                {
+                    dst[j * RW] = tile[j];
+                }
+            }
+        }
+    }
+    for (uint64_t word : transposed)
+    {
+        w.putU64(word);
+    }
+    return std::move(w.data);
+}
+
+GenotypeDecoder::GenotypeDecoder(std::vector<uint8_t> stream) : data(std::move(stream))
+{
+    ByteReader r(data);
+    nRows = static_cast<uint32_t>(r.getVarint());
+    nSamples = static_cast<uint32_t>(r.getVarint());
+    blockPloidy = r.getU8();
+    nBits = r.getU8();
+    uint8_t flags = r.getU8();
+    phasedDefault = flags & kFlagPhased;
+    planeLayout = (flags & kFlagSampleMajor) ? GenotypeLayout::SampleMajor : GenotypeLayout::VariantMajor;
+    if (blockPloidy == 0 || blockPloidy > kMaxPloidy || nBits == 0 || nBits > 16)
+    {
+        throw std::runtime_error("Corrupt genotype stream header");
+    }
+    noGtRows = IndexSet::read(r);
+    phaseExceptions = IndexSet::read(r);
+    missing = IndexSet::read(r);
+
+    size_t n = r.getVarint();
+    ploidyIndex.resize(n);
+    ploidyValue.resize(n);
+    uint64_t prev = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        prev += r.getVarint();
+        ploidyIndex[i] = prev;
+        ploidyValue[i] = r.getU8();
+    }
+    n = r.getVarint();
+    irregularIndex.resize(n);
+    irregularText.resize(n);
+    prev = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        prev += r.getVarint();
+        irregularIndex[i] = prev;
+        irregularText[i] = r.getString();
+    }
+
+    wordsPerPlane = (static_cast<uint64_t>(nSamples) * blockPloidy + 63) / 64;
+    rowWords = (nRows + 63) / 64;
+    if (planeLayout == GenotypeLayout::SampleMajor)
+    {
+        planes = r.getBytes(static_cast<size_t>(nBits) * wordsPerPlane * 64 * rowWords * 8);
+    }
+    else
+    {
+        planes = r.getBytes(static_cast<size_t>(nRows) * nBits * wordsPerPlane * 8);
+    }
+
+    switch (nBits)
+    {
+    case 1:
+        unpack = unpackPlanes<1>;
+        break;
+    case 2:
+        unpack = unpackPlanes<2>;
+        break;
+    case 3:
+        unpack = unpackPlanes<3>;
+        break;
+    default:
+        unpack = unpackPlanes<0>;
+        break;
+    }
+    append = selectAppender(blockPloidy, nBits);
+}
+
+const uint8_t *GenotypeDecoder::rowPlanes(uint32_t row) const
+{
+    const size_t W = wordsPerPlane;
+    if (planeLayout == GenotypeLayout::VariantMajor)
+    {
+        return planes + static_cast<size_t>(row) * nBits * W * 8;
+    }
+
+    // 样本主序：把行所在的 64 行转置回变异主序后缓存，顺序按行访问时每 64 行转置一次
+    uint32_t t = row / 64;
+    if (t != cachedBand)
+    {
+        bandRows.assign(64 * nBits * W, 0);
+        uint64_t tile[64];
+        for (uint8_t b = 0; b < nBits; ++b)
+        {
+            for (size_t wi = 0; wi < W; ++wi)
+            {
+                const uint8_t *src = planes + ((static_cast<size_t>(b) * W + wi) * 64 * rowWords + t) * 8;
+                for (size_t j = 0; j < 64; ++j)
+                {
+                    tile[j] = loadWord(src + j * rowWords * 8);
+                }
+                transpose64(tile);
+                for (size_t i = 0; i < 64; ++i)
+                {
+                    bandRows[(i * nBits + b) * W + wi] = tile[i];
+                }
+            }
+        }
+        cachedBand = t;
+    }
+    return reinterpret_cast<const uint8_t *>(bandRows.data() + static_cast<size_t>(row % 64) * nBits * W);
+}
+
+void GenotypeDecoder::decodeRow(uint32_t row, GenotypeRow &out) const
+{
+    const uint8_t P = blockPloidy;
+    const size_t slots = static_cast<size_t>(nSamples) * P;
+    const size_t W = wordsPerPlane;
+    out.alleles.resize(W * 64);
+    out.blockPloidy = P;
+    out.ploidy.assign(nSamples, P);
+    out.phased.assign(nSamples, phasedDefault ? 1 : 0);
+    out.irregular.clear();
+
+    // 位平面 -> 等位基因编号，逐槽位无分支
+    unpack(rowPlanes(row), W, nBits, out.alleles.data());
+    out.alleles.resize(slots);
+
+    // 旁路信息按行打补丁
+    const uint64_t g0 = static_cast<uint64_t>(row) * nSamples;
+    const uint64_t g1 = g0 + nSamples;
+    missing.forEachInRange(g0 * P, g1 * P, [&](uint64_t v) { out.alleles[v - g0 * P] = kMissingAllele; });
+    phaseExceptions.forEachInRange(g0, g1, [&](uint64_t v) { out.phased[v - g0] ^= 1; });
+
+    auto lo = std::lower_bound(ploidyIndex.begin(), ploidyIndex.end(), g0) - ploidyIndex.begin();
+    for (size_t i = lo; i < ploidyIndex.size() && ploidyIndex[i] < g1; ++i)
+    {
+        out.ploidy[ploidyIndex[i] - g0] = ploidyValue[i];
+    }
+    lo = std::lower_bound(irregularIndex.begin(), irregularIndex.end(), g0) - irregularIndex.begin();
+    for (size_t i = lo; i < irregularIndex.size() && irregularIndex[i] < g1; ++i)
+    {
+        uint32_t s = static_cast<uint32_t>(irregularIndex[i] - g0);
+        out.ploidy[s] = 0;
+        out.irregular.emplace_back(s, irregularText[i]);
+    }
+}
+
+void GenotypeDecoder::decodeSample(uint32_t sample, GenotypeColumn &out) const
+{
+    const uint8_t P = blockPloidy;
+    const size_t W = wordsPerPlane;
+    out.alleles.assign(static_cast<size_t>(nRows) * P, 0);
+    out.ploidy.assign(nRows, P);
+    out.phased.assign(nRows, phasedDefault ? 1 : 0);
+    out.irregular.assign(nRows, std::string_view());
+
+    for (uint8_t k = 0; k < P; ++k)
+    {
+        const size_t slot = static_cast<size_t>(sample) * P + k;
+        for (uint8_t b = 0; b < nBits; ++b)
+        {
+            if (planeLayout == GenotypeLayout::SampleMajor)
+            {
+                // 该槽位在本平面的全部行是一段连续的 rowWords 个字
+                const uint8_t *src = planes + ((static_cast<size_t>(b) * W * 64 + slot) * rowWords) * 8;
+                for (size_t t = 0; t < rowWords; ++t)
+                {
+                    uint64_t word = loadWord(src + t * 8);
+                    uint32_t end = std::min<uint32_t>(64, nRows - static_cast<uint32_t>(t * 64));
+                    uint16_t *dst = out.alleles.data() + t * 64 * P + k;
+                    for (uint32_t i = 0; i < end; ++i)
+                    {
+                        dst[i * P] |= static_cast<uint16_t>(((word >> i) & 1) << b);
+                    }
+                }
+            }
+            else
+            {
+                for (uint32_t r = 0; r < nRows; ++r)
+                {
+                    const uint8_t *p = planes + ((static_cast<size_t>(r) * nBits + b) * W + (slot >> 6)) * 8;
+                    out.alleles[static_cast<size_t>(r) * P + k] |=
+                        static_cast<uint16_t>(((loadWord(p) >> (slot & 63)) & 1) << b);
+                }
+            }
+        }
+    }
+
+    // 旁路信息逐行查询
+    auto ploidyIt = ploidyIndex.begin();
+    auto irregularIt = irregularIndex.begin();
+    for (uint32_t r = 0; r < nRows; ++r)
+    {
+        const uint64_t gi = static_cast<uint64_t>(r) * nSamples + sample;
+        for (uint8_t k = 0; k < P; ++k)
+        {
+            if (missing.contains(gi * P + k))
+            {
+                out.alleles[static_cast<size_t>(r) * P + k] = kMissingAllele;
+            }
+        }
+        if (phaseExceptions.contains(gi))
+        {
+            out.phased[r] ^= 1;
+        }
+        ploidyIt = std::lower_bound(ploidyIt, ploidyIndex.end(), gi);
+        if (ploidyIt != ploidyIndex.end() && *ploidyIt == gi)
+        {
+            out.ploidy[r] = ploidyValue[ploidyIt - ploidyIndex.begin()];
+        }
+        irregularIt = std::lower_bound(irregularIt, irregularIndex.end(), gi);
+        if (irregularIt != irregularIndex.end() && *irregularIt == gi)
+        {
+            out.ploidy[r] = 0;
+            out.irregular[r] = irregularText[irregularIt - irregularIndex.begin()];
+        }
+    }
+}
+
+bool GenotypeDecoder::appendRowText(uint32_t row, std::string &out) const
+{
+    const uint8_t P = blockPloidy;
+    if (P > 2 || nBits > 3 || !hasGt(row))
+    {
+        return false;
+    }
+
+    // 本行有例外的样本，升序
+    const uint64_t g0 = static_cast<uint64_t>(row) * nSamples;
+    const uint64_t g1 = g0 + nSamples;
+    rowExceptions.clear();
+    missing.forEachInRange(g0 * P, g1 * P, [&](uint64_t v) { rowExceptions.push_back(static_cast<uint32_t>(v / P - g0)); });
+    phaseExceptions.forEachInRange(g0, g1, [&](uint64_t v) { rowExceptions.push_back(static_cast<uint32_t>(v - g0)); });
+    for (const std::vector<uint64_t> *side : {&ploidyIndex, &irregularIndex})
+    {
+        for (auto it = std::lower_bound(side->begin(), side->end(), g0); it != side->end() && *it < g1; ++it)
+        {
+            rowExceptions.push_back(static_cast<uint32_t>(*it - g0));
+        }
+    }
+    std::sort(rowExceptions.begin(), rowExceptions.end());
+    bool decoded = false;
+    size_t e = 0;
+    // [s0, s1) 中有例外时整段走通用路径，返回 true
+    auto slowChunk = [&](uint32_t s0, uint32_t s1)
+    {
+        if (e == rowExceptions.size() || rowExceptions[e] >= s1)
+        {
+            return false;
+        }
+        if (!decoded)
+        {
+            decodeRow(row, slowRow);
+            decoded = true;
+        }
+        for (uint32_t s = s0; s < s1; ++s)
+        {
+            out += '\t';
+            append(slowRow, s, out);
+        }
+        while (e < rowExceptions.size() && rowExceptions[e] < s1)
+        {
+            ++e;
+        }
+        return true;
+    };
+
+    const uint8_t *bits = rowPlanes(row);
+    const size_t W = wordsPerPlane;
+    bool singlePlane = true;
+    for (size_t w = W; w < nBits * W && singlePlane; ++w)
+    {
+        singlePlane = loadWord(bits + w * 8) == 0;
+    }
+    out.reserve(out.size() + static_cast<size_t>(nSamples) * 2 * P + 16);
+    if (singlePlane)
+    {
+        const ByteTokens &tokens = P == 1 ? kHaploidBytes : phasedDefault ? kPhasedBytes : kUnphasedBytes;
+        const uint32_t perByte = 8 / P;
+        for (uint32_t s0 = 0; s0 < nSamples; s0 += perByte)
+        {
+            const uint32_t s1 = std::min(s0 + perByte, nSamples);
+            if (!slowChunk(s0, s1))
+            {
+                out.append(tokens.text[bits[s0 / perByte]], (s1 - s0) * 2 * P);
+            }
+        }
+        return true;
+    }
+
+    rowAlleles.resize(W * 64);
+    unpack(bits, W, nBits, rowAlleles.data());
+    const PairTokens &pairs = phasedDefault ? kPhasedPairs : kUnphasedPairs;
+    for (uint32_t s = 0; s < nSamples; ++s)
+    {
+        if (slowChunk(s, s + 1))
+        {
+            continue;
+        }
+        if (P == 2)
+        {
+            out.append(pairs.text[rowAlleles[2 * s] * 8 + rowAlleles[2 * s + 1]], 4);
+        }
+        else
+        {
+            out += '\t';
+            out += static_cast<char>('0' + rowAlleles[s]);
+        }
+    }
+    return true;
+}
+
+void GenotypeDecoder::packPlinkRow(uint32_t row, uint8_t *out) const
+{
+    const size_t nBytes = (static_cast<size_t>(nSamples) + 3) / 4;
+    if (!hasGt(row))
+    {
+        std::memset(out, kPlinkMissing * 0x55, nBytes);
+    }
+    else if (blockPloidy == 2)
+    {
+        // 每个平面字覆盖 32 个样本，正好是 8 个输出字节
+        const uint8_t *bits = rowPlanes(row);
+        const size_t full = nBytes / 8;
+        size_t w = plinkCodesAvx2(bits, full, out);
+        for (; w < full; ++w)
+        {
+            uint64_t codes = plinkCodes(loadWord(bits + w * 8));
+            std::memcpy(out + w * 8, &codes, 8);
+        }
+        if (nBytes > full * 8)
+        {
+            uint64_t codes = plinkCodes(loadWord(bits + full * 8));
+            std::memcpy(out + full * 8, &codes, nBytes - full * 8);
+        }
+
+        const uint64_t g0 = static_cast<uint64_t>(row) * nSamples;
+        const uint64_t g1 = g0 + nSamples;
+        auto lo = std::lower_bound(ploidyIndex.begin(), ploidyIndex.end(), g0) - ploidyIndex.begin();
+        for (size_t i = lo; i < ploidyIndex.size() && ploidyIndex[i] < g1; ++i)
+        {
+            const uint32_t s = static_cast<uint32_t>(ploidyIndex[i] - g0);
+            const bool alt = (loadWord(bits + (s >> 5) * 8) >> (2 * (s & 31))) & 1;
+            setPlinkCode(out, s, ploidyValue[i] == 1 ? (alt ? kPlinkHomAlt : kPlinkHomRef) : kPlinkMissing);
+        }
+        missing.forEachInRange(g0 * 2, g1 * 2, [&](uint64_t v)
+                               { setPlinkCode(out, static_cast<uint32_t>((v - g0 * 2) / 2), kPlinkMissing); });
+        lo = std::lower_bound(irregularIndex.begin(), irregularIndex.end(), g0) - irregularIndex.begin();
+        for (size_t i = lo; i < irregularIndex.size() && irregularIndex[i] < g1; ++i)
+        {
+            setPlinkCode(out, static_cast<uint32_t>(irregularIndex[i] - g0), kPlinkMissing);
+        }
+    }
+    else
+    {
+        GenotypeRow decoded;
+        decodeRow(row, decoded);
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            const uint8_t p = decoded.ploidy[s];
+            const uint16_t *a = decoded.alleles.data() + static_cast<size_t>(s) * blockPloidy;
+            uint8_t code = kPlinkMissing;
+            if (p == 1 && a[0] <= 1)
+            {
+                code = a[0] ? kPlinkHomAlt : kPlinkHomRef;
+            }
+            else if (p == 2 && a[0] <= 1 && a[1] <= 1)
+            {
+                code = a[0] + a[1] == 0 ? kPlinkHomRef : a[0] + a[1] == 1 ? kPlinkHet : kPlinkHomAlt;
+            }
+            setPlinkCode(out, s, code);
+        }
+    }
+    if (nSamples & 3)
+    {
+        out[nBytes - 1] &= static_cast<uint8_t>((1u << (2 * (nSamples & 3))) - 1);
+    }
+}
+
+void appendGenotype(const GenotypeRow &row, uint32_t sample, uint8_t blockPloidy, std::string &out)
+{
+    appendGeneric(row, sample, blockPloidy, out);
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "index_set.hpp"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// GT 列编码
+//
+// 每个块内的基因型被拆成：
+//   - 位平面：每个单倍型槽位 1 bit/平面，平面数 = 块内最大等位基因编号所需位数，
+//     槽位数 = 样本数 × 块倍性（块内最大倍性）
+//   - 旁路信息（稀疏）：
+//       相位：块级默认相位（全部 '|' 或全部 '/'），与默认不同的基因型记入例外列表
+//       缺失：'.' 等位基因所在槽位的位图
+//       倍性：倍性不等于块倍性的基因型（如 chrX 男性的单倍体）记入例外列表
+//       非常规：无法按上述模型无损表示的原始文本（如 "0/1|2"）
+// 常见情形（全部相位一致、二倍体、无缺失）只剩纯位平面，解码热循环不按基因型分支。
+//
+// 位平面有两种布局：
+//   - 变异主序：每行依次存放各平面的槽位位向量，按行解码最快
+//   - 样本主序：以 64×64 位块转置后存放，每个槽位在块内全部行的位连续存放，
+//     提取单个样本只需读取每个平面中一段连续字节
+
+constexpr uint16_t kMissingAllele = 0xFFFF;
+constexpr uint16_t kMaxAlleleValue = 0x7FFF;
+constexpr uint8_t kMaxPloidy = 8;
+
+// PLINK 1 .bed 的 2 bit 基因型编码（A1 为 ALT，A2 为 REF）
+constexpr uint8_t kPlinkHomAlt = 0;
+constexpr uint8_t kPlinkMissing = 1;
+constexpr uint8_t kPlinkHet = 2;
+constexpr uint8_t kPlinkHomRef = 3;
+
+enum class GenotypeLayout : uint8_t
+{
+    VariantMajor = 0,
+    SampleMajor = 1,
+};
+
+struct GenotypeRow;
+
+class GenotypeEncoder
+{
+public:
+    explicit GenotypeEncoder(uint32_t nSamples);
+
+    // 每行先调用 beginRow，hasGt 为真时再按样本顺序调用 addGenotype
+    void beginRow(bool hasGt);
+    void addGenotype(std::string_view text);
+    // 已解码行中的一个样本，与按其文本写入的结果相同
+    void addGenotype(const GenotypeRow &row, uint32_t sample);
+
+    std::vector<uint8_t> finish(GenotypeLayout layout = GenotypeLayout::VariantMajor) const;
+
+private:
+    uint32_t nSamples;
+    uint32_t nRows = 0;
+    std::vector<uint8_t> rowHasGt;
+    std::vector<uint8_t> meta;      // 每个基因型：低 4 位倍性，bit4 相位，bit5 非常规
+    std::vector<uint16_t> alleles;  // 各基因型等位基因顺序排列
+    std::vector<std::pair<uint64_t, std::string>> irregular;
+    uint32_t curSample = 0;
+    uint8_t maxPloidy = 1;
+    uint16_t maxAllele = 0;
+    uint64_t nPhased = 0;
+    uint64_t nUnphased = 0;
+
+    void addIrregular(std::string_view text);
+    void addParsed(const uint16_t *buf, uint8_t ploidy, char sep);
+};
+
+// 解码后的一行基因型
+struct GenotypeRow
+{
+    std::vector<uint16_t> alleles; // 样本数 × 块倍性，缺失为 kMissingAllele
+    std::vector<uint8_t> ploidy;   // 每个样本的倍性，0 表示非常规文本
+    std::vector<uint8_t> phased;   // 每个样本的相位
+    std::vector<std::pair<uint32_t, std::string_view>> irregular;
+    uint8_t blockPloidy = 1;
+};
+
+// 把一行中样本 sample 的基因型以 VCF 文本追加到 out；按块倍性与等位基因位数特化
+using GenotypeAppender = void (*)(const GenotypeRow &row, uint32_t sample, std::string &out);
+
+// 解码后单个样本在块内所有行的基因型
+struct GenotypeColumn
+{
+    std::vector<uint16_t> alleles;           // 行数 × 块倍性
+    std::vector<uint8_t> ploidy;             // 每行倍性，0 表示非常规文本
+    std::vector<uint8_t> phased;             // 每行相位
+    std::vector<std::string_view> irregular; // 每行非常规文本（仅 ploidy 为 0 时有效）
+};
+
+class GenotypeDecoder
+{
+public:
+    explicit GenotypeDecoder(std::vector<uint8_t> stream);
+
+    // 内部视图指向 data，只允许移动
+    GenotypeDecoder(const GenotypeDecoder &) = delete;
+    GenotypeDecoder &operator=(const GenotypeDecoder &) = delete;
+    GenotypeDecoder(GenotypeDecoder &&) = default;
+    GenotypeDecoder &operator=(GenotypeDecoder &&) = default;
+
+    uint32_t rows() const { return nRows; }
+    uint32_t samples() const { return nSamples; }
+    uint8_t ploidy() const { return blockPloidy; }
+    uint8_t alleleBits() const { return nBits; }
+    bool defaultPhased() const { return phasedDefault; }
+    GenotypeLayout layout() const { return planeLayout; }
+
+    // 构造时按块倍性与等位基因位数选定的文本输出函数
+    GenotypeAppender appender() const { return append; }
+
+    bool hasGt(uint32_t row) const { return !noGtRows.contains(row); }
+
+    void decodeRow(uint32_t row, GenotypeRow &out) const;
+
+    // 提取单个样本；样本主序布局下每个平面只读一段连续字节
+    void decodeSample(uint32_t sample, GenotypeColumn &out) const;
+
+    // 整行样本的 GT 文本，每个样本前加 tab。倍性 1/2 且等位基因为一位数时查预生成的 token 表：
+    // 只用到第 0 个平面的行每个平面字节（4 个二倍体或 8 个单倍体样本）拷贝一个 16 字节 token，
+    // 其余行逐样本拷贝；含缺失、相位、倍性或非常规例外的样本回退 decodeRow。块不适用时返回 false
+    bool appendRowText(uint32_t row, std::string &out) const;
+
+    // 双等位行的 PLINK 1 编码：每样本 2 bit，低位在前，out 需 (样本数 + 3) / 4 字节，末字节多余位清零。
+    // 二倍体块只读第 0 个平面，按字把 32 个样本的单倍型位换算为编码，再按旁路信息打补丁；
+    // 单倍体样本按纯合处理，缺失、非常规文本与大于 1 的等位基因记为缺失
+    void packPlinkRow(uint32_t row, uint8_t *out) const;
+
+private:
+    std::vector<uint8_t> data;
+    uint32_t nRows = 0;
+    uint32_t nSamples = 0;
+    uint8_t blockPloidy = 1;
+    uint8_t nBits = 1;
+    bool phasedDefault = true;
+    GenotypeLayout planeLayout = GenotypeLayout::VariantMajor;
+    size_t wordsPerPlane = 0; // 每行每平面的字数
+    size_t rowWords = 0;      // 样本主序：每槽位每平面的字数
+
+    // 样本主序：当前已转置回行主序的 64 行
+    mutable uint32_t cachedBand = UINT32_MAX;
+    mutable std::vector<uint64_t> bandRows;
+
+    // 按块特化的热循环，构造时选定一次
+    using UnpackFn = void (*)(const uint8_t *rowBits, size_t W, uint8_t nBits, uint16_t *dst);
+    UnpackFn unpack = nullptr;
+    GenotypeAppender append = nullptr;
+
+    // appendRowText 的逐行临时量
+    mutable std::vector<uint32_t> rowExceptions;
+    mutable std::vector<uint16_t> rowAlleles;
+    mutable GenotypeRow slowRow;
+
+    IndexSet noGtRows;
+    IndexSet phaseExceptions;
+    IndexSet missing;
+    std::vector<uint64_t> ploidyIndex;
+    std::vector<uint8_t> ploidyValue;
+    std::vector<uint64_t> irregularIndex;
+    std::vector<std::string_view> irregularText;
+    const uint8_t *planes = nullptr;
+
+    const uint8_t *rowPlanes(uint32_t row) const;
+};
+
+// 把样本 sample 的基因型以 VCF 文本形式追加到 out
+void appendGenotype(const GenotypeRow &row, uint32_t sample, uint8_t blockPloidy, std::string &out);
@@ -0,0 +1,161 @@
+#include "gvcf.hpp"
+#include "buffer.hpp"
+#include "format_matrix.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    constexpr std::string_view kRefAlts[] = {"<NON_REF>", "<*>"};
+}
+
+bool parseRefBlock(std::string_view alt, std::string_view info, int64_t pos, int64_t &end, uint8_t &altCode)
+{
+    uint8_t code = 0;
+    while (code < std::size(kRefAlts) && alt != kRefAlts[code])
+    {
+        ++code;
+    }
+    if (code == std::size(kRefAlts) || info.compare(0, 4, "END=") != 0)
+    {
+        return false;
+    }
+    std::string_view digits = info.substr(4);
+    int64_t v = 0;
+    auto res = std::from_chars(digits.data(), digits.data() + digits.size(), v);
+    // 只接受能按原样还原的 END 写法
+    if (res.ec != std::errc() || res.ptr != digits.data() + digits.size() || digits.empty() || digits[0] == '0' ||
+        digits[0] == '-' || v < pos)
+    {
+        return false;
+    }
+    end = v;
+    altCode = code;
+    return true;
+}
+
+std::string_view refBlockAlt(uint8_t altCode)
+{
+    if (altCode >= std::size(kRefAlts))
+    {
+        throw std::runtime_error("Corrupt reference block ALT code");
+    }
+    return kRefAlts[altCode];
+}
+
+void RefIntervalEncoder::add(int64_t pos, int64_t end, uint8_t altCode)
+{
+    starts.push_back(pos);
+    ends.push_back(end);
+    alts.push_back(altCode);
+}
+
+std::vector<uint8_t> RefIntervalEncoder::finish() const
+{
+    // 起点相对上一区间终点 + 1 的差分、长度、ALT 代码分三段写出，便于后端压缩
+    ByteWriter w;
+    w.putVarint(starts.size());
+    int64_t prevEnd = 0;
+    for (size_t i = 0; i < starts.size(); ++i)
+    {
+        w.putSVarint(starts[i] - (prevEnd + 1));
+        prevEnd = ends[i];
+    }
+    for (size_t i = 0; i < starts.size(); ++i)
+    {
+        w.putVarint(static_cast<uint64_t>(ends[i] - starts[i]));
+    }
+    w.putBytes(alts.data(), alts.size());
+    return std::move(w.data);
+}
+
+RefIntervalDecoder::RefIntervalDecoder(const std::vector<uint8_t> &stream)
+{
+    ByteReader r(stream);
+    size_t n = r.getVarint();
+    starts.resize(n);
+    ends.resize(n);
+    std::vector<int64_t> gaps(n);
+    for (auto &g : gaps)
+    {
+        g = r.getSVarint();
+    }
+    int64_t prevEnd = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        starts[i] = prevEnd + 1 + gaps[i];
+        ends[i] = starts[i] + static_cast<int64_t>(r.getVarint());
+        prevEnd = ends[i];
+    }
+    const uint8_t *a = r.getBytes(n);
+    alts.assign(a, a + n);
+}
+
+namespace
+{
+    // 解码一个段内的参考块，追加到 all
+    void decodeSegmentRefBlocks(const SegmentView &block, uint32_t nSamples, uint32_t sample,
+                                std::vector<RefBlockRecord> &all)
+    {
+        if (!block.has(StreamId::RefInterval))
+        {
+            return;
+        }
+        RefIntervalDecoder intervals(block.load(StreamId::RefInterval));
+        const uint32_t nRows = intervals.size();
+        const size_t base = all.size();
+        all.resize(base + nRows);
+        RefBlockRecord *out = all.data() + base;
+        for (uint32_t i = 0; i < nRows; ++i)
+        {
+            out[i].start = intervals.start(i);
+            out[i].end = intervals.end(i);
+        }
+        if (nSamples == 0 || sample >= nSamples)
+        {
+            return;
+        }
+
+        // 只加载参考块行组中 MIN_DP 与 GQ 两个键的列流
+        std::vector<uint8_t> names = block.load(kRefBlockStreamBase + static_cast<uint32_t>(StreamId::FormatKeys));
+        const SampleGroups groups = blockSampleGroups(block, nSamples);
+        const uint32_t group = groups.of(sample);
+        const uint32_t local = sample - groups.first(group);
+        ByteReader nr(names);
+        size_t nKeys = nr.getVarint();
+        for (size_t k = 0; k < nKeys; ++k)
+        {
+            std::string_view name = nr.getString();
+            int32_t RefBlockRecord::*field = name == "MIN_DP" ? &RefBlockRecord::minDp
+                                             : name == "GQ"   ? &RefBlockRecord::gq
+                                                              : nullptr;
+            if (!field)
+            {
+                continue;
+            }
+            FormatKeyDecoder dec(block.load(groupStreamId(kRefBlockStreamBase + kFormatKeyStreamBase + static_cast<uint32_t>(k), group)),
+                                 nRows, groups.size(group));
+            for (uint32_t i = 0; i < nRows; ++i)
+            {
+                int32_t v = 0;
+                if (dec.intValue(i, local, 0, v))
+                {
+                    out[i].*field = v;
+                }
+            }
+        }
+    }
+}
+
+std::vector<RefBlockRecord> decodeRefBlocks(const BlockView &block, uint32_t nSamples, uint32_t sample)
+{
+    std::vector<RefBlockRecord> out;
+    for (size_t i = 0; i < block.segments().size(); ++i)
+    {
+        decodeSegmentRefBlocks(block.segment(i), nSamples, sample, out);
+    }
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "block.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// gVCF 参考块：ALT 仅为 <NON_REF>/<*>，INFO 仅为 END=<pos>。
+// 这些行与真实变异分开存放：区间流（起点差分、长度、ALT 代码）
+// 加上独立的一组 FORMAT 列流（MIN_DP、GQ 等），覆盖度查询只需读这几条流。
+
+// 识别参考块；成功时返回 END 与 ALT 代码
+bool parseRefBlock(std::string_view alt, std::string_view info, int64_t pos, int64_t &end, uint8_t &altCode);
+
+std::string_view refBlockAlt(uint8_t altCode);
+
+class RefIntervalEncoder
+{
+public:
+    void add(int64_t pos, int64_t end, uint8_t altCode);
+    std::vector<uint8_t> finish() const;
+    uint32_t size() const { return static_cast<uint32_t>(starts.size()); }
+
+private:
+    std::vector<int64_t> starts;
+    std::vector<int64_t> ends;
+    std::vector<uint8_t> alts;
+};
+
+class RefIntervalDecoder
+{
+public:
+    explicit RefIntervalDecoder(const std::vector<uint8_t> &stream);
+
+    uint32_t size() const { return static_cast<uint32_t>(starts.size()); }
+    int64_t start(uint32_t i) const { return starts[i]; }
+    int64_t end(uint32_t i) const { return ends[i]; }
+    uint8_t altCode(uint32_t i) const { return alts[i]; }
+
+private:
+    std::vector<int64_t> starts;
+    std::vector<int64_t> ends;
+    std::vector<uint8_t> alts;
+};
+
+// 覆盖度轨道的一条记录；缺失值为 -1
+struct RefBlockRecord
+{
+    int64_t start = 0;
+    int64_t end = 0;
+    int32_t minDp = -1;
+    int32_t gq = -1;
+};
+
+// 只解码块内的参考块区间与指定样本的 MIN_DP/GQ，不触碰变异行的任何流
+std::vector<RefBlockRecord> decodeRefBlocks(const BlockView &block, uint32_t nSamples, uint32_t sample = 0);
@@ -0,0 +1,133 @@
+#include "id_index.hpp"
+#include "buffer.hpp"
+#include "xxhash/xxh3.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    constexpr size_t kEntrySize = 16;
+
+    uint64_t loadU64(const uint8_t *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint32_t loadU32(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint64_t bucketOf(uint64_t hash, uint8_t bits)
+    {
+        return bits == 0 ? 0 : hash >> (64 - bits);
+    }
+}
+
+uint64_t idHash(std::string_view id)
+{
+    return XXH3_64bits(id.data(), id.size());
+}
+
+std::vector<uint8_t> IdIndexBuilder::finish()
+{
+    // 平均每桶约 4 个条目
+    uint8_t bits = 0;
+    while (bits < 40 && (static_cast<uint64_t>(4) << bits) < entries.size())
+    {
+        ++bits;
+    }
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b)
+              {
+                  if (a.hash != b.hash)
+                  {
+                      return a.hash < b.hash;
+                  }
+                  return a.block != b.block ? a.block < b.block : a.row < b.row;
+              });
+
+    ByteWriter w;
+    w.putU8(bits);
+    w.putU64(entries.size());
+    // 按哈希排序后各桶天然连续
+    const uint64_t nBuckets = static_cast<uint64_t>(1) << bits;
+    size_t e = 0;
+    for (uint64_t b = 0; b <= nBuckets; ++b)
+    {
+        while (e < entries.size() && bucketOf(entries[e].hash, bits) < b)
+        {
+            ++e;
+        }
+        w.putU64(e);
+    }
+    for (const auto &entry : entries)
+    {
+        w.putU64(entry.hash);
+        w.putU32(entry.block);
+        w.putU32(entry.row);
+    }
+    return std::move(w.data);
+}
+
+IdIndexView::IdIndexView(const uint8_t *p, size_t size)
+{
+    if (size < 9)
+    {
+        throw std::runtime_error("Corrupt ID index");
+    }
+    bits = p[0];
+    nEntries = loadU64(p + 1);
+    const uint64_t nBuckets = static_cast<uint64_t>(1) << bits;
+    if (bits > 40 || (size - 9) / 8 < nBuckets + 1 || (size - 9 - (nBuckets + 1) * 8) / kEntrySize < nEntries)
+    {
+        throw std::runtime_error("Corrupt ID index");
+    }
+    data = p;
+    buckets = p + 9;
+    entries = buckets + (nBuckets + 1) * 8;
+}
+
+std::vector<IdLocation> IdIndexView::find(std::string_view id) const
+{
+    std::vector<IdLocation> out;
+    if (!data)
+    {
+        return out;
+    }
+    const uint64_t hash = idHash(id);
+    const uint64_t b = bucketOf(hash, bits);
+    const uint64_t lo = loadU64(buckets + b * 8);
+    const uint64_t hi = std::min(loadU64(buckets + (b + 1) * 8), nEntries);
+    for (uint64_t i = lo; i < hi; ++i)
+    {
+        const uint8_t *e = entries + i * kEntrySize;
+        if (loadU64(e) == hash)
+        {
+            out.push_back({loadU32(e + 8), loadU32(e + 12)});
+        }
+    }
+    return out;
+}
+
+std::vector<std::vector<std::pair<uint64_t, uint32_t>>> IdIndexView::byBlock(uint32_t nBlocks) const
+{
+    std::vector<std::vector<std::pair<uint64_t, uint32_t>>> out(nBlocks);
+    for (uint64_t i = 0; data && i < nEntries; ++i)
+    {
+        const uint8_t *e = entries + i * kEntrySize;
+        const uint32_t block = loadU32(e + 8);
+        if (block >= nBlocks)
+        {
+            throw std::runtime_error("Corrupt ID index");
+        }
+        out[block].emplace_back(loadU64(e), loadU32(e + 12));
+    }
+    return out;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// 变异 ID（如 rsID）索引：ID 的 64 位哈希 -> (块号, 块内行号)
+//
+// 静态哈希表，按哈希高位分桶，整段可直接在映射上查询：
+//   u8 桶位数 | u64 条目数 | (2^bits + 1) 个 u64 桶起点 | 条目（u64 哈希, u32 块号, u32 行号）
+// 桶内条目按哈希排序。哈希冲突由调用方解码记录后核对 ID 文本排除。
+
+struct IdLocation
+{
+    uint32_t block = 0;
+    uint32_t row = 0;
+};
+
+uint64_t idHash(std::string_view id);
+
+// 对 ID 列的值（';' 分隔的多个 ID，'.' 表示无）逐个调用 f
+template <class F>
+void forEachId(std::string_view ids, F &&f)
+{
+    if (ids == ".")
+    {
+        return;
+    }
+    size_t start = 0;
+    while (start <= ids.size())
+    {
+        size_t end = ids.find(';', start);
+        if (end == std::string_view::npos)
+        {
+            end = ids.size();
+        }
+        if (end > start)
+        {
+            f(ids.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+}
+
+class IdIndexBuilder
+{
+public:
+    void add(uint64_t hash, uint32_t block, uint32_t row) { entries.push_back({hash, block, row}); }
+    bool empty() const { return entries.empty(); }
+
+    std::vector<uint8_t> finish();
+
+private:
+    struct Entry
+    {
+        uint64_t hash;
+        uint32_t block;
+        uint32_t row;
+    };
+    std::vector<Entry> entries;
+};
+
+class IdIndexView
+{
+public:
+    IdIndexView() = default;
+    IdIndexView(const uint8_t *data, size_t size);
+
+    bool valid() const { return data != nullptr; }
+
+    // 哈希相同的候选位置，按 (块号, 行号) 排序
+    std::vector<IdLocation> find(std::string_view id) const;
+
+    // 按块分开的全部条目 (ID 哈希, 块内行号)，重写文件时按新块号重建索引；块号不小于 nBlocks 时抛出异常
+    std::vector<std::vector<std::pair<uint64_t, uint32_t>>> byBlock(uint32_t nBlocks) const;
+
+private:
+    const uint8_t *data = nullptr;
+    uint8_t bits = 0;
+    uint64_t nEntries = 0;
+    const uint8_t *buckets = nullptr;
+    const uint8_t *entries = nullptr;
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "buffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// 稀疏下标集合：[0, universe) 中被标记的位置。
+// 写入时在「间隔变长整数列表」与「稠密位图」之间取较小者，
+// 读取时保持原表示，按区间枚举，避免把稠密位图展开成列表。
+class IndexSet
+{
+public:
+    IndexSet() = default;
+
+    // items 必须升序且小于 universe
+    IndexSet(std::vector<uint64_t> items, uint64_t universe) : items(std::move(items)), universe(universe) {}
+
+    bool empty() const { return dense ? count == 0 : items.empty(); }
+    uint64_t size() const { return dense ? count : items.size(); }
+
+    void write(ByteWriter &w) const
+    {
+        w.putVarint(universe);
+        w.putVarint(items.size());
+        if (items.empty())
+        {
+            return;
+        }
+        size_t sparseBytes = 0;
+        uint64_t prev = 0;
+        for (uint64_t v : items)
+        {
+            sparseBytes += varintSize(v - prev);
+            prev = v;
+        }
+        size_t denseBytes = (universe + 7) / 8;
+        if (denseBytes < sparseBytes)
+        {
+            w.putU8(1);
+            std::vector<uint8_t> bits(denseBytes, 0);
+            for (uint64_t v : items)
+            {
+                bits[v >> 3] |= static_cast<uint8_t>(1u << (v & 7));
+            }
+            w.putBytes(bits.data(), bits.size());
+            return;
+        }
+        w.putU8(0);
+        prev = 0;
+        for (uint64_t v : items)
+        {
+            w.putVarint(v - prev);
+            prev = v;
+        }
+    }
+
+    static IndexSet read(ByteReader &r)
+    {
+        IndexSet s;
+        s.universe = r.getVarint();
+        uint64_t n = r.getVarint();
+        if (n == 0)
+        {
+            return s;
+        }
+        if (r.getU8() == 1)
+        {
+            s.dense = true;
+            s.count = n;
+            size_t nBytes = (s.universe + 7) / 8;
+            const uint8_t *p = r.getBytes(nBytes);
+            s.bits.assign(p, p + nBytes);
+            return s;
+        }
+        s.items.resize(n);
+        uint64_t prev = 0;
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            prev += r.getVarint();
+            s.items[i] = prev;
+        }
+        return s;
+    }
+
+    // 枚举 [lo, hi) 内的元素
+    template <class F>
+    void forEachInRange(uint64_t lo, uint64_t hi, F &&f) const
+    {
+        if (dense)
+        {
+            hi = std::min(hi, universe);
+            for (uint64_t v = lo; v < hi; ++v)
+            {
+                if ((v & 7) == 0 && v + 8 <= hi && bits[v >> 3] == 0)
+                {
+                    v += 7;
+                    continue;
+                }
+                if (bits[v >> 3] & (1u << (v & 7)))
+                {
+                    f(v);
+                }
+            }
+            return;
+        }
+        auto it = std::lower_bound(items.begin(), items.end(), lo);
+        for (; it != items.end() && *it < hi; ++it)
+        {
+            f(*it);
+        }
+    }
+
+    bool contains(uint64_t v) const
+    {
+        if (dense)
+        {
+            return v < universe && (bits[v >> 3] & (1u << (v & 7)));
+        }
+        return std::binary_search(items.begin(), items.end(), v);
+    }
+
+private:
+    std::vector<uint64_t> items;
+    std::vector<uint8_t> bits;
+    uint64_t universe = 0;
+    uint64_t count = 0;
+    bool dense = false;
+
+    static size_t varintSize(uint64_t v)
+    {
+        size_t n = 1;
+        while (v >= 0x80)
+        {
+            v >>= 7;
+            ++n;
+        }
+        return n;
+    }
+};
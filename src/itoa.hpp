@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// 整数转十进制文本直接追加到输出缓冲：位数由最高有效位估算后一次比较修正，
+// 从低位起每次查表写两位，不经 to_string 的临时字符串
+
+inline constexpr char kDigitPairs[] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+                                      "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+                                      "8081828384858687888990919293949596979899";
+
+inline uint32_t decimalDigits(uint64_t v)
+{
+    static constexpr uint64_t kPow10[20] = {1ull,
+                                            10ull,
+                                            100ull,
+                                            1000ull,
+                                            10000ull,
+                                            100000ull,
+                                            1000000ull,
+                                            10000000ull,
+                                            100000000ull,
+                                            1000000000ull,
+                                            10000000000ull,
+                                            100000000000ull,
+                                            1000000000000ull,
+                                            10000000000000ull,
+                                            100000000000000ull,
+                                            1000000000000000ull,
+                                            10000000000000000ull,
+                                            100000000000000000ull,
+                                            1000000000000000000ull,
+                                            10000000000000000000ull};
+    // v | 1 不改变十进制位数，且避免 clz(0)
+    const uint64_t x = v | 1;
+    const uint32_t t = static_cast<uint32_t>((64 - __builtin_clzll(x)) * 1233) >> 12; // 约为 位数 × log10(2)
+    return t + (x >= kPow10[t]);
+}
+
+inline void appendUnsigned(uint64_t v, std::string &out)
+{
+    const uint32_t n = decimalDigits(v);
+    const size_t at = out.size();
+    out.resize(at + n);
+    char *p = &out[at] + n;
+    while (v >= 100)
+    {
+        const uint64_t r = v % 100;
+        v /= 100;
+        p -= 2;
+        std::memcpy(p, kDigitPairs + r * 2, 2);
+    }
+    if (v >= 10)
+    {
+        std::memcpy(p - 2, kDigitPairs + v * 2, 2);
+    }
+    else
+    {
+        p[-1] = static_cast<char>('0' + v);
+    }
+}
+
+inline void appendSigned(int64_t v, std::string &out)
+{
+    if (v < 0)
+    {
+        out += '-';
+        appendUnsigned(0 - static_cast<uint64_t>(v), out);
+        return;
+    }
+    appendUnsigned(static_cast<uint64_t>(v), out);
+}
@@ -1,8 +1,23 @@
 #include <iostream>
 #include <string>
 #include "brotli.hpp"
+#include "archive.hpp"
+#include "compressor.hpp"
+#include "concat.hpp"
+#include "count.hpp"
+#include "merge.hpp"
+#include "npy.hpp"
+#include "plink.hpp"
+#include "vcf.hpp"
+#include "server.hpp"
+#include "transcode.hpp"
+#include "view.hpp"
 #include "xxhash/xxh3.h"
+#include "cxxopts.hpp"
+#include <charconv>
+#include <csignal>
 #include <fstream>
+#include <spdlog/spdlog.h>
 
 // test222
 uint64_t calculateFileHash(const std::string &filePath)
@@ -33,15 +48,486 @@ uint64_t calculateFileHash(const std::string &filePath)
     return hash;
 }
 
+// 命令行中的非负整数参数，不是整数、超出 uint32 或小于 min 时抛出异常
+uint32_t parseCount(const std::string &flag, const std::string &text, uint32_t min)
+{
+    uint64_t value = 0;
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc() || end != text.data() + text.size() || value > UINT32_MAX || value < min)
+    {
+        throw std::runtime_error("Invalid value for " + flag + ": " + text);
+    }
+    return static_cast<uint32_t>(value);
+}
+
+// 命令行中的整数参数不在 [min, max] 内时抛出异常
+void checkRange(const std::string &flag, int value, int min, int max)
+{
+    if (value < min || value > max)
+    {
+        throw std::runtime_error("Invalid value for " + flag + ": " + std::to_string(value) + " (expected " +
+                                 std::to_string(min) + "-" + std::to_string(max) + ")");
+    }
+}
+
+// gsc view <input.gsc> [-o out.vcf] [-r chr:start-end ...]
+int runView(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc view", "Decode records from a .gsc file");
+    cli.add_options()
+        ("o,output", "Output VCF file, '-' for stdout", cxxopts::value<std::string>()->default_value("-"))
+        ("O,output-type", "v: plain VCF, z: BGZF-compressed VCF", cxxopts::value<std::string>()->default_value("v"))
+        ("W,write-index", "With -O z, also write a tbi or csi index (--write-index=csi)",
+         cxxopts::value<std::string>()->implicit_value("tbi"))
+        ("r,regions", "Regions chr[:start[-end]], comma separated", cxxopts::value<std::vector<std::string>>())
+        ("R,regions-file", "BED file of regions", cxxopts::value<std::string>())
+        ("i,ids", "Variant IDs to look up, comma separated", cxxopts::value<std::vector<std::string>>())
+        ("s,samples", "Samples to output, comma separated", cxxopts::value<std::vector<std::string>>())
+        ("S,samples-file", "File of samples to output, one per line", cxxopts::value<std::string>())
+        ("G,drop-genotypes", "Output sites only (first 8 columns); genotype and FORMAT data are not read")
+        ("header-only", "Output the VCF header only")
+        ("f,fields", "Only decode and output these fields, e.g. CHROM,POS,INFO/AF,GT,FORMAT/DP",
+         cxxopts::value<std::string>())
+        ("tsv", "With --fields, print a tab-separated table with a header line instead of VCF")
+        ("where", "Site filter, e.g. 'FILTER=PASS && AF>0.01'; blocks are skipped by their index summary",
+         cxxopts::value<std::string>())
+        ("cache-mb", "Decoded block cache budget in MiB, 0 disables", cxxopts::value<size_t>()->default_value("0"))
+        ("input", "Input .gsc file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"input"});
+    cli.positional_help("<input.gsc>");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("input"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    ViewOptions options;
+    if (args.count("regions"))
+    {
+        options.regions = args["regions"].as<std::vector<std::string>>();
+    }
+    if (args.count("regions-file"))
+    {
+        options.regionsFile = args["regions-file"].as<std::string>();
+    }
+    if (args.count("ids"))
+    {
+        options.ids = args["ids"].as<std::vector<std::string>>();
+    }
+    if (args.count("samples"))
+    {
+        options.samples = args["samples"].as<std::vector<std::string>>();
+        options.sampleSubset = true;
+    }
+    if (args.count("samples-file"))
+    {
+        std::vector<std::string> names = readSampleList(args["samples-file"].as<std::string>());
+        options.samples.insert(options.samples.end(), names.begin(), names.end());
+        options.sampleSubset = true;
+    }
+    options.dropGenotypes = args.count("drop-genotypes") > 0;
+    options.headerOnly = args.count("header-only") > 0;
+    if (args.count("fields"))
+    {
+        options.fields = args["fields"].as<std::string>();
+    }
+    options.tsv = args.count("tsv") > 0;
+    if (options.tsv && options.fields.empty())
+    {
+        throw std::runtime_error("--tsv requires --fields");
+    }
+    options.cacheBytes = args["cache-mb"].as<size_t>() << 20;
+    if (args.count("where"))
+    {
+        options.where = args["where"].as<std::string>();
+    }
+    const std::string type = args["output-type"].as<std::string>();
+    if (type != "v" && type != "z")
+    {
+        throw std::runtime_error("Unknown output type: " + type);
+    }
+    options.bgzf = type == "z";
+    if (args.count("write-index"))
+    {
+        if (!options.bgzf)
+        {
+            throw std::runtime_error("--write-index requires -O z");
+        }
+        options.writeIndex = args["write-index"].as<std::string>();
+    }
+    // 在打开输出文件之前拒绝，避免留下空的输出
+    if (!options.fields.empty() && options.bgzf)
+    {
+        throw std::runtime_error("--fields cannot be combined with -O z or --write-index");
+    }
+    viewGscFile(args["input"].as<std::string>(), args["output"].as<std::string>(), options);
+    return 0;
+}
+
+// gsc count <input.gsc> [-r chr:start-end ...] [-R regions.bed] [--where expr]
+int runCount(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc count", "Count records per chromosome or per region from the block index");
+    cli.add_options()
+        ("o,output", "Output file, '-' for stdout", cxxopts::value<std::string>()->default_value("-"))
+        ("r,regions", "Regions chr[:start[-end]], comma separated", cxxopts::value<std::vector<std::string>>())
+        ("R,regions-file", "BED file of regions", cxxopts::value<std::string>())
+        ("where", "Only count records matching a site filter", cxxopts::value<std::string>())
+        ("input", "Input .gsc file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"input"});
+    cli.positional_help("<input.gsc>");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("input"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    CountOptions options;
+    if (args.count("regions"))
+    {
+        options.regions = args["regions"].as<std::vector<std::string>>();
+    }
+    if (args.count("regions-file"))
+    {
+        options.regionsFile = args["regions-file"].as<std::string>();
+    }
+    if (args.count("where"))
+    {
+        options.where = args["where"].as<std::string>();
+    }
+    countGscFile(args["input"].as<std::string>(), args["output"].as<std::string>(), options);
+    return 0;
+}
+
+GscServer *activeServer = nullptr;
+
+void stopServer(int)
+{
+    if (activeServer)
+    {
+        activeServer->stop();
+    }
+}
+
+// gsc serve --socket <path> [--cache-mb N] <a.gsc> [b.gsc ...]
+int runServe(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc serve", "Serve queries on .gsc files over a UNIX domain socket");
+    cli.add_options()
+        ("socket", "UNIX domain socket path", cxxopts::value<std::string>())
+        ("cache-mb", "Decoded block cache budget in MiB, shared by all files",
+         cxxopts::value<size_t>()->default_value("1024"))
+        ("inputs", "Input .gsc files", cxxopts::value<std::vector<std::string>>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"inputs"});
+    cli.positional_help("<a.gsc> [b.gsc ...]");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("socket") || !args.count("inputs"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    GscServer server(args["inputs"].as<std::vector<std::string>>(), args["cache-mb"].as<size_t>() << 20);
+    activeServer = &server;
+    std::signal(SIGINT, stopServer);
+    std::signal(SIGTERM, stopServer);
+    server.serve(args["socket"].as<std::string>());
+    activeServer = nullptr;
+    return 0;
+}
+
+// gsc client --socket <path> --file <name> [--stats | --samples | -r ... -s ... --where ...]
+int runClient(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc client", "Send a query to a running gsc serve");
+    cli.add_options()
+        ("socket", "UNIX domain socket path", cxxopts::value<std::string>())
+        ("f,file", "Served file, as given to gsc serve or its file name", cxxopts::value<std::string>())
+        ("stats", "Print file statistics")
+        ("list-samples", "Print sample names")
+        ("r,regions", "Regions chr[:start[-end]], comma separated", cxxopts::value<std::vector<std::string>>())
+        ("s,samples", "Samples to output, comma separated", cxxopts::value<std::vector<std::string>>())
+        ("where", "Site filter, e.g. 'FILTER=PASS && AF>0.01'", cxxopts::value<std::string>())
+        ("G,drop-genotypes", "Output sites only")
+        ("no-header", "Omit the VCF header")
+        ("h,help", "Print usage");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("socket") || !args.count("file"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    ServeRequest request;
+    request.file = args["file"].as<std::string>();
+    if (args.count("stats"))
+    {
+        request.op = ServeOp::Stats;
+    }
+    else if (args.count("list-samples"))
+    {
+        request.op = ServeOp::Samples;
+    }
+    if (args.count("regions"))
+    {
+        request.view.regions = args["regions"].as<std::vector<std::string>>();
+    }
+    if (args.count("samples"))
+    {
+        request.view.samples = args["samples"].as<std::vector<std::string>>();
+        request.view.sampleSubset = true;
+    }
+    if (args.count("where"))
+    {
+        request.view.where = args["where"].as<std::string>();
+    }
+    request.view.dropGenotypes = args.count("drop-genotypes") > 0;
+    request.view.header = !args.count("no-header");
+    GscClient client(args["socket"].as<std::string>());
+    client.request(request, std::cout);
+    return 0;
+}
+
+int runConvert(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc convert", "Convert a .gsc file to other genotype formats without rendering VCF text");
+    cli.add_options()
+        ("plink", "Write PLINK 1 <prefix>.bed/.bim/.fam (biallelic variants)", cxxopts::value<std::string>())
+        ("input", "Input .gsc file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"input"});
+    cli.positional_help("<input.gsc>");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("input") || !args.count("plink"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    const std::string prefix = args["plink"].as<std::string>();
+    PlinkSummary summary = exportPlink(args["input"].as<std::string>(), prefix);
+    spdlog::info("Wrote {} variants to {}.bed/.bim/.fam, skipped {} multi-allelic or reference-block records",
+                 summary.variants, prefix, summary.skipped);
+    return 0;
+}
+
+int runExport(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc export", "Export genotype matrices for numeric pipelines");
+    cli.add_options()
+        ("npy", "Output .npy file: records x samples int8 dosage (-1 = missing)", cxxopts::value<std::string>())
+        ("bits", "Write a packed haplotype bit matrix (uint8, 2 bits per sample, MSB first) instead")
+        ("r,region", "Region chr[:start[-end]]", cxxopts::value<std::string>())
+        ("s,samples", "Comma separated sample names", cxxopts::value<std::vector<std::string>>())
+        ("S,samples-file", "File of sample names, one per line", cxxopts::value<std::string>())
+        ("input", "Input .gsc file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"input"});
+    cli.positional_help("<input.gsc>");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("input") || !args.count("npy"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    NpyOptions options;
+    options.bits = args.count("bits") > 0;
+    if (args.count("region"))
+    {
+        options.region = args["region"].as<std::string>();
+    }
+    if (args.count("samples"))
+    {
+        options.samples = args["samples"].as<std::vector<std::string>>();
+        options.sampleSubset = true;
+    }
+    if (args.count("samples-file"))
+    {
+        std::vector<std::string> names = readSampleList(args["samples-file"].as<std::string>());
+        options.samples.insert(options.samples.end(), names.begin(), names.end());
+        options.sampleSubset = true;
+    }
+    const std::string output = args["npy"].as<std::string>();
+    uint64_t rows = exportNpy(args["input"].as<std::string>(), output, options);
+    spdlog::info("Wrote {} records to {}", rows, output);
+    return 0;
+}
+
+int runTranscode(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc transcode", "Recompress the field streams of a .gsc file with another codec");
+    cli.add_options()
+        ("codec", "Stream codec: brotli, bsc, zlib or store", cxxopts::value<std::string>())
+        ("level", "Compression level (brotli 0-11, zlib 1-9)", cxxopts::value<int>())
+        ("window", "Brotli window bits 10-24", cxxopts::value<int>())
+        ("input", "Input .gsc file", cxxopts::value<std::string>())
+        ("output", "Output .gsc file", cxxopts::value<std::string>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"input", "output"});
+    cli.positional_help("<input.gsc> <output.gsc>");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("input") || !args.count("output") || !args.count("codec"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    CodecParams codec;
+    codec.codec = parseCodec(args["codec"].as<std::string>());
+    // 显式给出的 --level/--window 须适用于所选编码器且在其范围内，不静默截断
+    if (args.count("level"))
+    {
+        codec.level = args["level"].as<int>();
+        if (codec.codec == Codec::Brotli)
+        {
+            checkRange("--level", codec.level, 0, 11);
+        }
+        else if (codec.codec == Codec::Zlib)
+        {
+            checkRange("--level", codec.level, 1, 9);
+        }
+        else
+        {
+            throw std::runtime_error(std::string("--level does not apply to codec ") + codecName(codec.codec));
+        }
+    }
+    if (args.count("window"))
+    {
+        codec.window = args["window"].as<int>();
+        if (codec.codec != Codec::Brotli)
+        {
+            throw std::runtime_error(std::string("--window does not apply to codec ") + codecName(codec.codec));
+        }
+        checkRange("--window", codec.window, 10, 24);
+    }
+    const std::string output = args["output"].as<std::string>();
+    TranscodeSummary summary = transcodeGsc(args["input"].as<std::string>(), output, codec);
+    spdlog::info("Transcoded {} blocks to {}: {} -> {} bytes of block data", summary.blocks, output,
+                 summary.inputBytes, summary.outputBytes);
+    return 0;
+}
+
+int runMergeSamples(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc merge-samples", "Merge the samples of several .gsc files without re-parsing VCF text");
+    cli.add_options()
+        ("o,output", "Output .gsc file", cxxopts::value<std::string>())
+        ("codec", "Codec for rewritten streams: brotli, bsc, zlib or store", cxxopts::value<std::string>())
+        ("block-size", "Rows per block for re-encoded rows", cxxopts::value<uint32_t>())
+        ("checkpoint", "Row checkpoint interval for re-encoded rows", cxxopts::value<uint32_t>())
+        ("inputs", "Input .gsc files", cxxopts::value<std::vector<std::string>>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"inputs"});
+    cli.positional_help("<a.gsc> <b.gsc> [...]");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("inputs") || !args.count("output"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    MergeOptions options;
+    if (args.count("codec"))
+    {
+        options.codec.codec = parseCodec(args["codec"].as<std::string>());
+    }
+    if (args.count("block-size"))
+    {
+        options.blockSize = std::max<uint32_t>(1, args["block-size"].as<uint32_t>());
+    }
+    if (args.count("checkpoint"))
+    {
+        options.checkpointRows = args["checkpoint"].as<uint32_t>();
+    }
+    const std::string output = args["output"].as<std::string>();
+    MergeSummary summary = mergeSamples(args["inputs"].as<std::vector<std::string>>(), output, options);
+    spdlog::info("Merged {} samples into {}: {} records, {} blocks and {} segments concatenated by column, "
+                 "{} rows re-encoded",
+                 summary.samples, output, summary.records, summary.copiedBlocks, summary.copiedSegments,
+                 summary.mergedRows);
+    return 0;
+}
+
+int runConcat(int argc, char *argv[])
+{
+    cxxopts::Options cli("gsc concat", "Concatenate .gsc files with the same samples by copying their blocks");
+    cli.add_options()
+        ("o,output", "Output .gsc file", cxxopts::value<std::string>())
+        ("inputs", "Input .gsc files, in output order", cxxopts::value<std::vector<std::string>>())
+        ("h,help", "Print usage");
+    cli.parse_positional({"inputs"});
+    cli.positional_help("<chr1.gsc> <chr2.gsc> [...]");
+    auto args = cli.parse(argc, argv);
+    if (args.count("help") || !args.count("inputs") || !args.count("output"))
+    {
+        std::cerr << cli.help() << std::endl;
+        return args.count("help") ? 0 : 1;
+    }
+
+    const std::string output = args["output"].as<std::string>();
+    ConcatSummary summary = concatGsc(args["inputs"].as<std::vector<std::string>>(), output);
+    spdlog::info("Concatenated {} blocks ({} records, {} bytes) into {}", summary.blocks, summary.records,
+                 summary.bytes, output);
+    if (summary.droppedIds)
+    {
+        spdlog::warn("Not every input has an ID index; {} has none", output);
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     try
     {
+        if (argc > 1 && std::string(argv[1]) == "view")
+        {
+            return runView(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "count")
+        {
+            return runCount(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "serve")
+        {
+            return runServe(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "client")
+        {
+            return runClient(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "convert")
+        {
+            return runConvert(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "export")
+        {
+            return runExport(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "transcode")
+        {
+            return runTranscode(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "merge-samples")
+        {
+            return runMergeSamples(argc - 1, argv + 1);
+        }
+        if (argc > 1 && std::string(argv[1]) == "concat")
+        {
+            return runConcat(argc - 1, argv + 1);
+        }
+
         std::string inputFile;
         std::string outputFile;
         bool compressMode = true;
         bool checkMode = false;
         std::string checkFile1, checkFile2;
+        CompressOptions options;
 
         for (int i = 1; i < argc; ++i)
         {
@@ -57,6 +543,34 @@ int main(int argc, char *argv[])
             {
                 compressMode = false;
             }
+            else if (std::string(argv[i]) == "--layout" && i + 1 < argc)
+            {
+                std::string layout = argv[++i];
+                if (layout == "sample-major")
+                {
+                    options.gtLayout = GenotypeLayout::SampleMajor;
+                }
+                else if (layout == "variant-major")
+                {
+                    options.gtLayout = GenotypeLayout::VariantMajor;
+                }
+                else
+                {
+                    throw std::runtime_error("Unknown layout: " + layout);
+                }
+            }
+            else if (std::string(argv[i]) == "--id-index")
+            {
+                options.idIndex = true;
+            }
+            else if (std::string(argv[i]) == "--checkpoint" && i + 1 < argc)
+            {
+                options.checkpointRows = parseCount("--checkpoint", argv[++i], 0);
+            }
+            else if (std::string(argv[i]) == "--sample-group" && i + 1 < argc)
+            {
+                options.sampleGroupSize = parseCount("--sample-group", argv[++i], 1);
+            }
             else if (std::string(argv[i]) == "-c" && i + 2 < argc)
             {
                 checkMode = true;
@@ -92,11 +606,22 @@ int main(int argc, char *argv[])
 
         if (inputFile.empty() || outputFile.empty())
         {
-            std::cerr << "Usage: " << argv[0] << " -i <input_file> -o <output_file> [-d] | -c <file1> <file2>" << std::endl;
+            std::cerr << "Usage: " << argv[0] << " -i <input_file> -o <output_file> [-d] [--layout variant-major|sample-major] [--sample-group N] [--checkpoint N] [--id-index] | -c <file1> <file2>" << std::endl;
             return 1;
         }
 
-        if (compressMode)
+        if (compressMode && isVcfFile(inputFile))
+        {
+            // VCF 输入按块、按字段编码为 .gsc
+            compressVcfFile(inputFile, outputFile, options);
+            std::cout << "Compression completed successfully" << std::endl;
+        }
+        else if (!compressMode && isGscFile(inputFile))
+        {
+            decompressGscFile(inputFile, outputFile);
+            std::cout << "Decompression completed successfully" << std::endl;
+        }
+        else if (compressMode)
         {
             BrotliCompressor compressor(11, 24);
             if (compressor.compressFile(inputFile, outputFile))
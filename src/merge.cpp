@@ -0,0 +1,407 @@
+#include "merge.hpp"
+#include "archive.hpp"
+#include "vcf.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    struct MergeInput
+    {
+        std::unique_ptr<GscReader> reader;
+        uint32_t nSamples = 0;
+        std::unordered_map<std::string, std::vector<size_t>> chromBlocks; // 每条染色体的块号，按文件顺序
+    };
+
+    // 一个输入在当前染色体上的读取位置：当前块的段，以及已解码段中剩余的行。逐段推进，段只在需要其中的行时解码，
+    // 停在段首的各输入可按列拼接
+    class Cursor
+    {
+    public:
+        using Row = std::pair<std::shared_ptr<DecodedSegment>, uint32_t>;
+
+        Cursor(const MergeInput &input, const std::vector<size_t> *blocks) : input(input), blocks(blocks)
+        {
+            open();
+        }
+
+        // 停在段首（当前段未解码）；segment() 为 0 时也是块首
+        bool atSegment() const { return view && !decoded; }
+        size_t block() const { return (*blocks)[next]; }
+        const BlockView &blockView() const { return *view; }
+        size_t segment() const { return seg; }
+
+        // 下一行的 POS，当前段未解码时取段表中的 minPos；没有行时为 INT64_MAX
+        int64_t nextPos() const
+        {
+            if (decoded)
+            {
+                return decoded->position(row);
+            }
+            return view ? view->segments()[seg].minPos : INT64_MAX;
+        }
+
+        void load()
+        {
+            if (decoded || !view)
+            {
+                return;
+            }
+            decoded = std::make_shared<DecodedSegment>(view->segment(seg), input.nSamples);
+            row = 0;
+            if (decoded->rows() != view->segments()[seg].nRows)
+            {
+                throw std::runtime_error("Corrupt block: segment row count does not match segment table");
+            }
+        }
+
+        // 取出下一行（需先 load）；行所在的段由返回值持有
+        Row take()
+        {
+            Row out{decoded, row++};
+            if (row == decoded->rows())
+            {
+                decoded.reset();
+                skipSegment();
+            }
+            return out;
+        }
+
+        void skipSegment()
+        {
+            if (++seg == view->segments().size())
+            {
+                skipBlock();
+            }
+        }
+
+        void skipBlock()
+        {
+            ++next;
+            open();
+        }
+
+    private:
+        const MergeInput &input;
+        const std::vector<size_t> *blocks;
+        size_t next = 0;
+        std::optional<BlockView> view; // 第 next 块，读完时为空
+        size_t seg = 0;
+        std::shared_ptr<DecodedSegment> decoded;
+        uint32_t row = 0;
+
+        // 各段的流目录与字段流在取用时校验
+        void open()
+        {
+            view.reset();
+            seg = 0;
+            for (; blocks && next < blocks->size(); ++next)
+            {
+                view.emplace(input.reader->block(block(), BlockPart::Partial));
+                if (!view->segments().empty())
+                {
+                    return;
+                }
+                view.reset();
+            }
+        }
+    };
+
+    // 第一个输入的 ## 行，补上其余输入中不重复的 ## 行；样本列依次为各输入的样本
+    VcfHeader mergeHeaders(const std::vector<MergeInput> &inputs)
+    {
+        VcfHeader header;
+        std::unordered_set<std::string> seen;
+        std::unordered_set<std::string> samples;
+        for (size_t j = 0; j < inputs.size(); ++j)
+        {
+            const std::string &text = inputs[j].reader->headerText();
+            size_t start = 0;
+            while (start < text.size())
+            {
+                size_t end = text.find('\n', start);
+                end = end == std::string::npos ? text.size() : end;
+                std::string line = text.substr(start, end - start);
+                start = end + 1;
+                if (line.compare(0, 2, "##") == 0)
+                {
+                    if (seen.insert(line).second)
+                    {
+                        header.metaLines.push_back(std::move(line));
+                    }
+                }
+                else if (j == 0 && line.compare(0, 6, "#CHROM") == 0)
+                {
+                    std::vector<std::string_view> cols;
+                    splitView(line, '\t', cols);
+                    for (size_t c = 0; c < 9 && c < cols.size(); ++c)
+                    {
+                        header.columnLine += c ? "\t" : "";
+                        header.columnLine.append(cols[c].data(), cols[c].size());
+                    }
+                }
+            }
+            for (const std::string &name : inputs[j].reader->samples())
+            {
+                if (!samples.insert(name).second)
+                {
+                    throw std::runtime_error("Sample " + name + " appears in more than one input");
+                }
+                header.samples.push_back(name);
+                header.columnLine += '\t';
+                header.columnLine += name;
+            }
+        }
+        return header;
+    }
+}
+
+MergeSummary mergeSamples(const std::vector<std::string> &inputFiles, const std::string &outputFile,
+                          const MergeOptions &options)
+{
+    if (inputFiles.size() < 2)
+    {
+        throw std::runtime_error("merge-samples needs at least two inputs");
+    }
+    checkOutputNotInput(inputFiles, outputFile);
+    std::vector<MergeInput> inputs(inputFiles.size());
+    std::vector<std::string> chroms;
+    std::vector<uint32_t> nSamples;
+    for (size_t j = 0; j < inputFiles.size(); ++j)
+    {
+        MergeInput &input = inputs[j];
+        input.reader = std::make_unique<GscReader>(inputFiles[j]);
+        input.nSamples = static_cast<uint32_t>(input.reader->samples().size());
+        if (input.nSamples == 0)
+        {
+            throw std::runtime_error("Input has no samples: " + inputFiles[j]);
+        }
+        nSamples.push_back(input.nSamples);
+        const GscIndex &index = input.reader->index();
+        for (size_t b = 0; b < index.blocks.size(); ++b)
+        {
+            const std::string &chrom = index.chroms[index.blocks[b].chromId];
+            std::vector<size_t> &blocks = input.chromBlocks[chrom];
+            if (blocks.empty() && std::find(chroms.begin(), chroms.end(), chrom) == chroms.end())
+            {
+                chroms.push_back(chrom);
+            }
+            blocks.push_back(b);
+        }
+    }
+    const VcfHeader header = mergeHeaders(inputs);
+    const GscReader &first = *inputs[0].reader;
+    const auto firstIds = first.idIndexView().byBlock(static_cast<uint32_t>(first.blockCount()));
+
+    BlockParams params;
+    params.codec = options.codec;
+    params.sampleGroupSize = options.sampleGroupSize;
+    params.checkpointRows = options.checkpointRows;
+    params.collectIds = first.hasIdIndex();
+    GscWriter writer(outputFile, header, options.codec);
+
+    MergeSummary summary;
+    summary.samples = header.samples.size();
+    MergedBlockBuilder pending(nSamples, params);
+    std::string chrom;
+    auto flush = [&]
+    {
+        if (pending.rows() > 0)
+        {
+            writer.writeBlock(pending.finish(chrom));
+        }
+    };
+
+    for (const std::string &name : chroms)
+    {
+        chrom = name;
+        std::vector<Cursor> cursors;
+        for (const MergeInput &input : inputs)
+        {
+            auto it = input.chromBlocks.find(name);
+            cursors.emplace_back(input, it == input.chromBlocks.end() ? nullptr : &it->second);
+        }
+        std::vector<std::vector<Cursor::Row>> at(inputs.size());
+        std::vector<std::vector<int32_t>> groupOf(inputs.size());
+        std::vector<std::vector<int32_t>> groups;
+        std::vector<size_t> head(inputs.size());
+        std::vector<char> emitted;
+        std::vector<MergeRowPart> parts(inputs.size());
+        std::vector<BlockView> views;
+        std::vector<size_t> segments;
+        while (true)
+        {
+            // 各输入都停在段首且站点一致：整块一致时原样按列拼接整块，否则按列拼接这一段
+            if (std::all_of(cursors.begin(), cursors.end(), [](const Cursor &c) { return c.atSegment(); }))
+            {
+                views.clear();
+                segments.clear();
+                for (const Cursor &c : cursors)
+                {
+                    views.push_back(c.blockView());
+                    segments.push_back(c.segment());
+                }
+                const bool atBlock =
+                    std::all_of(segments.begin(), segments.end(), [](size_t i) { return i == 0; });
+                if (atBlock && std::all_of(views.begin() + 1, views.end(),
+                                           [&](const BlockView &v) { return sameBlockSites(views[0], v); }))
+                {
+                    flush();
+                    const size_t b = cursors[0].block();
+                    writer.writeBlock(mergeBlockSamples(views, nSamples, options.codec), first.index(), b,
+                                      firstIds[b]);
+                    summary.records += views[0].rows();
+                    ++summary.copiedBlocks;
+                    for (Cursor &c : cursors)
+                    {
+                        c.skipBlock();
+                    }
+                    continue;
+                }
+                bool same = true;
+                for (size_t j = 1; j < views.size() && same; ++j)
+                {
+                    same = sameSegmentSites(views[0], segments[0], views[j], segments[j]);
+                }
+                if (same)
+                {
+                    const uint32_t rows = views[0].segments()[segments[0]].nRows;
+                    if (pending.rows() + rows > options.blockSize)
+                    {
+                        flush();
+                    }
+                    pending.addSegment(views, segments);
+                    summary.records += rows;
+                    ++summary.copiedSegments;
+                    for (Cursor &c : cursors)
+                    {
+                        c.skipSegment();
+                    }
+                    if (pending.rows() >= options.blockSize)
+                    {
+                        flush();
+                    }
+                    continue;
+                }
+            }
+
+            // 逐行合并：取出各输入在最小 POS 上的全部行，按 (REF, ALT) 配对
+            int64_t pos = INT64_MAX;
+            for (const Cursor &c : cursors)
+            {
+                pos = std::min(pos, c.nextPos());
+            }
+            if (pos == INT64_MAX)
+            {
+                break;
+            }
+            for (size_t j = 0; j < cursors.size(); ++j)
+            {
+                at[j].clear();
+                while (cursors[j].nextPos() == pos)
+                {
+                    cursors[j].load();
+                    if (cursors[j].nextPos() != pos)
+                    {
+                        break;
+                    }
+                    at[j].push_back(cursors[j].take());
+                }
+                groupOf[j].assign(at[j].size(), -1);
+                head[j] = 0;
+            }
+            // 每组在每个输入中至多一行，groups[g][j] 为该行在 at[j] 中的下标，-1 表示该输入没有此变异
+            groups.clear();
+            for (size_t j = 0; j < at.size(); ++j)
+            {
+                for (size_t r = 0; r < at[j].size(); ++r)
+                {
+                    if (groupOf[j][r] >= 0)
+                    {
+                        continue;
+                    }
+                    const int32_t g = static_cast<int32_t>(groups.size());
+                    groups.emplace_back(at.size(), -1);
+                    groupOf[j][r] = g;
+                    groups[g][j] = static_cast<int32_t>(r);
+                    const DecodedSegment &site = *at[j][r].first;
+                    const uint32_t siteRow = at[j][r].second;
+                    for (size_t k = j + 1; k < at.size(); ++k)
+                    {
+                        for (size_t q = 0; q < at[k].size(); ++q)
+                        {
+                            const DecodedSegment &other = *at[k][q].first;
+                            const uint32_t otherRow = at[k][q].second;
+                            if (groupOf[k][q] < 0 && other.ref(otherRow) == site.ref(siteRow) &&
+                                other.alt(otherRow) == site.alt(siteRow))
+                            {
+                                groupOf[k][q] = g;
+                                groups[g][k] = static_cast<int32_t>(q);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            // 同一 POS 上按各输入的行序输出：优先取在它所在的每个输入中都排在最前的组，
+            // 同为最前时取输入序号小的；各输入行序互相矛盾时取第一个输入的下一行，保证前进
+            emitted.assign(groups.size(), 0);
+            for (size_t left = groups.size(); left > 0; --left)
+            {
+                int32_t pick = -1;
+                int32_t fallback = -1;
+                for (size_t j = 0; j < at.size(); ++j)
+                {
+                    while (head[j] < at[j].size() && emitted[groupOf[j][head[j]]])
+                    {
+                        ++head[j];
+                    }
+                }
+                for (size_t j = 0; j < at.size() && pick < 0; ++j)
+                {
+                    if (head[j] == at[j].size())
+                    {
+                        continue;
+                    }
+                    const int32_t g = groupOf[j][head[j]];
+                    fallback = fallback < 0 ? g : fallback;
+                    bool first = true;
+                    for (size_t k = 0; k < at.size(); ++k)
+                    {
+                        first = first && (groups[g][k] < 0 || head[k] == static_cast<size_t>(groups[g][k]));
+                    }
+                    if (first)
+                    {
+                        pick = g;
+                    }
+                }
+                pick = pick < 0 ? fallback : pick;
+                emitted[pick] = 1;
+                std::fill(parts.begin(), parts.end(), MergeRowPart());
+                for (size_t k = 0; k < at.size(); ++k)
+                {
+                    if (groups[pick][k] >= 0)
+                    {
+                        const Cursor::Row &row = at[k][groups[pick][k]];
+                        parts[k] = {row.first.get(), row.second};
+                    }
+                }
+                pending.addRow(parts);
+                ++summary.records;
+                ++summary.mergedRows;
+                if (pending.rows() >= options.blockSize)
+                {
+                    flush();
+                }
+            }
+        }
+        flush();
+    }
+    writer.close();
+    return summary;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "block.hpp"
+#include "codec.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// gsc merge-samples：按样本合并多个 .gsc（各输入的样本互不相同），不生成 VCF 文本。
+// 各输入逐条染色体按段同步推进：
+//   - 各输入的当前块段划分与站点一致时（同一 VCF 按样本拆分、以相同块参数压缩），站点流与 FORMAT 列取第一个输入的
+//     压缩字节，各输入的 GT 位平面与 FORMAT 键流按样本组依次排列、原样复制，不解压
+//   - 各输入都停在段首且当前段站点一致时，同样按列拼接这一段；站点不一致的区间过后即回到按段拼接
+//   - 否则逐行按 (POS, REF, ALT) 对齐，由解码出的 GT 与 FORMAT 值直接编码样本列：站点列取第一个含该行的输入，
+//     缺少该行的输入样本为缺失值（FORMAT 以 GT 开头时为 ./.，否则为 .）；各输入 FORMAT 不同时取键的并集（GT 在前），
+//     样本格缺少的键为 '.'；gVCF 参考块同样按 (POS, REF, ALT) 对齐，END 取第一个含该行的输入。
+//     输出段的各行正好是某输入一段的全部行且站点都取自该段时，站点流原样复制
+// 头部为第一个输入的 ## 行，补上其余输入中不重复的 ## 行，样本列依次为各输入的样本
+
+struct MergeOptions
+{
+    CodecParams codec;
+    uint32_t blockSize = 8192; // 逐行合并时每块最多行数
+    uint32_t sampleGroupSize = kDefaultSampleGroupSize;
+    uint32_t checkpointRows = 0;
+};
+
+struct MergeSummary
+{
+    uint64_t records = 0;
+    uint64_t samples = 0;
+    uint64_t copiedBlocks = 0;   // 按列拼接的块
+    uint64_t copiedSegments = 0; // 块不一致时按列拼接的段
+    uint64_t mergedRows = 0;     // 逐行对齐后重新编码的行
+};
+
+MergeSummary mergeSamples(const std::vector<std::string> &inputFiles, const std::string &outputFile,
+                          const MergeOptions &options);
@@ -0,0 +1,128 @@
+#include "npy.hpp"
+#include "archive.hpp"
+#include "region.hpp"
+#include "view.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <mio/mmap.hpp>
+#include <oneapi/tbb/parallel_for.h>
+#include <stdexcept>
+
+std::string npyHeader(const std::string &descr, uint64_t rows, uint64_t cols)
+{
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (" + std::to_string(rows) + ", " +
+                       std::to_string(cols) + "), }";
+    // 魔数 6 + 版本 2 + 长度 2，字典以空格补齐并以换行结束
+    const size_t total = (10 + dict.size() + 1 + 63) / 64 * 64;
+    dict.append(total - 10 - dict.size() - 1, ' ');
+    dict += '\n';
+    std::string header("\x93NUMPY\x01\x00", 8);
+    header += static_cast<char>(dict.size() & 0xff);
+    header += static_cast<char>(dict.size() >> 8);
+    return header + dict;
+}
+
+uint64_t exportNpy(const std::string &inputFile, const std::string &outputFile, const NpyOptions &options)
+{
+    GscReader reader(inputFile);
+    const GscIndex &index = reader.index();
+    const uint32_t nSamples = static_cast<uint32_t>(reader.samples().size());
+    std::vector<uint32_t> samples;
+    if (options.sampleSubset)
+    {
+        samples = resolveSamples(reader, options.samples);
+    }
+    else
+    {
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            samples.push_back(s);
+        }
+    }
+    const MatrixKind kind = options.bits ? MatrixKind::HaplotypeBits : MatrixKind::Dosage;
+    const size_t rowBytes = matrixRowBytes(kind, samples.size());
+
+    std::vector<size_t> blocks;
+    std::vector<PositionRange> ranges;
+    if (options.region.empty())
+    {
+        for (size_t b = 0; b < index.blocks.size(); ++b)
+        {
+            blocks.push_back(b);
+        }
+    }
+    else
+    {
+        const GenomicRegion region = parseRegion(options.region);
+        blocks = reader.regions().blocksFor(region);
+        ranges.emplace_back(region.start, region.end);
+    }
+
+    // 各块输出行数：整块落在区域内时取索引中的行数，边缘块只解码站点列计数
+    std::vector<uint64_t> firstRow(blocks.size() + 1, 0);
+    tbb::parallel_for(size_t(0), blocks.size(),
+                      [&](size_t k)
+                      {
+                          const BlockIndexEntry &e = index.blocks[blocks[k]];
+                          if (ranges.empty() || (e.minPos >= ranges[0].first && e.maxPos <= ranges[0].second))
+                          {
+                              firstRow[k + 1] = e.nRows;
+                              return;
+                          }
+                          RenderOptions count;
+                          count.ranges = &ranges;
+                          firstRow[k + 1] =
+                              countBlockRows(reader.block(blocks[k], BlockPart::Partial), nSamples, count);
+                      });
+    for (size_t k = 0; k < blocks.size(); ++k)
+    {
+        firstRow[k + 1] += firstRow[k];
+    }
+    const uint64_t rows = firstRow.back();
+
+    const std::string header = npyHeader(options.bits ? "|u1" : "|i1", rows, options.bits ? rowBytes : samples.size());
+    {
+        std::ofstream out(outputFile, std::ios::binary | std::ios::trunc);
+        if (!out.write(header.data(), header.size()))
+        {
+            throw std::runtime_error("Failed to open output file: " + outputFile);
+        }
+    }
+    const uint64_t bodyBytes = rows * rowBytes;
+    if (bodyBytes == 0)
+    {
+        return rows;
+    }
+    // 扩展出的文件内容为 0，bits 矩阵只需置位
+    std::filesystem::resize_file(outputFile, header.size() + bodyBytes);
+    std::error_code error;
+    mio::mmap_sink map = mio::make_mmap_sink(outputFile, header.size(), bodyBytes, error);
+    if (error)
+    {
+        throw std::runtime_error("Failed to map output file " + outputFile + ": " + error.message());
+    }
+    auto *body = reinterpret_cast<uint8_t *>(map.data());
+
+    const std::vector<uint32_t> *subset = options.sampleSubset ? &samples : nullptr;
+    tbb::parallel_for(size_t(0), blocks.size(),
+                      [&](size_t k)
+                      {
+                          RenderOptions render;
+                          render.ranges = ranges.empty() ? nullptr : &ranges;
+                          render.samples = subset;
+                          const BlockPart part = subset ? BlockPart::Partial : BlockPart::All;
+                          uint32_t n = packBlockMatrix(reader.block(blocks[k], part), nSamples, render, kind,
+                                                       body + firstRow[k] * rowBytes);
+                          if (n != firstRow[k + 1] - firstRow[k])
+                          {
+                              throw std::runtime_error("Block row count does not match the index");
+                          }
+                      });
+    map.sync(error);
+    if (error)
+    {
+        throw std::runtime_error("Failed to write output file " + outputFile + ": " + error.message());
+    }
+    return rows;
+}
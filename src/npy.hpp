@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// gsc export --npy：把区域内的记录 × 所选样本导出为 NumPy .npy 矩阵（C 顺序，行为记录，顺序同 gsc view）。
+//   dosage：int8，每格为非 REF 等位基因个数，缺失为 -1
+//   bits：  uint8，每样本 2 个单倍型位按行 MSB 在前打包（np.unpackbits(m, axis=1)[:, :2 * 样本数] 还原）
+// 先由块索引求出各块的输出行数，按总大小建文件并映射，各块并行把矩阵行直接写入映射区，不经 VCF 文本。
+
+struct NpyOptions
+{
+    std::string region;               // -r：chr[:start[-end]]，空表示全部记录
+    std::vector<std::string> samples; // -s/-S：样本子集，按文件中的列顺序
+    bool sampleSubset = false;
+    bool bits = false; // --bits：单倍型位矩阵，否则为 dosage
+};
+
+// 返回矩阵行数
+uint64_t exportNpy(const std::string &inputFile, const std::string &outputFile, const NpyOptions &options);
+
+// .npy v1.0 头部（含魔数），总长度按 64 字节对齐
+std::string npyHeader(const std::string &descr, uint64_t rows, uint64_t cols);
@@ -0,0 +1,81 @@
+#include "plink.hpp"
+#include "archive.hpp"
+
+#include <fstream>
+#include <memory>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_pipeline.h>
+#include <stdexcept>
+
+namespace
+{
+    std::ofstream openOutput(const std::string &path)
+    {
+        std::ofstream out(path, std::ios::binary);
+        if (!out.is_open())
+        {
+            throw std::runtime_error("Failed to open output file: " + path);
+        }
+        return out;
+    }
+}
+
+PlinkSummary exportPlink(const std::string &inputFile, const std::string &prefix)
+{
+    GscReader reader(inputFile);
+    const GscIndex &index = reader.index();
+    const uint32_t nSamples = static_cast<uint32_t>(reader.samples().size());
+
+    std::ofstream fam = openOutput(prefix + ".fam");
+    for (const std::string &name : reader.samples())
+    {
+        fam << name << '\t' << name << "\t0\t0\t0\t-9\n";
+    }
+    std::ofstream bim = openOutput(prefix + ".bim");
+    std::ofstream bed = openOutput(prefix + ".bed");
+    static const char kBedMagic[3] = {0x6c, 0x1b, 0x01}; // SNP 主序
+    bed.write(kBedMagic, sizeof(kBedMagic));
+
+    PlinkSummary summary;
+    size_t next = 0;
+    tbb::parallel_pipeline(
+        static_cast<size_t>(tbb::info::default_concurrency()) * 2,
+        tbb::make_filter<void, size_t>(
+            tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control &fc) -> size_t
+            {
+                if (next == index.blocks.size())
+                {
+                    fc.stop();
+                    return 0;
+                }
+                return next++;
+            }) &
+            tbb::make_filter<size_t, std::shared_ptr<PlinkRows>>(
+                tbb::filter_mode::parallel,
+                [&](size_t b)
+                {
+                    auto rows = std::make_shared<PlinkRows>();
+                    packBlockPlink(reader.block(b), index.chroms[index.blocks[b].chromId], nSamples, *rows);
+                    return rows;
+                }) &
+            tbb::make_filter<std::shared_ptr<PlinkRows>, void>(
+                tbb::filter_mode::serial_in_order,
+                [&](std::shared_ptr<PlinkRows> rows)
+                {
+                    bim.write(rows->bim.data(), rows->bim.size());
+                    bed.write(reinterpret_cast<const char *>(rows->bed.data()), rows->bed.size());
+                    summary.variants += rows->variants;
+                    summary.skipped += rows->skipped;
+                }));
+
+    for (std::ofstream *out : {&fam, &bim, &bed})
+    {
+        out->flush();
+        if (!*out)
+        {
+            throw std::runtime_error("Failed to write PLINK output: " + prefix);
+        }
+    }
+    return summary;
+}
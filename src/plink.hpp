@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// gsc convert --plink：.gsc -> PLINK 1 的 prefix.bed/.bim/.fam（SNP 主序）。
+// 各块并行由 GT 位平面直接换算 2 bit 编码，按块顺序写出，不经 VCF 文本。
+// A1 为 ALT、A2 为 REF（同 plink --keep-allele-order）；.fam 的家系号与个体号都取样本名，性别与表型未知。
+// 只导出双等位变异，多等位行与 gVCF 参考块跳过并计数。
+
+struct PlinkSummary
+{
+    uint64_t variants = 0;
+    uint64_t skipped = 0;
+};
+
+PlinkSummary exportPlink(const std::string &inputFile, const std::string &prefix);
@@ -0,0 +1,191 @@
+#include "region.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+    bool parseCoordinate(const std::string &text, int64_t &value)
+    {
+        value = 0;
+        bool any = false;
+        for (char c : text)
+        {
+            if (c < '0' || c > '9' || value > (INT64_MAX - 9) / 10)
+            {
+                return false;
+            }
+            value = value * 10 + (c - '0');
+            any = true;
+        }
+        return any;
+    }
+}
+
+GenomicRegion parseRegion(const std::string &text)
+{
+    GenomicRegion region;
+    size_t colon = text.rfind(':');
+    if (colon == std::string::npos)
+    {
+        region.chrom = text;
+    }
+    else
+    {
+        // 冒号后不是坐标时整段视为染色体名（如 HLA-A*01:01）
+        std::string range = text.substr(colon + 1);
+        size_t dash = range.find('-');
+        int64_t start = 0;
+        int64_t end = INT64_MAX;
+        bool ok = parseCoordinate(range.substr(0, dash), start);
+        if (ok && dash != std::string::npos && dash + 1 < range.size())
+        {
+            ok = parseCoordinate(range.substr(dash + 1), end);
+        }
+        else if (ok && dash == std::string::npos)
+        {
+            end = start;
+        }
+        if (!ok)
+        {
+            region.chrom = text;
+        }
+        else
+        {
+            region.chrom = text.substr(0, colon);
+            region.start = start;
+            region.end = end;
+        }
+    }
+    if (region.chrom.empty() || region.start < 1 || region.end < region.start)
+    {
+        throw std::runtime_error("Invalid region: " + text);
+    }
+    return region;
+}
+
+std::vector<GenomicRegion> readBedFile(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        throw std::runtime_error("Failed to open BED file: " + path);
+    }
+    std::vector<GenomicRegion> regions;
+    std::string line;
+    std::vector<std::string_view> cols;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0)
+        {
+            continue;
+        }
+        splitView(line, '\t', cols);
+        int64_t start = 0;
+        int64_t end = 0;
+        if (cols.size() < 3 || !parseCoordinate(std::string(cols[1]), start) ||
+            !parseCoordinate(std::string(cols[2]), end) || end <= start)
+        {
+            throw std::runtime_error("Invalid BED line: " + line);
+        }
+        GenomicRegion region;
+        region.chrom = std::string(cols[0]);
+        region.start = start + 1;
+        region.end = end;
+        regions.push_back(std::move(region));
+    }
+    return regions;
+}
+
+RegionIndex::RegionIndex(const GscIndex &index) : index(index), chroms(index.chroms.size())
+{
+    for (size_t c = 0; c < index.chroms.size(); ++c)
+    {
+        chromIds.emplace(index.chroms[c], static_cast<uint32_t>(c));
+    }
+    for (size_t i = 0; i < index.blocks.size(); ++i)
+    {
+        const BlockIndexEntry &e = index.blocks[i];
+        if (e.chromId >= chroms.size())
+        {
+            throw std::runtime_error("Corrupt .gsc index: chromosome id out of range");
+        }
+        ChromBlocks &c = chroms[e.chromId];
+        if (!c.minPos.empty() && e.minPos < c.minPos.back())
+        {
+            c.sorted = false;
+        }
+        c.blocks.push_back(i);
+        c.minPos.push_back(e.minPos);
+        c.maxEnd.push_back(c.maxEnd.empty() ? e.maxPos : std::max(c.maxEnd.back(), e.maxPos));
+    }
+}
+
+std::vector<size_t> RegionIndex::blocksFor(const GenomicRegion &region) const
+{
+    std::vector<size_t> out;
+    auto it = chromIds.find(region.chrom);
+    if (it == chromIds.end())
+    {
+        return out;
+    }
+    const ChromBlocks &c = chroms[it->second];
+    if (!c.sorted)
+    {
+        // 未排序输入退化为线性扫描
+        for (size_t k = 0; k < c.blocks.size(); ++k)
+        {
+            const BlockIndexEntry &e = index.blocks[c.blocks[k]];
+            if (e.minPos <= region.end && e.maxPos >= region.start)
+            {
+                out.push_back(c.blocks[k]);
+            }
+        }
+        return out;
+    }
+    size_t first = std::lower_bound(c.maxEnd.begin(), c.maxEnd.end(), region.start) - c.maxEnd.begin();
+    size_t last = std::upper_bound(c.minPos.begin(), c.minPos.end(), region.end) - c.minPos.begin();
+    for (size_t k = first; k < last; ++k)
+    {
+        if (index.blocks[c.blocks[k]].maxPos >= region.start)
+        {
+            out.push_back(c.blocks[k]);
+        }
+    }
+    return out;
+}
+
+std::vector<GenomicRegion> RegionIndex::merge(std::vector<GenomicRegion> regions) const
+{
+    std::vector<std::pair<uint32_t, GenomicRegion>> keyed;
+    for (auto &r : regions)
+    {
+        auto it = chromIds.find(r.chrom);
+        if (it != chromIds.end())
+        {
+            keyed.emplace_back(it->second, std::move(r));
+        }
+    }
+    std::sort(keyed.begin(), keyed.end(),
+              [](const auto &a, const auto &b)
+              { return a.first != b.first ? a.first < b.first : a.second.start < b.second.start; });
+
+    std::vector<GenomicRegion> out;
+    uint32_t prevChrom = UINT32_MAX;
+    for (auto &k : keyed)
+    {
+        if (k.first == prevChrom && (out.back().end == INT64_MAX || k.second.start <= out.back().end + 1))
+        {
+            out.back().end = std::max(out.back().end, k.second.end);
+            continue;
+        }
+        prevChrom = k.first;
+        out.push_back(std::move(k.second));
+    }
+    return out;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "archive.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 基因组区间，1-based 闭区间
+struct GenomicRegion
+{
+    std::string chrom;
+    int64_t start = 1;
+    int64_t end = INT64_MAX;
+};
+
+// 解析 chr、chr:pos、chr:start-end、chr:start-
+GenomicRegion parseRegion(const std::string &text);
+
+// BED 文件：chrom start end（0-based 半开区间），跳过空行、注释及 track/browser 行
+std::vector<GenomicRegion> readBedFile(const std::string &path);
+
+// 按染色体组织的块索引：每条染色体的块按文件顺序排列，
+// 有序输入时 minPos 单调，maxPos 取前缀最大值后单调，可二分定位重叠块
+class RegionIndex
+{
+public:
+    explicit RegionIndex(const GscIndex &index);
+
+    // 与区间重叠的块号，按文件顺序
+    std::vector<size_t> blocksFor(const GenomicRegion &region) const;
+
+    // 按文件中的染色体顺序排序，合并重叠或相邻的区间；文件中没有的染色体被丢弃
+    std::vector<GenomicRegion> merge(std::vector<GenomicRegion> regions) const;
+
+private:
+    struct ChromBlocks
+    {
+        std::vector<size_t> blocks;
+        std::vector<int64_t> minPos;
+        std::vector<int64_t> maxEnd; // maxPos 的前缀最大值
+        bool sorted = true;
+    };
+
+    const GscIndex &index;
+    std::unordered_map<std::string, uint32_t> chromIds;
+    std::vector<ChromBlocks> chroms;
+};
@@ -0,0 +1,499 @@
+#include "server.hpp"
+#include "archive.hpp"
+#include "block_cache.hpp"
+#include "buffer.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct GscServer::Archive
+{
+    GscReader reader;
+    std::unique_ptr<BlockCache> cache;
+
+    Archive(const std::string &path, size_t cacheBytes) : reader(path)
+    {
+        if (cacheBytes > 0)
+        {
+            cache = std::make_unique<BlockCache>(reader, cacheBytes);
+        }
+    }
+};
+
+namespace
+{
+    bool readFull(int fd, void *buf, size_t n)
+    {
+        auto *p = static_cast<uint8_t *>(buf);
+        while (n > 0)
+        {
+            ssize_t got = ::read(fd, p, n);
+            if (got < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (got <= 0)
+            {
+                return false;
+            }
+            p += got;
+            n -= static_cast<size_t>(got);
+        }
+        return true;
+    }
+
+    bool writeFull(int fd, const void *buf, size_t n)
+    {
+        const auto *p = static_cast<const uint8_t *>(buf);
+        while (n > 0)
+        {
+            ssize_t put = ::send(fd, p, n, MSG_NOSIGNAL);
+            if (put < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (put <= 0)
+            {
+                return false;
+            }
+            p += put;
+            n -= static_cast<size_t>(put);
+        }
+        return true;
+    }
+
+    // 读取一帧；对端关闭时返回 false
+    bool readFrame(int fd, std::vector<uint8_t> &payload, uint32_t limit)
+    {
+        uint8_t len[4];
+        if (!readFull(fd, len, sizeof(len)))
+        {
+            return false;
+        }
+        const uint32_t n = len[0] | (len[1] << 8) | (len[2] << 16) | (static_cast<uint32_t>(len[3]) << 24);
+        if (n > limit)
+        {
+            throw std::runtime_error("Frame too large: " + std::to_string(n) + " bytes");
+        }
+        payload.resize(n);
+        return readFull(fd, payload.data(), n);
+    }
+
+    bool writeFrame(int fd, ServeStatus status, std::string_view text)
+    {
+        if (text.size() + 1 > kMaxServeFrame)
+        {
+            return writeFrame(fd, ServeStatus::Error, "Response frame too large");
+        }
+        ByteWriter head;
+        head.putU32(static_cast<uint32_t>(text.size() + 1));
+        head.putU8(static_cast<uint8_t>(status));
+        return writeFull(fd, head.data.data(), head.size()) && writeFull(fd, text.data(), text.size());
+    }
+
+    // 应答文本的输出缓冲：攒满 kServeChunk 字节发一个 More 帧，finish() 以 Done 帧发出剩余文本；
+    // 发送失败（对端关闭或 stop() 关闭了连接）时抛出异常以中止查询
+    class FrameBuf : public std::streambuf
+    {
+    public:
+        explicit FrameBuf(int fd) : fd(fd), buffer(kServeChunk) { reset(); }
+
+        bool broken() const { return failed; }
+
+        void finish()
+        {
+            send(ServeStatus::Done);
+        }
+
+        // 丢弃未发出的文本
+        void discard() { reset(); }
+
+    protected:
+        int_type overflow(int_type c) override
+        {
+            send(ServeStatus::More);
+            if (!traits_type::eq_int_type(c, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+    private:
+        int fd;
+        std::vector<char> buffer;
+        bool failed = false;
+
+        void reset() { setp(buffer.data(), buffer.data() + buffer.size()); }
+
+        void send(ServeStatus status)
+        {
+            const size_t n = static_cast<size_t>(pptr() - pbase());
+            reset();
+            if (!writeFrame(fd, status, std::string_view(buffer.data(), n)))
+            {
+                failed = true;
+                throw std::runtime_error("Connection closed while sending response");
+            }
+        }
+    };
+
+    sockaddr_un socketAddress(const std::string &path)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path))
+        {
+            throw std::runtime_error("Socket path too long: " + path);
+        }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        return addr;
+    }
+
+    std::string statsText(const std::string &name, const GscReader &reader)
+    {
+        const GscIndex &index = reader.index();
+        uint64_t records = 0;
+        for (const ChromSummary &c : index.chromSummaries)
+        {
+            records += c.records;
+        }
+        std::ostringstream out;
+        out << "file\t" << name << '\n'
+            << "samples\t" << reader.samples().size() << '\n'
+            << "blocks\t" << index.blocks.size() << '\n'
+            << "records\t" << records << '\n'
+            << "#chrom\tblocks\trecords\tmin_pos\tmax_pos\n";
+        for (size_t i = 0; i < index.chroms.size(); ++i)
+        {
+            const ChromSummary &c = index.chromSummaries[i];
+            out << index.chroms[i] << '\t' << c.blocks << '\t' << c.records << '\t' << c.minPos << '\t' << c.maxPos
+                << '\n';
+        }
+        return out.str();
+    }
+
+    std::string baseName(const std::string &path)
+    {
+        size_t slash = path.rfind('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+std::vector<uint8_t> encodeServeRequest(const ServeRequest &request)
+{
+    ByteWriter w;
+    w.putU8(static_cast<uint8_t>(request.op));
+    w.putString(request.file);
+    if (request.op == ServeOp::Query)
+    {
+        w.putVarint(request.view.regions.size());
+        for (const auto &r : request.view.regions)
+        {
+            w.putString(r);
+        }
+        w.putU8(request.view.sampleSubset ? 1 : 0);
+        w.putVarint(request.view.samples.size());
+        for (const auto &s : request.view.samples)
+        {
+            w.putString(s);
+        }
+        w.putString(request.view.where);
+        w.putU8(request.view.header ? 1 : 0);
+        w.putU8(request.view.dropGenotypes ? 1 : 0);
+    }
+    return std::move(w.data);
+}
+
+ServeRequest decodeServeRequest(const uint8_t *data, size_t size)
+{
+    ByteReader r(data, size);
+    ServeRequest request;
+    uint8_t op = r.getU8();
+    if (op < static_cast<uint8_t>(ServeOp::Query) || op > static_cast<uint8_t>(ServeOp::Stats))
+    {
+        throw std::runtime_error("Unknown request op: " + std::to_string(op));
+    }
+    request.op = static_cast<ServeOp>(op);
+    request.file = std::string(r.getString());
+    if (request.op == ServeOp::Query)
+    {
+        size_t nRegions = r.getVarint();
+        for (size_t i = 0; i < nRegions; ++i)
+        {
+            request.view.regions.emplace_back(r.getString());
+        }
+        request.view.sampleSubset = r.getU8() != 0;
+        size_t nSamples = r.getVarint();
+        for (size_t i = 0; i < nSamples; ++i)
+        {
+            request.view.samples.emplace_back(r.getString());
+        }
+        request.view.where = std::string(r.getString());
+        request.view.header = r.getU8() != 0;
+        request.view.dropGenotypes = r.getU8() != 0;
+    }
+    if (!r.eof())
+    {
+        throw std::runtime_error("Trailing bytes in request");
+    }
+    return request;
+}
+
+GscServer::GscServer(const std::vector<std::string> &files, size_t cacheBytes)
+{
+    if (files.empty())
+    {
+        throw std::runtime_error("No .gsc files to serve");
+    }
+    const size_t perFile = cacheBytes / files.size();
+    for (const auto &path : files)
+    {
+        archives.push_back(std::make_unique<Archive>(path, perFile));
+        // 索引在启动时加载，首个查询不再付这部分开销
+        archives.back()->reader.regions();
+        byName[path] = archives.back().get();
+    }
+    // 文件名部分不冲突时也可用作名字
+    std::map<std::string, size_t> uses;
+    for (const auto &path : files)
+    {
+        ++uses[baseName(path)];
+    }
+    for (const auto &path : files)
+    {
+        if (uses[baseName(path)] == 1)
+        {
+            byName.emplace(baseName(path), byName[path]);
+        }
+    }
+}
+
+GscServer::~GscServer() = default;
+
+GscServer::Archive &GscServer::archive(const std::string &name)
+{
+    auto it = byName.find(name);
+    if (it == byName.end())
+    {
+        throw std::runtime_error("File not served: " + name);
+    }
+    return *it->second;
+}
+
+void GscServer::handle(const ServeRequest &request, std::ostream &out)
+{
+    Archive &a = archive(request.file);
+    switch (request.op)
+    {
+    case ServeOp::Samples:
+        for (const auto &s : a.reader.samples())
+        {
+            out << s << '\n';
+        }
+        return;
+    case ServeOp::Stats:
+        out << statsText(request.file, a.reader);
+        return;
+    case ServeOp::Query:
+    {
+        ViewOptions options;
+        options.regions = request.view.regions;
+        options.samples = request.view.samples;
+        options.sampleSubset = request.view.sampleSubset;
+        options.where = request.view.where;
+        options.header = request.view.header;
+        options.dropGenotypes = request.view.dropGenotypes;
+        writeGscView(a.reader, a.cache.get(), options, out);
+        return;
+    }
+    }
+    throw std::runtime_error("Unknown request op");
+}
+
+void GscServer::serveConnection(Connection &conn)
+{
+    const int fd = conn.fd;
+    std::vector<uint8_t> payload;
+    while (running)
+    {
+        try
+        {
+            if (!readFrame(fd, payload, kMaxServeFrame))
+            {
+                break;
+            }
+        }
+        catch (const std::exception &e)
+        {
+            // 帧长度非法时无法继续对齐，报错后断开
+            writeFrame(fd, ServeStatus::Error, e.what());
+            break;
+        }
+        FrameBuf buf(fd);
+        std::ostream out(&buf);
+        // 发送失败时 FrameBuf 抛出的异常穿过 ostream 中止查询
+        out.exceptions(std::ios::badbit);
+        try
+        {
+            handle(decodeServeRequest(payload.data(), payload.size()), out);
+            buf.finish();
+        }
+        catch (const std::exception &e)
+        {
+            if (buf.broken())
+            {
+                break;
+            }
+            buf.discard();
+            if (!writeFrame(fd, ServeStatus::Error, e.what()))
+            {
+                break;
+            }
+        }
+    }
+    std::lock_guard<std::mutex> lock(connMutex);
+    ::close(fd);
+    conn.done = true;
+}
+
+void GscServer::joinConnections(bool all)
+{
+    std::list<Connection> finished;
+    {
+        std::lock_guard<std::mutex> lock(connMutex);
+        for (auto it = connections.begin(); it != connections.end();)
+        {
+            if (all && !it->done)
+            {
+                // 唤醒阻塞在读写上的连接线程
+                ::shutdown(it->fd, SHUT_RDWR);
+            }
+            if (all || it->done)
+            {
+                finished.splice(finished.end(), connections, it++);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    for (Connection &conn : finished)
+    {
+        conn.thread.join();
+    }
+}
+
+void GscServer::serve(const std::string &socketPath)
+{
+    sockaddr_un addr = socketAddress(socketPath);
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        throw std::runtime_error("Failed to create socket: " + std::string(std::strerror(errno)));
+    }
+    ::unlink(socketPath.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || ::listen(listenFd, 64) < 0)
+    {
+        std::string err = std::strerror(errno);
+        ::close(listenFd);
+        throw std::runtime_error("Failed to listen on " + socketPath + ": " + err);
+    }
+
+    running = true;
+    // 定时醒来检查 stop() 标志
+    while (running)
+    {
+        pollfd p{listenFd, POLLIN, 0};
+        int ready = ::poll(&p, 1, 200);
+        joinConnections(false);
+        if (ready <= 0)
+        {
+            continue;
+        }
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(connMutex);
+        Connection &conn = connections.emplace_back();
+        conn.fd = fd;
+        conn.thread = std::thread([this, &conn] { serveConnection(conn); });
+    }
+
+    ::close(listenFd);
+    ::unlink(socketPath.c_str());
+    joinConnections(true);
+}
+
+GscClient::GscClient(const std::string &socketPath)
+{
+    sockaddr_un addr = socketAddress(socketPath);
+    fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+    {
+        std::string err = std::strerror(errno);
+        if (fd >= 0)
+        {
+            ::close(fd);
+        }
+        throw std::runtime_error("Failed to connect to " + socketPath + ": " + err);
+    }
+}
+
+GscClient::~GscClient()
+{
+    ::close(fd);
+}
+
+void GscClient::request(const ServeRequest &request, std::ostream &out)
+{
+    std::vector<uint8_t> payload = encodeServeRequest(request);
+    ByteWriter head;
+    head.putU32(static_cast<uint32_t>(payload.size()));
+    if (!writeFull(fd, head.data.data(), head.size()) || !writeFull(fd, payload.data(), payload.size()))
+    {
+        throw std::runtime_error("Failed to send request");
+    }
+    std::vector<uint8_t> reply;
+    while (true)
+    {
+        if (!readFrame(fd, reply, kMaxServeFrame) || reply.empty())
+        {
+            throw std::runtime_error("Connection closed by server");
+        }
+        const char *text = reinterpret_cast<const char *>(reply.data()) + 1;
+        const size_t length = reply.size() - 1;
+        switch (static_cast<ServeStatus>(reply[0]))
+        {
+        case ServeStatus::More:
+            out.write(text, static_cast<std::streamsize>(length));
+            break;
+        case ServeStatus::Done:
+            out.write(text, static_cast<std::streamsize>(length));
+            return;
+        case ServeStatus::Error:
+            throw std::runtime_error("Server error: " + std::string(text, length));
+        default:
+            throw std::runtime_error("Unknown response status: " + std::to_string(reply[0]));
+        }
+    }
+}
+
+std::string GscClient::request(const ServeRequest &request)
+{
+    std::ostringstream out;
+    this->request(request, out);
+    return out.str();
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "view.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// gsc serve：常驻进程，持有若干 .gsc 文件的映射与共享的解码块缓存，
+// 在 UNIX 域套接字上应答查询，省去每次查询的进程启动与索引加载。
+//
+// 报文：u32 负载长度（小端）| 负载；一个连接上可顺序发送多个请求
+//   请求：u8 操作 | 文件名 (string)
+//     Query   区域数 (varint) + 区域 (string) | u8 样本子集 | 样本数 (varint) + 样本名 | where (string) | u8 输出头部
+//             | u8 只输出站点列
+//     Samples 无参数，应答每行一个样本名
+//     Stats   无参数，应答制表符分隔的统计表
+//   应答：若干帧，每帧 u8 状态 | 文本；More 帧之后还有帧，Done 帧（文本可为空）结束应答，
+//         Error 帧以错误信息结束应答（此前 More 帧中的文本不完整）。查询结果边生成边以不超过 kServeChunk
+//         的帧发出，服务端不缓存整个应答
+// string 为 varint 长度 + 字节。文件名为启动时给出的路径或其文件名部分。
+
+enum class ServeOp : uint8_t
+{
+    Query = 1,
+    Samples = 2,
+    Stats = 3,
+};
+
+enum class ServeStatus : uint8_t
+{
+    Done = 0,
+    Error = 1,
+    More = 2,
+};
+
+constexpr uint32_t kMaxServeFrame = 64u << 20; // 请求与应答帧的负载上限
+constexpr size_t kServeChunk = 1u << 20;       // 应答文本每帧的字节数
+
+struct ServeRequest
+{
+    ServeOp op = ServeOp::Query;
+    std::string file;
+    ViewOptions view; // Query 使用 regions、samples、sampleSubset、where、header、dropGenotypes
+};
+
+std::vector<uint8_t> encodeServeRequest(const ServeRequest &request);
+ServeRequest decodeServeRequest(const uint8_t *data, size_t size);
+
+class GscServer
+{
+public:
+    // cacheBytes 为解码块缓存的总预算，按文件平分
+    GscServer(const std::vector<std::string> &files, size_t cacheBytes);
+    ~GscServer();
+
+    // 应答一个请求，文本写入 out，失败时抛出异常；可多线程并发调用
+    void handle(const ServeRequest &request, std::ostream &out);
+
+    // 在 socketPath 上监听直到 stop()；每个连接一个线程
+    void serve(const std::string &socketPath);
+
+    // 只设置标志，可在信号处理函数中调用；serve() 随后关闭监听与各连接
+    void stop() { running = false; }
+
+private:
+    struct Archive;
+
+    std::vector<std::unique_ptr<Archive>> archives;
+    std::map<std::string, Archive *> byName;
+    std::atomic<bool> running{false};
+
+    // 连接：每个连接一个线程，结束时关闭套接字并置 done；serve() 循环中回收已结束的线程，退出前关闭其余连接
+    // 并 join 全部线程
+    struct Connection
+    {
+        int fd = -1;
+        bool done = false;
+        std::thread thread;
+    };
+    std::mutex connMutex;
+    std::list<Connection> connections;
+
+    Archive &archive(const std::string &name);
+    void serveConnection(Connection &conn);
+    void joinConnections(bool all);
+};
+
+// 本地客户端：连接 socketPath，发送请求并接收应答文本；服务端报错时抛出异常
+class GscClient
+{
+public:
+    explicit GscClient(const std::string &socketPath);
+    ~GscClient();
+
+    GscClient(const GscClient &) = delete;
+    GscClient &operator=(const GscClient &) = delete;
+
+    // 应答文本逐帧写入 out；服务端报错时抛出异常，此前写入 out 的文本不完整
+    void request(const ServeRequest &request, std::ostream &out);
+    std::string request(const ServeRequest &request);
+
+private:
+    int fd = -1;
+};
@@ -0,0 +1,262 @@
+#include "tabix.hpp"
+#include "bgzf.hpp"
+#include "buffer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+namespace
+{
+    uint32_t binFirst(int level)
+    {
+        return ((1u << (3 * level)) - 1) / 7;
+    }
+
+    // 伪箱号：比最大箱号大 1
+    uint32_t pseudoBin(int depth)
+    {
+        return binFirst(depth + 1) + 1;
+    }
+
+    // 箱起点所在的 16 kb 窗口
+    size_t binWindow(uint32_t bin, int depth)
+    {
+        int level = 0;
+        while (level < depth && bin >= binFirst(level + 1))
+        {
+            ++level;
+        }
+        return static_cast<size_t>(bin - binFirst(level)) << (3 * (depth - level));
+    }
+
+    bool parseInt(std::string_view text, int64_t &v)
+    {
+        auto [p, ec] = std::from_chars(text.data(), text.data() + text.size(), v);
+        return ec == std::errc() && p == text.data() + text.size();
+    }
+}
+
+uint32_t tabixRegionBin(int64_t beg, int64_t end, int depth)
+{
+    --end;
+    int shift = kTabixMinShift;
+    for (int level = depth; level > 0; --level, shift += 3)
+    {
+        if (beg >> shift == end >> shift)
+        {
+            return binFirst(level) + static_cast<uint32_t>(beg >> shift);
+        }
+    }
+    return 0;
+}
+
+bool vcfRecordSpan(std::string_view line, int64_t &beg, int64_t &end)
+{
+    std::string_view cols[8];
+    size_t start = 0;
+    for (size_t c = 0; c < 8; ++c)
+    {
+        size_t tab = line.find('\t', start);
+        if (tab == std::string_view::npos)
+        {
+            if (c < 7)
+            {
+                return false;
+            }
+            tab = line.size();
+        }
+        cols[c] = line.substr(start, tab - start);
+        start = tab + 1;
+    }
+    int64_t pos = 0;
+    if (!parseInt(cols[1], pos) || pos < 1)
+    {
+        return false;
+    }
+    beg = pos - 1;
+    end = beg + static_cast<int64_t>(std::max<size_t>(cols[3].size(), 1));
+    std::string_view info = cols[7];
+    for (size_t at = 0; at < info.size();)
+    {
+        size_t semi = info.find(';', at);
+        std::string_view kv = info.substr(at, semi == std::string_view::npos ? semi : semi - at);
+        int64_t value = 0;
+        if (kv.size() > 4 && kv.compare(0, 4, "END=") == 0 && parseInt(kv.substr(4), value) && value > beg)
+        {
+            end = value;
+            break;
+        }
+        if (semi == std::string_view::npos)
+        {
+            break;
+        }
+        at = semi + 1;
+    }
+    return true;
+}
+
+TabixIndexBuilder::TabixIndexBuilder(bool csi) : useCsi(csi), depth(csi ? kCsiDepth : kTbiDepth)
+{
+}
+
+void TabixIndexBuilder::closeChunk(Chrom &c)
+{
+    if (c.openBin != UINT32_MAX)
+    {
+        c.bins[c.openBin].emplace_back(c.openBeg, c.openEnd);
+        c.openBin = UINT32_MAX;
+    }
+}
+
+void TabixIndexBuilder::add(const std::string &chrom, int64_t beg, int64_t end, uint64_t vbeg, uint64_t vend)
+{
+    if (chroms.empty() || chroms.back().name != chrom)
+    {
+        if (!seen.emplace(chrom, chroms.size()).second)
+        {
+            throw std::runtime_error("Cannot index unsorted output: " + chrom + " appears twice");
+        }
+        if (!chroms.empty())
+        {
+            closeChunk(chroms.back());
+        }
+        chroms.emplace_back();
+        chroms.back().name = chrom;
+        chroms.back().firstOffset = vbeg;
+    }
+    if (end > (useCsi ? kCsiMaxPos : kTbiMaxPos))
+    {
+        throw std::runtime_error("Position " + std::to_string(end) + " on " + chrom + " is too large for a " +
+                                 (useCsi ? ".csi" : ".tbi (use csi)") + " index");
+    }
+    Chrom &c = chroms.back();
+    if (beg < c.lastBeg)
+    {
+        throw std::runtime_error("Cannot index unsorted output: " + chrom + ":" + std::to_string(beg + 1));
+    }
+    c.lastBeg = beg;
+
+    const uint32_t bin = tabixRegionBin(beg, end, depth);
+    if (bin != c.openBin)
+    {
+        closeChunk(c);
+        c.openBin = bin;
+        c.openBeg = vbeg;
+    }
+    c.openEnd = vend;
+
+    const size_t first = static_cast<size_t>(beg >> kTabixMinShift);
+    const size_t last = static_cast<size_t>((end - 1) >> kTabixMinShift);
+    if (c.linear.size() <= last)
+    {
+        c.linear.resize(last + 1, UINT64_MAX);
+    }
+    for (size_t w = first; w <= last; ++w)
+    {
+        if (c.linear[w] == UINT64_MAX)
+        {
+            c.linear[w] = vbeg;
+        }
+    }
+    c.lastOffset = vend;
+    ++c.records;
+}
+
+std::string TabixIndexBuilder::finish()
+{
+    if (!chroms.empty())
+    {
+        closeChunk(chroms.back());
+    }
+    for (Chrom &c : chroms)
+    {
+        // 空窗口取前一个窗口的偏移，开头的空窗口取染色体首条记录
+        uint64_t prev = c.firstOffset;
+        for (uint64_t &off : c.linear)
+        {
+            if (off == UINT64_MAX)
+            {
+                off = prev;
+            }
+            prev = off;
+        }
+    }
+
+    ByteWriter w;
+    ByteWriter conf;
+    conf.putU32(2);   // TBX_VCF
+    conf.putU32(1);   // 染色体列
+    conf.putU32(2);   // 起点列
+    conf.putU32(0);   // 终点列：由 REF/END 推出
+    conf.putU32('#'); // 注释行前缀
+    conf.putU32(0);   // 跳过行数
+    std::string names;
+    for (const Chrom &c : chroms)
+    {
+        names += c.name;
+        names += '\0';
+    }
+    conf.putU32(static_cast<uint32_t>(names.size()));
+    conf.putBytes(names.data(), names.size());
+
+    if (useCsi)
+    {
+        w.putBytes("CSI\1", 4);
+        w.putU32(kTabixMinShift);
+        w.putU32(static_cast<uint32_t>(depth));
+        w.putU32(static_cast<uint32_t>(conf.size()));
+        w.putBytes(conf.data.data(), conf.size());
+        w.putU32(static_cast<uint32_t>(chroms.size()));
+    }
+    else
+    {
+        w.putBytes("TBI\1", 4);
+        w.putU32(static_cast<uint32_t>(chroms.size()));
+        w.putBytes(conf.data.data(), conf.size());
+    }
+
+    for (const Chrom &c : chroms)
+    {
+        w.putU32(static_cast<uint32_t>(c.bins.size() + 1));
+        for (const auto &[bin, chunks] : c.bins)
+        {
+            w.putU32(bin);
+            if (useCsi)
+            {
+                const size_t window = binWindow(bin, depth);
+                w.putU64(window < c.linear.size() ? c.linear[window] : 0);
+            }
+            w.putU32(static_cast<uint32_t>(chunks.size()));
+            for (const auto &[beg, end] : chunks)
+            {
+                w.putU64(beg);
+                w.putU64(end);
+            }
+        }
+        w.putU32(pseudoBin(depth));
+        if (useCsi)
+        {
+            w.putU64(0);
+        }
+        w.putU32(2);
+        w.putU64(c.firstOffset);
+        w.putU64(c.lastOffset);
+        w.putU64(c.records);
+        w.putU64(0);
+        if (!useCsi)
+        {
+            w.putU32(static_cast<uint32_t>(c.linear.size()));
+            for (uint64_t off : c.linear)
+            {
+                w.putU64(off);
+            }
+        }
+    }
+    w.putU64(0); // 无坐标的记录数
+
+    std::string out;
+    bgzfCompress(reinterpret_cast<const char *>(w.data.data()), w.size(), out);
+    out += bgzfEofMarker();
+    return out;
+}
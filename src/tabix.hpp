@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 在写 BGZF 输出的同时建立 tabix 索引（htslib 的 .tbi / .csi 格式），省去 tabix -p vcf 的第二遍扫描。
+//
+// 记录按输出顺序加入，区间为 0 基半开 [beg, end)。分箱为 UCSC 方案：最细 2^14 bp，每层 8 叉；
+// .tbi 为 5 层（坐标上限 2^29）并带 16 kb 线性索引，.csi 为 6 层（上限 2^32），每个箱记录最小偏移。
+// 每条染色体额外写入伪箱 (max + 1)：首末偏移与记录数，与 tabix 输出一致。
+
+constexpr int kTabixMinShift = 14;
+constexpr int kTbiDepth = 5;
+constexpr int kCsiDepth = 6;
+constexpr int64_t kTbiMaxPos = int64_t(1) << (kTabixMinShift + 3 * kTbiDepth);
+constexpr int64_t kCsiMaxPos = int64_t(1) << (kTabixMinShift + 3 * kCsiDepth);
+
+// [beg, end) 所在的最小箱号（同 htslib hts_reg2bin）
+uint32_t tabixRegionBin(int64_t beg, int64_t end, int depth);
+
+// VCF 记录的 0 基区间：起点 POS - 1，长度取 REF 长度，INFO 中有 END= 时以 END 为终点
+bool vcfRecordSpan(std::string_view line, int64_t &beg, int64_t &end);
+
+class TabixIndexBuilder
+{
+public:
+    explicit TabixIndexBuilder(bool csi);
+
+    bool csi() const { return useCsi; }
+
+    // vbeg/vend 为记录首字节与末字节之后的虚拟偏移；染色体重复出现或位置倒退时抛出异常
+    void add(const std::string &chrom, int64_t beg, int64_t end, uint64_t vbeg, uint64_t vend);
+
+    // 序列化并以 BGZF 压缩（含结尾空 member），即索引文件的全部内容
+    std::string finish();
+
+private:
+    struct Chrom
+    {
+        std::string name;
+        std::map<uint32_t, std::vector<std::pair<uint64_t, uint64_t>>> bins;
+        std::vector<uint64_t> linear; // 每 16 kb 窗口内起始或跨越记录的最小偏移，未填为 UINT64_MAX
+        uint64_t firstOffset = 0;
+        uint64_t lastOffset = 0;
+        uint64_t records = 0;
+        int64_t lastBeg = -1;
+        uint32_t openBin = UINT32_MAX; // 尚未写入 bins 的当前块
+        uint64_t openBeg = 0;
+        uint64_t openEnd = 0;
+    };
+
+    bool useCsi;
+    int depth;
+    std::vector<Chrom> chroms;
+    std::map<std::string, size_t> seen;
+
+    void closeChunk(Chrom &c);
+};
@@ -0,0 +1,51 @@
+#include "transcode.hpp"
+#include "archive.hpp"
+
+#include <memory>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_pipeline.h>
+#include <stdexcept>
+
+TranscodeSummary transcodeGsc(const std::string &inputFile, const std::string &outputFile, const CodecParams &codec)
+{
+    checkOutputNotInput({inputFile}, outputFile);
+    GscReader reader(inputFile);
+    const GscIndex &index = reader.index();
+    const auto ids = reader.idIndexView().byBlock(static_cast<uint32_t>(index.blocks.size()));
+    GscWriter writer(outputFile, reader.headerText(), codec);
+
+    TranscodeSummary summary;
+    size_t next = 0;
+    tbb::parallel_pipeline(
+        static_cast<size_t>(tbb::info::default_concurrency()) * 2,
+        tbb::make_filter<void, size_t>(
+            tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control &fc) -> size_t
+            {
+                if (next == index.blocks.size())
+                {
+                    fc.stop();
+                    return 0;
+                }
+                return next++;
+            }) &
+            tbb::make_filter<size_t, std::shared_ptr<std::pair<size_t, std::vector<uint8_t>>>>(
+                tbb::filter_mode::parallel,
+                [&](size_t b)
+                {
+                    return std::make_shared<std::pair<size_t, std::vector<uint8_t>>>(
+                        b, recodeBlock(reader.block(b), codec));
+                }) &
+            tbb::make_filter<std::shared_ptr<std::pair<size_t, std::vector<uint8_t>>>, void>(
+                tbb::filter_mode::serial_in_order,
+                [&](std::shared_ptr<std::pair<size_t, std::vector<uint8_t>>> block)
+                {
+                    const auto &[b, bytes] = *block;
+                    writer.writeBlock(bytes, index, b, ids[b]);
+                    ++summary.blocks;
+                    summary.inputBytes += index.blocks[b].size;
+                    summary.outputBytes += bytes.size();
+                }));
+    writer.close();
+    return summary;
+}
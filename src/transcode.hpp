@@ -0,0 +1,19 @@
+#pragma once
+
+#include "codec.hpp"
+
+#include <cstdint>
+#include <string>
+
+// gsc transcode：以另一种编码器重新压缩 .gsc 的字段流，不重新解析 VCF。
+// 各块并行校验、解压并重新压缩每个流，按块顺序写出；头部文本、块划分、段表、流编号，
+// 以及索引中的行数、POS 范围、块摘要与 ID 索引都原样保留，只有块的偏移、大小与 hash 重算。
+
+struct TranscodeSummary
+{
+    uint64_t blocks = 0;
+    uint64_t inputBytes = 0;  // 块数据字节数
+    uint64_t outputBytes = 0;
+};
+
+TranscodeSummary transcodeGsc(const std::string &inputFile, const std::string &outputFile, const CodecParams &codec);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// 64×64 位矩阵原地转置：a[i] 的第 j 位（低位在前）与 a[j] 的第 i 位互换。
+// 递归交换对角块，共 6 轮；跨度 >= 4 的轮次用 AVX2 一次处理 4 个字。
+inline void transpose64(uint64_t a[64])
+{
+    uint64_t m = 0x00000000FFFFFFFFull;
+    for (int j = 32; j != 0; j >>= 1, m ^= m << j)
+    {
+#ifdef __AVX2__
+        if (j >= 4)
+        {
+            const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(m));
+            const __m128i shift = _mm_cvtsi32_si128(j);
+            for (int k = 0; k < 64; k += 2 * j)
+            {
+                for (int i = k; i < k + j; i += 4)
+                {
+                    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+                    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + j));
+                    __m256i t = _mm256_and_si256(_mm256_xor_si256(_mm256_srl_epi64(lo, shift), hi), mask);
+                    hi = _mm256_xor_si256(hi, t);
+                    lo = _mm256_xor_si256(lo, _mm256_sll_epi64(t, shift));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i), lo);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(a + i + j), hi);
+                }
+            }
+            continue;
+        }
+#endif
+        for (int k = 0; k < 64; k = ((k | j) + 1) & ~j)
+        {
+            uint64_t t = ((a[k] >> j) ^ a[k | j]) & m;
+            a[k | j] ^= t;
+            a[k] ^= t << j;
+        }
+    }
+}
@@ -0,0 +1,217 @@
+#include "vcf.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+
+namespace
+{
+    constexpr size_t kReadChunk = 1 << 20; // 1MB
+}
+
+std::string VcfHeader::text() const
+{
+    std::string out;
+    for (const auto &line : metaLines)
+    {
+        out += line;
+        out += '\n';
+    }
+    out += columnLine;
+    out += '\n';
+    return out;
+}
+
+void splitView(std::string_view s, char sep, std::vector<std::string_view> &out)
+{
+    out.clear();
+    size_t start = 0;
+    while (true)
+    {
+        size_t p = s.find(sep, start);
+        if (p == std::string_view::npos)
+        {
+            out.push_back(s.substr(start));
+            return;
+        }
+        out.push_back(s.substr(start, p - start));
+        start = p + 1;
+    }
+}
+
+bool parseVcfRecord(std::string_view line, size_t nSamples, VcfRecord &rec)
+{
+    std::string_view *fixed[9] = {&rec.chrom, &rec.pos, &rec.id, &rec.ref, &rec.alt,
+                                  &rec.qual, &rec.filter, &rec.info, &rec.format};
+    size_t nFixed = nSamples > 0 ? 9 : 8;
+    rec.format = std::string_view();
+    rec.samples.clear();
+
+    size_t start = 0;
+    for (size_t i = 0; i < nFixed; ++i)
+    {
+        size_t p = line.find('\t', start);
+        bool last = (i + 1 == nFixed) && nSamples == 0;
+        if (p == std::string_view::npos)
+        {
+            if (!last)
+            {
+                return false;
+            }
+            p = line.size();
+        }
+        else if (last)
+        {
+            return false;
+        }
+        *fixed[i] = line.substr(start, p - start);
+        start = p + 1;
+    }
+    if (nSamples == 0)
+    {
+        return true;
+    }
+
+    rec.samples.reserve(nSamples);
+    while (rec.samples.size() < nSamples)
+    {
+        size_t p = line.find('\t', start);
+        if (p == std::string_view::npos)
+        {
+            rec.samples.push_back(line.substr(start));
+            break;
+        }
+        rec.samples.push_back(line.substr(start, p - start));
+        start = p + 1;
+        if (rec.samples.size() == nSamples)
+        {
+            return false; // 多出的列
+        }
+    }
+    return rec.samples.size() == nSamples;
+}
+
+int64_t parsePos(std::string_view text)
+{
+    int64_t v = 0;
+    auto res = std::from_chars(text.data(), text.data() + text.size(), v);
+    if (res.ec != std::errc() || res.ptr != text.data() + text.size() || v < 0 ||
+        (text.size() > 1 && text[0] == '0'))
+    {
+        throw std::runtime_error("Invalid POS: " + std::string(text));
+    }
+    return v;
+}
+
+VcfReader::VcfReader(const std::string &path) : buf(kReadChunk)
+{
+    fp = gzopen(path.c_str(), "rb");
+    if (!fp)
+    {
+        throw std::runtime_error("Failed to open VCF file: " + path);
+    }
+    gzbuffer(fp, kReadChunk);
+    readHeader();
+}
+
+VcfReader::~VcfReader()
+{
+    if (fp)
+    {
+        gzclose(fp);
+    }
+}
+
+size_t VcfReader::bytesRead() const
+{
+    return static_cast<size_t>(gzoffset(fp));
+}
+
+bool VcfReader::readLine(std::string &line)
+{
+    line.clear();
+    while (true)
+    {
+        if (bufPos == bufLen)
+        {
+            if (eof)
+            {
+                return !line.empty();
+            }
+            int n = gzread(fp, buf.data(), static_cast<unsigned>(buf.size()));
+            if (n < 0)
+            {
+                int err = 0;
+                throw std::runtime_error(std::string("Failed to read VCF: ") + gzerror(fp, &err));
+            }
+            if (n == 0)
+            {
+                eof = true;
+                return !line.empty();
+            }
+            bufPos = 0;
+            bufLen = static_cast<size_t>(n);
+        }
+        const char *begin = buf.data() + bufPos;
+        const char *nl = static_cast<const char *>(memchr(begin, '\n', bufLen - bufPos));
+        if (nl)
+        {
+            line.append(begin, nl - begin);
+            bufPos += (nl - begin) + 1;
+            return true;
+        }
+        line.append(begin, bufLen - bufPos);
+        bufPos = bufLen;
+    }
+}
+
+void VcfReader::readHeader()
+{
+    std::string line;
+    while (readLine(line))
+    {
+        if (line.compare(0, 2, "##") == 0)
+        {
+            hdr.metaLines.push_back(line);
+            continue;
+        }
+        if (line.compare(0, 6, "#CHROM") != 0)
+        {
+            throw std::runtime_error("Missing #CHROM header line");
+        }
+        hdr.columnLine = line;
+        std::vector<std::string_view> cols;
+        splitView(hdr.columnLine, '\t', cols);
+        for (size_t i = 9; i < cols.size(); ++i)
+        {
+            hdr.samples.emplace_back(cols[i]);
+        }
+        return;
+    }
+    throw std::runtime_error("Missing #CHROM header line");
+}
+
+bool VcfReader::nextLine(std::string &line)
+{
+    while (readLine(line))
+    {
+        if (!line.empty())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isVcfFile(const std::string &path)
+{
+    gzFile f = gzopen(path.c_str(), "rb");
+    if (!f)
+    {
+        return false;
+    }
+    char head[16] = {0};
+    int n = gzread(f, head, sizeof(head));
+    gzclose(f);
+    return n >= 16 && std::string_view(head, 16) == "##fileformat=VCF";
+}
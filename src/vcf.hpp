@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zlib.h>
+
+// VCF 头部：保留原始文本以便无损还原
+struct VcfHeader
+{
+    std::vector<std::string> metaLines; // "##" 开头的行
+    std::string columnLine;             // "#CHROM" 行
+    std::vector<std::string> samples;
+
+    std::string text() const;
+};
+
+// 一条变异记录，各字段指向原始行
+struct VcfRecord
+{
+    std::string_view chrom;
+    std::string_view pos;
+    std::string_view id;
+    std::string_view ref;
+    std::string_view alt;
+    std::string_view qual;
+    std::string_view filter;
+    std::string_view info;
+    std::string_view format;
+    std::vector<std::string_view> samples;
+};
+
+// 按 tab 切分一行，返回列数是否满足 nSamples
+bool parseVcfRecord(std::string_view line, size_t nSamples, VcfRecord &rec);
+
+// 解析十进制 POS
+int64_t parsePos(std::string_view text);
+
+// 按分隔符切分
+void splitView(std::string_view s, char sep, std::vector<std::string_view> &out);
+
+// 流式读取 .vcf / .vcf.gz（gzread 同时支持普通文本与多 member 的 BGZF）
+class VcfReader
+{
+public:
+    explicit VcfReader(const std::string &path);
+    ~VcfReader();
+
+    VcfReader(const VcfReader &) = delete;
+    VcfReader &operator=(const VcfReader &) = delete;
+
+    const VcfHeader &header() const { return hdr; }
+
+    // 读取下一条数据行（不含换行符），文件结束返回 false
+    bool nextLine(std::string &line);
+
+    // 已读取的压缩/原始字节数，用于进度估算
+    size_t bytesRead() const;
+
+private:
+    gzFile fp = nullptr;
+    VcfHeader hdr;
+    std::vector<char> buf;
+    size_t bufPos = 0;
+    size_t bufLen = 0;
+    bool eof = false;
+
+    bool readLine(std::string &line);
+    void readHeader();
+};
+
+// 判断文件内容是否为 VCF
+bool isVcfFile(const std::string &path);
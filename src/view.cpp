@@ -0,0 +1,503 @@
+#include "view.hpp"
+#include "archive.hpp"
+#include "bgzf.hpp"
+#include "block_cache.hpp"
+#include "fields.hpp"
+#include "region.hpp"
+#include "tabix.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <oneapi/tbb/info.h>
+#include <oneapi/tbb/parallel_pipeline.h>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+    // 一次块解码任务：块号 + 需要保留的行覆盖范围（whole 为真时整块输出）
+    struct BlockJob
+    {
+        size_t block = 0;
+        bool whole = true;
+        std::vector<PositionRange> ranges;
+        std::vector<uint32_t> rows; // ID 查询的候选行，为空表示不限
+    };
+
+    // 第三列（ID）中是否有要查的 ID
+    bool lineHasId(std::string_view line, const std::unordered_set<std::string> &ids)
+    {
+        size_t a = line.find('\t');
+        size_t b = a == std::string_view::npos ? a : line.find('\t', a + 1);
+        size_t c = b == std::string_view::npos ? b : line.find('\t', b + 1);
+        if (c == std::string_view::npos)
+        {
+            return false;
+        }
+        bool found = false;
+        forEachId(line.substr(b + 1, c - b - 1), [&](std::string_view id) { found = found || ids.count(std::string(id)); });
+        return found;
+    }
+
+    // 按列切出站点字段（REF..INFO）
+    RowFields lineFields(std::string_view line)
+    {
+        std::string_view cols[8];
+        size_t start = 0;
+        for (size_t c = 0; c < 8; ++c)
+        {
+            size_t end = line.find('\t', start);
+            if (end == std::string_view::npos)
+            {
+                end = line.size();
+                if (end > start && line[end - 1] == '\n')
+                {
+                    --end;
+                }
+                cols[c] = line.substr(std::min(start, end), end - std::min(start, end));
+                start = line.size();
+                continue;
+            }
+            cols[c] = line.substr(start, end - start);
+            start = end + 1;
+        }
+        return {cols[3], cols[4], cols[5], cols[6], cols[7]};
+    }
+
+    // 头部 #CHROM 行只保留所选样本
+    std::string subsetHeader(const GscReader &reader, const std::vector<uint32_t> &samples)
+    {
+        const std::string &text = reader.headerText();
+        size_t colLine = text.rfind("#CHROM");
+        if (colLine == std::string::npos)
+        {
+            return text;
+        }
+        std::string out = text.substr(0, colLine);
+        out += "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO";
+        if (!samples.empty())
+        {
+            out += "\tFORMAT";
+            for (uint32_t s : samples)
+            {
+                out += '\t';
+                out += reader.samples()[s];
+            }
+        }
+        out += '\n';
+        return out;
+    }
+
+    // 渲染一个块任务；ids 非空时只保留 ID 列命中的行，排除哈希冲突（无 ID 索引时即逐行扫描）；
+    // where 非空时不走缓存的路径在解码基因型前逐行过滤，走缓存时对渲染结果逐行过滤
+    std::string renderJob(const GscReader &reader, const BlockJob &job, const std::vector<uint32_t> *samples,
+                          BlockCache *cache, const BlockCache::FieldSet &fieldSet,
+                          const std::unordered_set<std::string> &ids, const WhereFilter &where,
+                          const FieldProjection *fields)
+    {
+        const std::vector<PositionRange> *ranges = job.whole ? nullptr : &job.ranges;
+        std::string out;
+        std::shared_ptr<const DecodedBlock> block;
+        if (cache)
+        {
+            block = cache->get(job.block, fieldSet);
+            if (ids.empty() && where.empty())
+            {
+                block->appendRanges(ranges, out);
+                return out;
+            }
+        }
+        else
+        {
+            auto decoded = std::make_shared<DecodedBlock>();
+            RenderOptions render;
+            render.ranges = ranges;
+            render.samples = samples;
+            render.blockRows = job.rows.empty() ? nullptr : &job.rows;
+            render.rows = ids.empty() ? nullptr : &decoded->rows;
+            render.where = where.empty() ? nullptr : &where;
+            render.fields = fields;
+            const GscIndex &index = reader.index();
+            // 只要部分段、部分样本或部分列时只校验段表，用到的段与流取用时逐个校验，其余字节不读入
+            const bool partial = ranges || render.blockRows || fields || samples;
+            renderBlockVcf(reader.block(job.block, partial ? BlockPart::Partial : BlockPart::All),
+                           index.chroms[index.blocks[job.block].chromId],
+                           static_cast<uint32_t>(reader.samples().size()), render, decoded->text);
+            if (ids.empty())
+            {
+                return std::move(decoded->text);
+            }
+            block = std::move(decoded);
+        }
+        for (const RenderedRow &row : block->rows)
+        {
+            if (cache && ranges && !overlapsAny(*ranges, row.pos, row.stop))
+            {
+                continue;
+            }
+            std::string_view line(block->text.data() + row.offset, row.length);
+            if ((ids.empty() || lineHasId(line, ids)) && (!cache || where.matches(lineFields(line))))
+            {
+                out.append(line.data(), line.size());
+            }
+        }
+        return out;
+    }
+
+    std::vector<BlockJob> planJobs(const GscReader &reader, const ViewOptions &options)
+    {
+        std::vector<BlockJob> jobs;
+        const GscIndex &index = reader.index();
+        if (!options.ids.empty() && reader.hasIdIndex())
+        {
+            // 由 ID 索引定位候选行，只解码这些块
+            std::map<size_t, std::vector<uint32_t>> rows;
+            for (const auto &id : options.ids)
+            {
+                for (const IdLocation &loc : reader.findId(id))
+                {
+                    rows[loc.block].push_back(loc.row);
+                }
+            }
+            for (auto &r : rows)
+            {
+                std::sort(r.second.begin(), r.second.end());
+                r.second.erase(std::unique(r.second.begin(), r.second.end()), r.second.end());
+                jobs.push_back({r.first, true, {}, std::move(r.second)});
+            }
+            return jobs;
+        }
+        if (options.regions.empty() && options.regionsFile.empty())
+        {
+            for (size_t i = 0; i < index.blocks.size(); ++i)
+            {
+                jobs.push_back({i});
+            }
+            return jobs;
+        }
+
+        // 合并后按区间顺序求块的并集，每块只解码一次，行按落入任一区间筛选
+        std::vector<GenomicRegion> wanted;
+        if (!options.regionsFile.empty())
+        {
+            wanted = readBedFile(options.regionsFile);
+        }
+        for (const auto &text : options.regions)
+        {
+            wanted.push_back(parseRegion(text));
+        }
+        std::unordered_map<size_t, size_t> jobOf;
+        for (const GenomicRegion &region : reader.regions().merge(std::move(wanted)))
+        {
+            for (size_t i : reader.regions().blocksFor(region))
+            {
+                auto it = jobOf.find(i);
+                if (it == jobOf.end())
+                {
+                    it = jobOf.emplace(i, jobs.size()).first;
+                    jobs.push_back({i, false});
+                }
+                BlockJob &job = jobs[it->second];
+                job.ranges.emplace_back(region.start, region.end);
+                // 完全落在区间内的块不必逐行判断
+                const BlockIndexEntry &e = index.blocks[i];
+                job.whole = job.whole || (e.minPos >= region.start && e.maxPos <= region.end);
+            }
+        }
+        std::sort(jobs.begin(), jobs.end(), [](const BlockJob &a, const BlockJob &b) { return a.block < b.block; });
+        return jobs;
+    }
+
+    // 一个任务的输出：BGZF 时为压缩后的 member，records 为各行 [beg, end) 与行尾在解压文本中的偏移
+    struct RenderedJob
+    {
+        size_t order = 0; // jobs 中的下标
+        std::string bytes;
+        std::vector<uint32_t> memberSizes;
+        struct Record
+        {
+            int64_t beg;
+            int64_t end;
+            size_t textEnd;
+        };
+        std::vector<Record> records;
+    };
+
+    void collectRecords(const std::string &text, std::vector<RenderedJob::Record> &records)
+    {
+        for (size_t start = 0; start < text.size();)
+        {
+            size_t nl = text.find('\n', start);
+            size_t next = nl == std::string::npos ? text.size() : nl + 1;
+            int64_t beg = 0;
+            int64_t end = 0;
+            if (!vcfRecordSpan(std::string_view(text).substr(start, next - start - (nl == std::string::npos ? 0 : 1)),
+                               beg, end))
+            {
+                throw std::runtime_error("Cannot index malformed record at output offset " + std::to_string(start));
+            }
+            records.push_back({beg, end, next});
+            start = next;
+        }
+    }
+
+    // 解压文本偏移 -> 虚拟偏移；offset 恰在末尾且整除时落在下一个 member 的起点
+    uint64_t jobVirtualOffset(uint64_t jobStart, const std::vector<uint64_t> &memberStarts, size_t offset)
+    {
+        const size_t m = offset / kBgzfBlockInput;
+        return bgzfVirtualOffset(jobStart + memberStarts[m], offset % kBgzfBlockInput);
+    }
+}
+
+void writeGscView(const GscReader &reader, BlockCache *cache, const ViewOptions &options, std::ostream &out,
+                  TabixIndexBuilder *tabix)
+{
+    if (tabix && !options.bgzf)
+    {
+        throw std::runtime_error("A tabix index needs BGZF output (-O z)");
+    }
+    if (!options.ids.empty() && (!options.regions.empty() || !options.regionsFile.empty()))
+    {
+        throw std::runtime_error("-i cannot be combined with -r/-R");
+    }
+    if (options.dropGenotypes && options.sampleSubset)
+    {
+        throw std::runtime_error("--drop-genotypes cannot be combined with -s/-S");
+    }
+    std::unique_ptr<FieldProjection> fields;
+    if (!options.fields.empty())
+    {
+        if (!options.ids.empty() || options.dropGenotypes)
+        {
+            throw std::runtime_error("--fields cannot be combined with -i or --drop-genotypes");
+        }
+        if (options.bgzf)
+        {
+            throw std::runtime_error("--fields cannot be combined with -O z or --write-index");
+        }
+        fields = std::make_unique<FieldProjection>(FieldProjection::parse(options.fields, options.tsv));
+        // 缓存中是整行渲染的文本
+        cache = nullptr;
+    }
+    const WhereFilter where = WhereFilter::parse(options.where);
+    std::vector<BlockJob> jobs = options.headerOnly ? std::vector<BlockJob>() : planJobs(reader, options);
+    if (!where.empty())
+    {
+        // 块摘要排除不可能命中的块
+        const GscIndex &index = reader.index();
+        jobs.erase(std::remove_if(jobs.begin(), jobs.end(),
+                                  [&](const BlockJob &job)
+                                  { return !where.mayMatch(index.blocks[job.block].zone, index.filters); }),
+                   jobs.end());
+    }
+    const std::unordered_set<std::string> ids(options.ids.begin(), options.ids.end());
+    // 去掉基因型或投影中没有样本字段时即输出空的样本子集
+    const bool noSamples = options.dropGenotypes || (fields && fields->sampleFields().empty());
+    const bool subset = options.sampleSubset || noSamples;
+    std::vector<uint32_t> samples;
+    if (options.sampleSubset && !noSamples)
+    {
+        samples = resolveSamples(reader, options.samples);
+    }
+    uint64_t written = 0; // 已写出的字节数，BGZF 时即下一个 member 的文件偏移
+    if (options.header)
+    {
+        std::string header;
+        if (fields && fields->tsv())
+        {
+            std::vector<uint32_t> all(subset ? 0 : reader.samples().size());
+            std::iota(all.begin(), all.end(), 0u);
+            header = fields->tsvHeader(reader.samples(), subset ? samples : all);
+        }
+        else
+        {
+            header = subset ? subsetHeader(reader, samples) : reader.headerText();
+        }
+        if (options.bgzf)
+        {
+            std::string packed;
+            bgzfCompress(header.data(), header.size(), packed);
+            header.swap(packed);
+        }
+        out.write(header.data(), header.size());
+        written += header.size();
+    }
+    const BlockCache::FieldSet fieldSet =
+        cache ? BlockCache::fieldSet(subset ? &samples : nullptr) : BlockCache::FieldSet();
+    size_t next = 0;
+
+    tbb::parallel_pipeline(
+        static_cast<size_t>(tbb::info::default_concurrency()) * 2,
+        tbb::make_filter<void, size_t>(
+            tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control &fc) -> size_t
+            {
+                if (next == jobs.size())
+                {
+                    fc.stop();
+                    return 0;
+                }
+                return next++;
+            }) &
+            tbb::make_filter<size_t, std::shared_ptr<RenderedJob>>(
+                tbb::filter_mode::parallel,
+                [&](size_t j)
+                {
+                    auto job = std::make_shared<RenderedJob>();
+                    job->order = j;
+                    job->bytes = renderJob(reader, jobs[j], subset ? &samples : nullptr, cache, fieldSet,
+                                           ids, where, fields.get());
+                    if (options.bgzf && !job->bytes.empty())
+                    {
+                        // 每块单独成若干 member，块末尾的 member 不满 64 KiB，仍是合法 BGZF
+                        if (tabix)
+                        {
+                            collectRecords(job->bytes, job->records);
+                        }
+                        std::string packed;
+                        bgzfCompress(job->bytes.data(), job->bytes.size(), packed, &job->memberSizes);
+                        job->bytes.swap(packed);
+                    }
+                    return job;
+                }) &
+            tbb::make_filter<std::shared_ptr<RenderedJob>, void>(
+                tbb::filter_mode::serial_in_order,
+                [&](std::shared_ptr<RenderedJob> job)
+                {
+                    if (tabix && !job->records.empty())
+                    {
+                        std::vector<uint64_t> memberStarts(job->memberSizes.size() + 1, 0);
+                        for (size_t m = 0; m < job->memberSizes.size(); ++m)
+                        {
+                            memberStarts[m + 1] = memberStarts[m] + job->memberSizes[m];
+                        }
+                        const GscIndex &index = reader.index();
+                        const std::string &chrom = index.chroms[index.blocks[jobs[job->order].block].chromId];
+                        size_t textBeg = 0;
+                        for (const RenderedJob::Record &r : job->records)
+                        {
+                            tabix->add(chrom, r.beg, r.end, jobVirtualOffset(written, memberStarts, textBeg),
+                                       jobVirtualOffset(written, memberStarts, r.textEnd));
+                            textBeg = r.textEnd;
+                        }
+                    }
+                    out.write(job->bytes.data(), job->bytes.size());
+                    written += job->bytes.size();
+                }));
+    if (options.bgzf)
+    {
+        out.write(bgzfEofMarker().data(), bgzfEofMarker().size());
+    }
+}
+
+void viewGscFile(const std::string &inputFile, const std::string &outputFile, const ViewOptions &options)
+{
+    GscReader reader(inputFile);
+    std::ofstream file;
+    std::ostream *out = &std::cout;
+    if (outputFile != "-")
+    {
+        file.open(outputFile, std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open output file: " + outputFile);
+        }
+        out = &file;
+    }
+    std::unique_ptr<BlockCache> cache;
+    if (options.cacheBytes > 0)
+    {
+        cache = std::make_unique<BlockCache>(reader, options.cacheBytes);
+    }
+    std::unique_ptr<TabixIndexBuilder> tabix;
+    if (!options.writeIndex.empty())
+    {
+        if (options.writeIndex != "tbi" && options.writeIndex != "csi")
+        {
+            throw std::runtime_error("Unknown index format: " + options.writeIndex);
+        }
+        if (outputFile == "-")
+        {
+            throw std::runtime_error("Writing an index needs an output file (-o)");
+        }
+        bool csi = options.writeIndex == "csi";
+        for (const ChromSummary &c : reader.index().chromSummaries)
+        {
+            // 按记录起点预判；gVCF 的 END 越界时由 add() 报错
+            csi = csi || c.maxPos >= kTbiMaxPos;
+        }
+        if (csi && options.writeIndex == "tbi")
+        {
+            spdlog::warn("Positions exceed the .tbi limit of 2^29, writing a .csi index instead");
+        }
+        tabix = std::make_unique<TabixIndexBuilder>(csi);
+    }
+    writeGscView(reader, cache.get(), options, *out, tabix.get());
+
+    out->flush();
+    if (!*out)
+    {
+        throw std::runtime_error("Failed to write output file: " + outputFile);
+    }
+    if (tabix)
+    {
+        const std::string indexFile = outputFile + (tabix->csi() ? ".csi" : ".tbi");
+        const std::string bytes = tabix->finish();
+        std::ofstream index(indexFile, std::ios::binary);
+        if (!index.write(bytes.data(), bytes.size()))
+        {
+            throw std::runtime_error("Failed to write index file: " + indexFile);
+        }
+    }
+}
+
+std::vector<uint32_t> resolveSamples(const GscReader &reader, const std::vector<std::string> &names)
+{
+    std::unordered_map<std::string, uint32_t> columns;
+    for (uint32_t s = 0; s < reader.samples().size(); ++s)
+    {
+        columns.emplace(reader.samples()[s], s);
+    }
+    std::vector<uint32_t> out;
+    for (const auto &name : names)
+    {
+        auto it = columns.find(name);
+        if (it == columns.end())
+        {
+            throw std::runtime_error("Sample not found: " + name);
+        }
+        out.push_back(it->second);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<std::string> readSampleList(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in.is_open())
+    {
+        throw std::runtime_error("Failed to open sample list: " + path);
+    }
+    std::vector<std::string> names;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+        if (!line.empty())
+        {
+            names.push_back(line);
+        }
+    }
+    return names;
+}
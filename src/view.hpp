@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class BlockCache;
+class GscReader;
+class TabixIndexBuilder;
+
+struct ViewOptions
+{
+    std::vector<std::string> regions; // -r：chr[:start[-end]]
+    std::string regionsFile;          // -R：BED 文件；与 -r 合并后按文件中的染色体与位置顺序输出
+    std::vector<std::string> samples; // -s/-S：样本子集，按文件中的列顺序输出
+    bool sampleSubset = false;
+    std::vector<std::string> ids;     // -i：按变异 ID 查询，有 ID 索引时只解码命中的块
+    size_t cacheBytes = 0;            // 解码块缓存预算，0 表示不缓存；重叠区域重复命中同一块时受益
+    std::string where;                // --where：按 QUAL/AF/FILTER/TYPE 过滤，先用块摘要跳过整块
+    bool header = true;               // 输出 VCF 头部
+    bool headerOnly = false;          // --header-only：只输出头部，不读任何块
+    bool dropGenotypes = false;       // -G：只输出前 8 列，FORMAT 与样本流既不解码也不从磁盘读入
+    std::string fields;               // -f：列投影，如 "CHROM,POS,INFO/AF,GT"，只读入所选列与键的字段流（见 fields.hpp）
+    bool tsv = false;                 // --tsv：列投影输出为制表符分隔的表格而非 VCF
+    bool bgzf = false;                // -O z：各块文本并行压缩为 BGZF member 后按序写出
+    std::string writeIndex;           // -W：随 BGZF 输出写 "tbi" 或 "csi" 索引，坐标超出 .tbi 上限时改写 .csi
+};
+
+// -S：每行一个样本名
+std::vector<std::string> readSampleList(const std::string &path);
+
+// 样本名 -> 列号，递增去重；文件中没有的样本名抛出异常
+std::vector<uint32_t> resolveSamples(const GscReader &reader, const std::vector<std::string> &names);
+
+// 按 options 解码已打开的读取器写入 out；cache 可为空指针，非空时在多次调用间共享（options.cacheBytes 不起作用）。
+// tabix 非空时（需 options.bgzf）按写出顺序加入每条记录的虚拟偏移
+void writeGscView(const GscReader &reader, BlockCache *cache, const ViewOptions &options, std::ostream &out,
+                  TabixIndexBuilder *tabix = nullptr);
+
+// .gsc -> VCF；outputFile 为 "-" 时写标准输出
+void viewGscFile(const std::string &inputFile, const std::string &outputFile, const ViewOptions &options);
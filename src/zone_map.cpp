@@ -0,0 +1,392 @@
+#include "zone_map.hpp"
+
+#include <cctype>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+namespace
+{
+    std::string_view trim(std::string_view s)
+    {
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+        {
+            s.remove_prefix(1);
+        }
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+        {
+            s.remove_suffix(1);
+        }
+        return s;
+    }
+
+    // 按多字符分隔符切分
+    std::vector<std::string_view> splitOn(std::string_view s, std::string_view sep)
+    {
+        std::vector<std::string_view> parts;
+        size_t start = 0;
+        while (true)
+        {
+            size_t end = s.find(sep, start);
+            if (end == std::string_view::npos)
+            {
+                parts.push_back(s.substr(start));
+                return parts;
+            }
+            parts.push_back(s.substr(start, end - start));
+            start = end + sep.size();
+        }
+    }
+
+    std::string upper(std::string_view s)
+    {
+        std::string out(s);
+        for (char &c : out)
+        {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return out;
+    }
+
+    bool isBase(char c)
+    {
+        switch (c)
+        {
+        case 'A': case 'C': case 'G': case 'T': case 'N':
+        case 'a': case 'c': case 'g': case 't': case 'n':
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool isBases(std::string_view s)
+    {
+        if (s.empty())
+        {
+            return false;
+        }
+        for (char c : s)
+        {
+            if (!isBase(c))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint8_t alleleType(std::string_view ref, std::string_view alt)
+    {
+        if (alt.empty() || alt == "." || alt == "<*>" || alt == "<NON_REF>")
+        {
+            return kTypeRef;
+        }
+        if (!isBases(alt) || !isBases(ref))
+        {
+            return kTypeOther;
+        }
+        if (alt.size() != ref.size())
+        {
+            return kTypeIndel;
+        }
+        if (alt == ref)
+        {
+            return kTypeRef;
+        }
+        return alt.size() == 1 ? kTypeSnp : kTypeMnp;
+    }
+
+    bool filterHas(std::string_view filter, std::string_view name)
+    {
+        bool found = false;
+        forEachFilter(filter, [&](std::string_view f) { found = found || f == name; });
+        return found;
+    }
+}
+
+uint8_t variantTypeMask(std::string_view ref, std::string_view alt)
+{
+    uint8_t mask = 0;
+    size_t start = 0;
+    while (start <= alt.size())
+    {
+        size_t end = alt.find(',', start);
+        if (end == std::string_view::npos)
+        {
+            end = alt.size();
+        }
+        mask |= alleleType(ref, alt.substr(start, end - start));
+        start = end + 1;
+    }
+    // 参考块的 <NON_REF> 之外还有真实等位基因时不算参考
+    if (mask != kTypeRef)
+    {
+        mask &= static_cast<uint8_t>(~kTypeRef);
+    }
+    return mask;
+}
+
+bool parseNumber(std::string_view text, double &value)
+{
+    if (text.empty() || text == ".")
+    {
+        return false;
+    }
+    const char *end = text.data() + text.size();
+    auto res = std::from_chars(text.data(), end, value);
+    return res.ec == std::errc() && res.ptr == end && !std::isnan(value);
+}
+
+void ZoneMap::add(const RowFields &row, uint8_t type)
+{
+    double q = 0;
+    if (parseNumber(row.qual, q))
+    {
+        minQual = std::isnan(minQual) ? q : std::min(minQual, q);
+        maxQual = std::isnan(maxQual) ? q : std::max(maxQual, q);
+    }
+    forEachAf(row.info,
+              [&](double af)
+              {
+                  minAf = std::isnan(minAf) ? af : std::min(minAf, af);
+                  maxAf = std::isnan(maxAf) ? af : std::max(maxAf, af);
+              });
+    typeMask |= type;
+}
+
+WhereFilter WhereFilter::parse(const std::string &text)
+{
+    WhereFilter filter;
+    if (trim(text).empty())
+    {
+        return filter;
+    }
+    auto fail = [&](std::string_view why) -> std::runtime_error
+    { return std::runtime_error("Invalid --where expression (" + std::string(why) + "): " + text); };
+
+    for (std::string_view clauseText : splitOn(text, "||"))
+    {
+        std::vector<Term> clause;
+        for (std::string_view termText : splitOn(clauseText, "&&"))
+        {
+            termText = trim(termText);
+            size_t opPos = termText.find_first_of("<>=!");
+            if (opPos == std::string_view::npos || opPos == 0)
+            {
+                throw fail("expected FIELD OP VALUE");
+            }
+            size_t opEnd = opPos + 1;
+            if (opEnd < termText.size() && termText[opEnd] == '=')
+            {
+                ++opEnd;
+            }
+            std::string_view opText = termText.substr(opPos, opEnd - opPos);
+            std::string field = upper(trim(termText.substr(0, opPos)));
+            std::string_view value = trim(termText.substr(opEnd));
+            if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front())
+            {
+                value = value.substr(1, value.size() - 2);
+            }
+            if (value.empty())
+            {
+                throw fail("missing value");
+            }
+
+            Term t;
+            static const std::pair<std::string_view, Op> kOps[] = {
+                {"<", Op::Lt}, {"<=", Op::Le}, {">", Op::Gt}, {">=", Op::Ge},
+                {"=", Op::Eq}, {"==", Op::Eq}, {"!=", Op::Ne},
+            };
+            auto op = std::find_if(std::begin(kOps), std::end(kOps), [&](const auto &o) { return o.first == opText; });
+            if (op == std::end(kOps))
+            {
+                throw fail("unknown operator " + std::string(opText));
+            }
+            t.op = op->second;
+
+            if (field == "QUAL" || field == "AF" || field == "INFO/AF")
+            {
+                t.field = field == "QUAL" ? Field::Qual : Field::Af;
+                if (!parseNumber(value, t.number))
+                {
+                    throw fail("not a number: " + std::string(value));
+                }
+            }
+            else if (field == "FILTER" || field == "TYPE")
+            {
+                if (t.op != Op::Eq && t.op != Op::Ne)
+                {
+                    throw fail(field + " supports only = and !=");
+                }
+                t.field = field == "FILTER" ? Field::Filter : Field::Type;
+                t.name = std::string(value);
+                if (t.field == Field::Type)
+                {
+                    std::string type = upper(value);
+                    t.type = type == "SNP"     ? kTypeSnp
+                             : type == "MNP"   ? kTypeMnp
+                             : type == "INDEL" ? kTypeIndel
+                             : type == "OTHER" ? kTypeOther
+                             : type == "REF"   ? kTypeRef
+                                               : 0;
+                    if (!t.type)
+                    {
+                        throw fail("unknown TYPE " + t.name);
+                    }
+                }
+            }
+            else
+            {
+                throw fail("unknown field " + field);
+            }
+            clause.push_back(std::move(t));
+        }
+        filter.clauses.push_back(std::move(clause));
+    }
+    return filter;
+}
+
+bool WhereFilter::compare(double value, Op op, double number)
+{
+    switch (op)
+    {
+    case Op::Lt:
+        return value < number;
+    case Op::Le:
+        return value <= number;
+    case Op::Gt:
+        return value > number;
+    case Op::Ge:
+        return value >= number;
+    case Op::Eq:
+        return value == number;
+    case Op::Ne:
+        return value != number;
+    }
+    return false;
+}
+
+bool WhereFilter::rangeMayMatch(double lo, double hi, Op op, double number)
+{
+    if (std::isnan(lo) || std::isnan(hi))
+    {
+        return false;
+    }
+    switch (op)
+    {
+    case Op::Lt:
+        return lo < number;
+    case Op::Le:
+        return lo <= number;
+    case Op::Gt:
+        return hi > number;
+    case Op::Ge:
+        return hi >= number;
+    case Op::Eq:
+        return lo <= number && number <= hi;
+    case Op::Ne:
+        return !(lo == number && hi == number);
+    }
+    return true;
+}
+
+bool WhereFilter::termMayMatch(const Term &t, const ZoneMap &zone, const std::vector<std::string> &filters)
+{
+    switch (t.field)
+    {
+    case Field::Qual:
+        return rangeMayMatch(zone.minQual, zone.maxQual, t.op, t.number);
+    case Field::Af:
+        return rangeMayMatch(zone.minAf, zone.maxAf, t.op, t.number);
+    case Field::Filter:
+    {
+        auto it = std::find(filters.begin(), filters.end(), t.name);
+        if (it == filters.end())
+        {
+            // 文件中没有这个 FILTER 名
+            return t.op == Op::Ne;
+        }
+        const uint32_t id = static_cast<uint32_t>(it - filters.begin());
+        if (t.op == Op::Eq)
+        {
+            return (zone.filterMask & filterBit(id)) != 0;
+        }
+        // 块内只有这一个名称（且未与其他名称共用溢出位）时每行都带它
+        return id >= kFilterOverflowBit || zone.filterMask != filterBit(id);
+    }
+    case Field::Type:
+        if (t.op == Op::Eq)
+        {
+            return (zone.typeMask & t.type) != 0;
+        }
+        return zone.typeMask != t.type;
+    }
+    return true;
+}
+
+bool WhereFilter::termMatches(const Term &t, const RowFields &row)
+{
+    switch (t.field)
+    {
+    case Field::Qual:
+    {
+        double q = 0;
+        return parseNumber(row.qual, q) && compare(q, t.op, t.number);
+    }
+    case Field::Af:
+    {
+        bool hit = false;
+        forEachAf(row.info, [&](double af) { hit = hit || compare(af, t.op, t.number); });
+        return hit;
+    }
+    case Field::Filter:
+        return filterHas(row.filter, t.name) == (t.op == Op::Eq);
+    case Field::Type:
+        return ((variantTypeMask(row.ref, row.alt) & t.type) != 0) == (t.op == Op::Eq);
+    }
+    return true;
+}
+
+bool WhereFilter::mayMatch(const ZoneMap &zone, const std::vector<std::string> &filters) const
+{
+    if (clauses.empty())
+    {
+        return true;
+    }
+    for (const auto &clause : clauses)
+    {
+        bool all = true;
+        for (const Term &t : clause)
+        {
+            all = all && termMayMatch(t, zone, filters);
+        }
+        if (all)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WhereFilter::matches(const RowFields &row) const
+{
+    if (clauses.empty())
+    {
+        return true;
+    }
+    for (const auto &clause : clauses)
+    {
+        bool all = true;
+        for (const Term &t : clause)
+        {
+            all = all && termMatches(t, row);
+        }
+        if (all)
+        {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 块级摘要（zone map）与 --where 过滤
+//
+// 每块在索引中记录 QUAL 与 INFO/AF 的取值范围、出现过的 FILTER 名（文件级名表中的位）
+// 以及变异类型位图。过滤表达式先用摘要排除整块，再对保留块的站点列逐行求值，
+// 只有命中的行才解码基因型与 FORMAT 列。
+
+// 变异类型位
+constexpr uint8_t kTypeSnp = 0x01;
+constexpr uint8_t kTypeMnp = 0x02;
+constexpr uint8_t kTypeIndel = 0x04;
+constexpr uint8_t kTypeOther = 0x08; // 符号等位基因、断点、'*'
+constexpr uint8_t kTypeRef = 0x10;   // 无 ALT 或 gVCF 参考块
+
+// 文件级 FILTER 名表中第 kFilterOverflowBit 个及以后的名称共用最高位
+constexpr uint32_t kFilterOverflowBit = 63;
+
+inline uint64_t filterBit(uint32_t filterId)
+{
+    return uint64_t(1) << std::min(filterId, kFilterOverflowBit);
+}
+
+// 一行的站点列
+struct RowFields
+{
+    std::string_view ref;
+    std::string_view alt;
+    std::string_view qual;
+    std::string_view filter;
+    std::string_view info;
+};
+
+// 各 ALT 等位基因类型的并集
+uint8_t variantTypeMask(std::string_view ref, std::string_view alt);
+
+// 解析 QUAL/AF 数值，'.' 或非数值时返回 false
+bool parseNumber(std::string_view text, double &value);
+
+// 对 INFO/AF 的每个数值分量调用 f
+template <class F>
+void forEachAf(std::string_view info, F &&f);
+
+// 对 FILTER 列的每个名称（';' 分隔）调用 f
+template <class F>
+void forEachFilter(std::string_view filter, F &&f)
+{
+    size_t start = 0;
+    while (start <= filter.size())
+    {
+        size_t end = filter.find(';', start);
+        if (end == std::string_view::npos)
+        {
+            end = filter.size();
+        }
+        if (end > start)
+        {
+            f(filter.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+}
+
+struct ZoneMap
+{
+    // 没有数值时为 NaN，任何数值比较都不成立
+    double minQual = NAN;
+    double maxQual = NAN;
+    double minAf = NAN;
+    double maxAf = NAN;
+    uint64_t filterMask = 0;
+    uint8_t typeMask = 0;
+
+    // 累加一行的 QUAL、AF 与类型；FILTER 位由持有名表的一方设置
+    void add(const RowFields &row, uint8_t type);
+};
+
+// --where 表达式：若干子句以 "||" 相连，子句内条件以 "&&" 相连，条件形如
+//   QUAL>30  AF>=0.01  FILTER=PASS  FILTER!=LowQual  TYPE=snp|mnp|indel|other|ref
+// 数值比较符 < <= > >= = == !=；缺失的 QUAL/AF 不满足任何比较，
+// 多等位位点任一 AF 分量满足即命中；FILTER/TYPE 只支持 = 与 !=
+class WhereFilter
+{
+public:
+    static WhereFilter parse(const std::string &text);
+
+    bool empty() const { return clauses.empty(); }
+
+    // 块内是否可能有命中行；filters 为文件级 FILTER 名表
+    bool mayMatch(const ZoneMap &zone, const std::vector<std::string> &filters) const;
+
+    // 行是否命中
+    bool matches(const RowFields &row) const;
+
+private:
+    enum class Field : uint8_t
+    {
+        Qual,
+        Af,
+        Filter,
+        Type,
+    };
+    enum class Op : uint8_t
+    {
+        Lt,
+        Le,
+        Gt,
+        Ge,
+        Eq,
+        Ne,
+    };
+    struct Term
+    {
+        Field field = Field::Qual;
+        Op op = Op::Eq;
+        double number = 0;
+        std::string name;
+        uint8_t type = 0;
+    };
+
+    std::vector<std::vector<Term>> clauses;
+
+    static bool compare(double value, Op op, double number);
+    static bool rangeMayMatch(double lo, double hi, Op op, double number);
+    static bool termMayMatch(const Term &t, const ZoneMap &zone, const std::vector<std::string> &filters);
+    static bool termMatches(const Term &t, const RowFields &row);
+};
+
+template <class F>
+void forEachAf(std::string_view info, F &&f)
+{
+    size_t start = 0;
+    while (start < info.size())
+    {
+        size_t end = info.find(';', start);
+        if (end == std::string_view::npos)
+        {
+            end = info.size();
+        }
+        std::string_view field = info.substr(start, end - start);
+        if (field.size() > 3 && field.substr(0, 3) == "AF=")
+        {
+            std::string_view values = field.substr(3);
+            size_t vs = 0;
+            while (vs <= values.size())
+            {
+                size_t ve = values.find(',', vs);
+                if (ve == std::string_view::npos)
+                {
+                    ve = values.size();
+                }
+                double v = 0;
+                if (parseNumber(values.substr(vs, ve - vs), v))
+                {
+                    f(v);
+                }
+                vs = ve + 1;
+            }
+            return;
+        }
+        start = end + 1;
+    }
+}
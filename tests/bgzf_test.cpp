@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "../src/bgzf.hpp"
+
+#include <string>
+#include <zlib.h>
+
+namespace
+{
+    // 按 gzip 多 member 规则整体解压
+    std::string gunzip(const std::string &data)
+    {
+        z_stream zs{};
+        EXPECT_EQ(inflateInit2(&zs, 15 + 32), Z_OK);
+        std::string out;
+        char buf[1 << 16];
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        while (zs.avail_in > 0)
+        {
+            zs.next_out = reinterpret_cast<Bytef *>(buf);
+            zs.avail_out = sizeof(buf);
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            out.append(buf, sizeof(buf) - zs.avail_out);
+            if (ret == Z_STREAM_END)
+            {
+                inflateReset(&zs);
+            }
+            else if (ret != Z_OK)
+            {
+                ADD_FAILURE() << "inflate failed: " << ret;
+                break;
+            }
+        }
+        inflateEnd(&zs);
+        return out;
+    }
+}
+
+TEST(Bgzf, MembersAreTabixCompatible)
+{
+    std::string text;
+    for (int i = 0; text.size() < 5 * kBgzfBlockInput; ++i)
+    {
+        text += "chr1\t" + std::to_string(i * 7919 % 1000003) + "\t.\tA\tG\t.\tPASS\t.\n";
+    }
+    std::string packed;
+    bgzfCompress(text.data(), text.size(), packed);
+    size_t members = 0;
+    for (size_t at = 0; at < packed.size(); ++members)
+    {
+        ASSERT_LE(at + 18, packed.size());
+        const auto *p = reinterpret_cast<const uint8_t *>(packed.data() + at);
+        EXPECT_EQ(p[0], 0x1f);
+        EXPECT_EQ(p[1], 0x8b);
+        EXPECT_EQ(p[3], 4); // FEXTRA
+        EXPECT_EQ(p[12], 'B');
+        EXPECT_EQ(p[13], 'C');
+        size_t bsize = (p[16] | (p[17] << 8)) + 1u;
+        EXPECT_LE(bsize, kBgzfMaxMember);
+        at += bsize;
+        ASSERT_LE(at, packed.size());
+    }
+    EXPECT_EQ(members, 6u);
+
+    packed += bgzfEofMarker();
+    EXPECT_EQ(bgzfEofMarker().size(), 28u);
+    EXPECT_EQ(gunzip(packed), text);
+
+    std::string empty;
+    bgzfCompress("", 0, empty);
+    EXPECT_TRUE(empty.empty());
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/block_cache.hpp"
+#include "test_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <oneapi/tbb/parallel_for.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 写一个 3 块的小 .gsc 文件
+    void writeArchive(const std::string &path)
+    {
+        std::vector<std::vector<std::string>> blocks(3);
+        for (int b = 0; b < 3; ++b)
+        {
+            for (int r = 0; r < 50; ++r)
+            {
+                int pos = b * 1000 + r * 10 + 1;
+                blocks[b].push_back("chr1\t" + std::to_string(pos) + "\t.\tA\tC\t.\tPASS\t.\tGT:DP\t0|1:" +
+                                    std::to_string(r) + "\t1|1:" + std::to_string(b));
+            }
+        }
+        writeTestArchive(path, testHeader({"A", "B"}), blocks);
+    }
+}
+
+TEST(BlockCache, SharedDecodeMatchesDirectRender)
+{
+    const TempFile file("block_cache_test.gsc");
+    writeArchive(file.path);
+    {
+        GscReader reader(file.path);
+        BlockCache cache(reader, 1);
+        const std::vector<uint32_t> onlyB = {1};
+        const std::vector<uint32_t> none;
+        const BlockCache::FieldSet all = BlockCache::fieldSet(nullptr);
+        const BlockCache::FieldSet subset = BlockCache::fieldSet(&onlyB);
+        EXPECT_NE(all.hash, subset.hash);
+        EXPECT_NE(BlockCache::fieldSet(&none).hash, all.hash);
+        EXPECT_EQ(BlockCache::fieldSet(&onlyB).hash, subset.hash);
+
+        // 多线程反复请求同几块，结果与直接渲染一致
+        std::vector<std::string> expected(3);
+        for (size_t b = 0; b < 3; ++b)
+        {
+            renderBlockVcf(reader.block(b), "chr1", 2, expected[b]);
+        }
+        tbb::parallel_for(0, 64,
+                          [&](int i)
+                          {
+                              auto block = cache.get(i % 3, all);
+                              EXPECT_EQ(block->text, expected[i % 3]);
+                          });
+
+        auto sub = cache.get(1, subset);
+        std::string trimmed;
+        const std::vector<PositionRange> ranges = {{1011, 1021}};
+        sub->appendRanges(&ranges, trimmed);
+        EXPECT_EQ(trimmed, "chr1\t1011\t.\tA\tC\t.\tPASS\t.\tGT:DP\t1|1:1\nchr1\t1021\t.\tA\tC\t.\tPASS\t.\tGT:DP\t1|1:1\n");
+    }
+}
+
+TEST(BlockCache, EvictsByBytes)
+{
+    const TempFile file("block_cache_test.gsc");
+    writeArchive(file.path);
+    {
+        GscReader reader(file.path);
+        const BlockCache::FieldSet all = BlockCache::fieldSet(nullptr);
+        size_t blockBytes = 0;
+        {
+            BlockCache unbounded(reader, SIZE_MAX);
+            for (size_t b = 0; b < 3; ++b)
+            {
+                blockBytes = std::max(blockBytes, unbounded.get(b, all)->bytes());
+            }
+            EXPECT_EQ(unbounded.entries(), 3u);
+        }
+
+        // 预算容得下两块：第三块挤出最久未用的块
+        BlockCache cache(reader, blockBytes * 2 + blockBytes / 2);
+        cache.get(0, all);
+        cache.get(1, all);
+        cache.get(0, all);
+        cache.get(2, all);
+        EXPECT_EQ(cache.entries(), 2u);
+        EXPECT_LE(cache.bytes(), blockBytes * 2 + blockBytes / 2);
+
+        // 每次查询不同的样本子集，旧子集的条目（连同字段集）按字节淘汰，不会累积
+        const std::vector<std::vector<uint32_t>> subsets = {{0}, {1}, {1, 0}, {}};
+        for (size_t i = 0; i < 20; ++i)
+        {
+            EXPECT_FALSE(cache.get(i % 3, BlockCache::fieldSet(&subsets[i % subsets.size()]))->text.empty());
+        }
+        EXPECT_LE(cache.bytes(), blockBytes * 2 + blockBytes / 2);
+
+        // 大于预算的块照常返回，用后即淘汰
+        BlockCache tiny(reader, 1);
+        EXPECT_FALSE(tiny.get(0, all)->text.empty());
+        EXPECT_EQ(tiny.entries(), 0u);
+        EXPECT_EQ(tiny.bytes(), 0u);
+    }
+}
@@ -0,0 +1,316 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+#include "../src/fields.hpp"
+#include "../src/vcf.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 7 个样本，GT:DP:AD，第 2 行缺 GT，第 3 行第 5 个样本多一个字段
+    std::vector<std::string> makeLines()
+    {
+        std::vector<std::string> lines;
+        for (int r = 0; r < 4; ++r)
+        {
+            std::string line = "chr2\t" + std::to_string(1000 + r) + "\t.\tA\tG,T\t.\tPASS\t.\t";
+            line += r == 1 ? "DP:AD" : "GT:DP:AD";
+            for (int s = 0; s < 7; ++s)
+            {
+                line += '\t';
+                if (r != 1)
+                {
+                    line += std::to_string((r + s) % 3) + (s % 2 ? "/" : "|") + std::to_string(s % 2) + ":";
+                }
+                line += std::to_string(r * 7 + s) + ":" + std::to_string(s) + "," + std::to_string(r) + ",0";
+                if (r == 2 && s == 4)
+                {
+                    line += ":extra";
+                }
+            }
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    // 按 VCF 列挑出指定样本
+    std::string subsetLine(const std::string &line, const std::vector<uint32_t> &samples)
+    {
+        std::vector<std::string_view> cols;
+        splitView(line, '\t', cols);
+        std::string out;
+        for (size_t c = 0; c < 9; ++c)
+        {
+            out.append(cols[c].data(), cols[c].size());
+            out += c < 8 ? "\t" : "";
+        }
+        for (uint32_t s : samples)
+        {
+            out += '\t';
+            out.append(cols[9 + s].data(), cols[9 + s].size());
+        }
+        return out + "\n";
+    }
+}
+
+TEST(BlockSampleGroups, SubsetDecodesOnlySelectedGroups)
+{
+    const std::vector<std::string> lines = makeLines();
+    BlockParams params;
+    params.sampleGroupSize = 3;
+    EncodedBlock encoded = encodeBlock(lines, 7, params);
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    const SampleGroups groups = blockSampleGroups(view, 7);
+    EXPECT_EQ(groups.count(), 3u);
+    EXPECT_EQ(groups.size(2), 1u);
+    const SampleGroups uneven(std::vector<uint32_t>{2, 1, 2});
+    EXPECT_EQ(uneven.of(2), 1u);
+    EXPECT_EQ(uneven.of(3), 2u);
+    EXPECT_EQ(uneven.first(2), 3u);
+    EXPECT_TRUE(view.segment(0).has(groupStreamId(static_cast<uint32_t>(StreamId::Genotype), 2)));
+
+    std::string all;
+    renderBlockVcf(view, "chr2", 7, all);
+    std::string expected;
+    for (const auto &l : lines)
+    {
+        expected += l + "\n";
+    }
+    EXPECT_EQ(all, expected);
+
+    for (const std::vector<uint32_t> &samples :
+         {std::vector<uint32_t>{4}, std::vector<uint32_t>{0, 5, 6}, std::vector<uint32_t>{1, 2, 3, 4}})
+    {
+        RenderOptions options;
+        options.samples = &samples;
+        std::string text;
+        renderBlockVcf(view, "chr2", 7, options, text);
+        expected.clear();
+        for (const auto &l : lines)
+        {
+            expected += subsetLine(l, samples);
+        }
+        EXPECT_EQ(text, expected);
+    }
+}
+
+TEST(BlockSampleGroups, LoadVerifiesEachStream)
+{
+    BlockParams params;
+    params.sampleGroupSize = 3;
+    EncodedBlock encoded = encodeBlock(makeLines(), 7, params);
+    const BlockView clean(encoded.bytes.data(), encoded.bytes.size());
+    const uint32_t damagedId = groupStreamId(static_cast<uint32_t>(StreamId::Genotype), 2);
+    const SegmentView cleanSegment = clean.segment(0);
+    for (const StreamEntry &e : cleanSegment.streams())
+    {
+        if (e.id == damagedId)
+        {
+            encoded.bytes[clean.segments()[0].offset + e.offset] ^= 1;
+        }
+    }
+    // 只有损坏的那个流加载失败，其余组照常解码
+    const BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    EXPECT_THROW(view.segment(0).load(damagedId), std::runtime_error);
+    const std::vector<uint32_t> first = {0, 4};
+    RenderOptions options;
+    options.samples = &first;
+    std::string text;
+    EXPECT_NO_THROW(renderBlockVcf(view, "chr2", 7, options, text));
+}
+
+TEST(BlockSampleGroups, TooManyGroupsRaiseGroupSize)
+{
+    // 组号只有 16 位：70000 个样本、组大小 1 时组大小被加大到 2
+    const uint32_t nSamples = 70000;
+    std::vector<std::string> lines;
+    for (int r = 0; r < 2; ++r)
+    {
+        std::string line = "chr1\t" + std::to_string(100 + r) + "\t.\tA\tG\t.\tPASS\t.\tGT:DP";
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            line += "\t" + std::to_string((s + r) % 2) + "|" + std::to_string(s % 3 == 0) + ":" +
+                    std::to_string(s % 50);
+        }
+        lines.push_back(line);
+    }
+    BlockParams params;
+    params.sampleGroupSize = 1;
+    EncodedBlock encoded = encodeBlock(lines, nSamples, params);
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    const SampleGroups groups = blockSampleGroups(view, nSamples);
+    EXPECT_EQ(groups.count(), 35000u);
+    EXPECT_EQ(sampleGroupSize(nSamples, 1), 2u);
+
+    std::string all;
+    renderBlockVcf(view, "chr1", nSamples, all);
+    EXPECT_EQ(all, lines[0] + "\n" + lines[1] + "\n");
+    const std::vector<uint32_t> last = {nSamples - 1};
+    RenderOptions options;
+    options.samples = &last;
+    std::string text;
+    renderBlockVcf(view, "chr1", nSamples, options, text);
+    EXPECT_EQ(text, subsetLine(lines[0], last) + subsetLine(lines[1], last));
+}
+
+TEST(BlockCheckpoints, PointQueryDecodesOneSegment)
+{
+    std::vector<std::string> lines = makeLines();
+    for (int r = 0; r < 3; ++r)
+    {
+        std::vector<std::string> more = makeLines();
+        for (auto &l : more)
+        {
+            l.replace(5, 4, std::to_string(2000 + r * 10 + static_cast<int>(lines.size())));
+        }
+        lines.insert(lines.end(), more.begin(), more.end());
+    }
+    std::string expected;
+    for (const auto &l : lines)
+    {
+        expected += l + "\n";
+    }
+
+    BlockParams params;
+    params.checkpointRows = 5;
+    params.sampleGroupSize = 3;
+    EncodedBlock encoded = encodeBlock(lines, 7, params);
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    ASSERT_EQ(view.segments().size(), 4u);
+    EXPECT_EQ(view.rows(), 16u);
+    EXPECT_EQ(view.segments()[3].firstRow, 15u);
+    EXPECT_EQ(view.segments()[3].nRows, 1u);
+    EXPECT_EQ(view.segmentOfRow(9), 1u);
+    EXPECT_EQ(view.segmentOfRow(10), 2u);
+    EXPECT_THROW(view.segmentOfRow(16), std::runtime_error);
+    EXPECT_EQ(encoded.minPos, 1000);
+
+    std::string all;
+    renderBlockVcf(view, "chr2", 7, all);
+    EXPECT_EQ(all, expected);
+
+    // 跨段的行集合与单行查询
+    const std::vector<uint32_t> rows = {4, 5, 11};
+    RenderOptions options;
+    options.blockRows = &rows;
+    std::string picked;
+    renderBlockVcf(view, "chr2", 7, options, picked);
+    EXPECT_EQ(picked, lines[4] + "\n" + lines[5] + "\n" + lines[11] + "\n");
+
+    // 其他段（含流目录）的字节损坏不影响点查询，取到损坏的段时由流目录 hash 发现
+    std::vector<uint8_t> damaged = encoded.bytes;
+    std::fill_n(damaged.begin() + view.segments()[0].offset, view.segments()[0].size, 0xff);
+    BlockView damagedView(damaged.data(), damaged.size());
+    const std::vector<uint32_t> row = {11};
+    options.blockRows = &row;
+    std::string one;
+    renderBlockVcf(damagedView, "chr2", 7, options, one);
+    EXPECT_EQ(one, lines[11] + "\n");
+    EXPECT_THROW(damagedView.segment(0), std::runtime_error);
+
+    // 区间完全覆盖的段从段表计数
+    const std::vector<PositionRange> ranges = {{0, 1003}, {2000, 3000}};
+    RenderOptions counting;
+    counting.ranges = &ranges;
+    EXPECT_EQ(countBlockRows(view, 7, counting), 16u);
+
+    // 不切段时整块一段，内容相同
+    EncodedBlock whole = encodeBlock(lines, 7, BlockParams());
+    BlockView wholeView(whole.bytes.data(), whole.bytes.size());
+    EXPECT_EQ(wholeView.segments().size(), 1u);
+    std::string text;
+    renderBlockVcf(wholeView, "chr2", 7, text);
+    EXPECT_EQ(text, expected);
+}
+
+TEST(BlockSiteRanges, SitesOnlyNeverTouchesSampleStreams)
+{
+    std::vector<std::string> lines = makeLines();
+    lines.push_back("chr2\t1100\t.\tA\t<NON_REF>\t.\t.\tEND=1200\tGT:DP\t"
+                    "0/0:1\t0/0:2\t0/0:3\t0/0:4\t0/0:5\t0/0:6\t./.:0");
+    BlockParams params;
+    params.checkpointRows = 2;
+    params.sampleGroupSize = 3;
+    EncodedBlock encoded = encodeBlock(lines, 7, params);
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+
+    // 每段的站点流都排在样本流之前；样本流的字节全部改写，段表与流目录不变
+    std::vector<uint8_t> sitesOnly = encoded.bytes;
+    for (size_t i = 0; i < view.segments().size(); ++i)
+    {
+        const SegmentView segment = view.segment(i);
+        uint64_t siteEnd = 0;
+        uint64_t sampleBegin = view.segments()[i].size;
+        for (const StreamEntry &e : segment.streams())
+        {
+            if (isSampleStream(e.id))
+            {
+                sampleBegin = std::min(sampleBegin, e.offset);
+                std::fill_n(sitesOnly.begin() + view.segments()[i].offset + e.offset, e.size, 0xff);
+            }
+            else
+            {
+                siteEnd = std::max(siteEnd, e.offset + e.size);
+            }
+        }
+        EXPECT_LE(siteEnd, sampleBegin);
+    }
+
+    // 样本流的字节被破坏后，站点列仍完整还原
+    std::string expected;
+    for (const auto &l : lines)
+    {
+        size_t tab = 0;
+        for (int c = 0; c < 8; ++c)
+        {
+            tab = l.find('\t', tab + 1);
+        }
+        expected += l.substr(0, tab) + "\n";
+    }
+    const std::vector<uint32_t> none;
+    RenderOptions options;
+    options.samples = &none;
+    std::string text;
+    renderBlockVcf(BlockView(sitesOnly.data(), sitesOnly.size()), "chr2", 7, options, text);
+    EXPECT_EQ(text, expected);
+}
+
+TEST(BlockFieldProjection, LoadsOnlyProjectedStreams)
+{
+    const std::vector<std::string> lines = makeLines();
+    BlockParams params;
+    params.sampleGroupSize = 3;
+    EncodedBlock encoded = encodeBlock(lines, 7, params);
+
+    // 破坏 GT 与除 POS/INFO 外的站点流：加载它们会因流 hash 不符而抛出异常
+    std::vector<uint8_t> bytes = encoded.bytes;
+    BlockView view(bytes.data(), bytes.size());
+    const SegmentView segment = view.segment(0);
+    for (const StreamEntry &e : segment.streams())
+    {
+        const uint32_t id = e.id & 0xffff;
+        if (id == static_cast<uint32_t>(StreamId::Genotype) || id == static_cast<uint32_t>(StreamId::Ref) ||
+            id == static_cast<uint32_t>(StreamId::Alt) || id == static_cast<uint32_t>(StreamId::Id))
+        {
+            bytes[view.segments()[0].offset + e.offset] ^= 0xff;
+        }
+    }
+
+    const FieldProjection fields = FieldProjection::parse("POS,INFO,FORMAT/AD", false);
+    const std::vector<uint32_t> samples = {1, 4};
+    RenderOptions options;
+    options.fields = &fields;
+    options.samples = &samples;
+    std::string text;
+    renderBlockVcf(view, "chr2", 7, options, text);
+    EXPECT_EQ(text.substr(0, text.find('\n')), "chr2\t1000\t.\t.\t.\t.\t.\t.\tAD\t1,0,0\t4,0,0");
+    // 第 3 行样本 4 多一个字段，AD 仍在原位置
+    EXPECT_NE(text.find("chr2\t1002\t.\t.\t.\t.\t.\t.\tAD\t1,2,0\t4,2,0\n"), std::string::npos);
+
+    const FieldProjection table = FieldProjection::parse("POS,INFO/AD,GT", true);
+    std::string tsv;
+    options.fields = &table;
+    EXPECT_THROW(renderBlockVcf(view, "chr2", 7, options, tsv), std::runtime_error);
+}
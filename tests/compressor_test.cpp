@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "../src/compressor.hpp"
+#include "test_util.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+TEST(Compressor, BadRecordLeavesNoOutput)
+{
+    const TempFile vcf("compressor_test.vcf");
+    const TempFile out("compressor_test.gsc");
+    {
+        std::ofstream file(vcf.path);
+        file << "##fileformat=VCFv4.2\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tS1\tS2\n";
+        for (int r = 0; r < 40; ++r)
+        {
+            file << "chr1\t" << (r + 1) * 10 << "\t.\tA\tG\t30\tPASS\t.\tGT\t0|1\t1|1\n";
+        }
+        // 少一个样本列
+        file << "chr1\t500\t.\tA\tG\t30\tPASS\t.\tGT\t0|1\n";
+    }
+    CompressOptions options;
+    options.blockSize = 8; // 出错前已有块写出
+
+    EXPECT_THROW(compressVcfFile(vcf.path, out.path, options), std::runtime_error);
+    EXPECT_FALSE(std::filesystem::exists(out.path));
+    EXPECT_FALSE(std::filesystem::exists(out.path + ".tmp"));
+
+    // 去掉坏行后正常写出，且不留临时文件
+    {
+        std::ofstream file(vcf.path);
+        file << "##fileformat=VCFv4.2\n#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\tS1\tS2\n";
+        file << "chr1\t10\t.\tA\tG\t30\tPASS\t.\tGT\t0|1\t1|1\n";
+    }
+    compressVcfFile(vcf.path, out.path, options);
+    EXPECT_TRUE(std::filesystem::exists(out.path));
+    EXPECT_FALSE(std::filesystem::exists(out.path + ".tmp"));
+    GscReader reader(out.path);
+    EXPECT_EQ(reader.index().blocks.size(), 1u);
+}
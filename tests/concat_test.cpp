@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/concat.hpp"
+#include "../src/region.hpp"
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<std::string> chromLines(const std::string &chrom, int first, int count, const std::string &filter)
+    {
+        std::vector<std::string> lines;
+        for (int r = first; r < first + count; ++r)
+        {
+            lines.push_back(chrom + "\t" + std::to_string(r * 10 + 1) + "\t" + chrom + "_" + std::to_string(r) +
+                            "\tA\tC\t30\t" + (r % 3 ? "PASS" : filter) + "\t.\tGT\t0|1\t1|1");
+        }
+        return lines;
+    }
+
+    void writeArchive(const std::string &path, const std::vector<std::vector<std::string>> &blocks,
+                      const std::string &meta = "##INFO=<ID=DP,Number=1,Type=Integer,Description=\"Depth\">",
+                      const std::vector<std::string> &samples = {"S1", "S2"})
+    {
+        BlockParams params;
+        params.collectIds = true;
+        writeTestArchive(path, testHeader(samples, {"##fileformat=VCFv4.2", meta, "##source=" + path}), blocks,
+                         params);
+    }
+
+    std::string records(const GscReader &reader, const std::string &region)
+    {
+        std::string out;
+        reader.query(parseRegion(region), nullptr, out);
+        return out;
+    }
+}
+
+TEST(Concat, CopiesBlocksAndMergesIndex)
+{
+    const auto a1 = chromLines("chr1", 0, 20, "q10");
+    const auto a2 = chromLines("chr1", 20, 20, "q10");
+    const auto b1 = chromLines("chr1", 40, 20, "lowGQ");
+    const auto c1 = chromLines("chr2", 0, 30, "lowGQ");
+    const TempFile aFile("concat_a.gsc");
+    const TempFile bFile("concat_b.gsc");
+    const TempFile cFile("concat_c.gsc");
+    const TempFile abFile("concat_ab.gsc");
+    const TempFile fullFile("concat_full.gsc");
+    const TempFile xFile("concat_x.gsc");
+    writeArchive(aFile.path, {a1, a2});
+    writeArchive(bFile.path, {b1, c1});
+    writeArchive(fullFile.path, {a1, a2, b1, c1});
+
+    ConcatSummary summary = concatGsc({aFile.path, bFile.path}, abFile.path);
+    EXPECT_EQ(summary.blocks, 4u);
+    EXPECT_EQ(summary.records, 90u);
+    EXPECT_TRUE(summary.idIndex);
+
+    const GscReader reader(abFile.path);
+    const GscReader full(fullFile.path);
+    EXPECT_NE(reader.headerText().find("##source=" + bFile.path + "\n"), std::string::npos);
+    EXPECT_EQ(records(reader, "chr1"), records(full, "chr1"));
+    EXPECT_EQ(records(reader, "chr2:50-150"), records(full, "chr2:50-150"));
+    ASSERT_EQ(reader.index().chromSummaries.size(), 2u);
+    EXPECT_EQ(reader.index().chromSummaries[0].records, 60u);
+    // FILTER 位按本文件的名表重新映射
+    for (size_t b = 0; b < reader.blockCount(); ++b)
+    {
+        EXPECT_EQ(reader.index().blocks[b].hash, full.index().blocks[b].hash);
+        EXPECT_EQ(reader.index().blocks[b].zone.filterMask, full.index().blocks[b].zone.filterMask);
+    }
+    ASSERT_EQ(reader.findId("chr2_7").size(), 1u);
+    EXPECT_EQ(reader.findId("chr2_7")[0].block, 3u);
+
+    // 同一染色体 POS 回退、样本不一致、INFO 定义不一致、输出与输入相同
+    EXPECT_THROW(concatGsc({bFile.path, aFile.path}, xFile.path), std::runtime_error);
+    EXPECT_THROW(concatGsc({aFile.path, aFile.path}, xFile.path), std::runtime_error);
+    writeArchive(cFile.path, {c1}, "##INFO=<ID=DP,Number=1,Type=Integer,Description=\"Depth\">", {"S1", "S3"});
+    EXPECT_THROW(concatGsc({aFile.path, cFile.path}, xFile.path), std::runtime_error);
+    writeArchive(cFile.path, {c1}, "##INFO=<ID=DP,Number=1,Type=Float,Description=\"Depth\">");
+    EXPECT_THROW(concatGsc({aFile.path, cFile.path}, xFile.path), std::runtime_error);
+    EXPECT_THROW(concatGsc({aFile.path, bFile.path}, aFile.path), std::runtime_error);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/count.hpp"
+#include "../src/region.hpp"
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(Count, IndexOnlyExceptEdgeBlocks)
+{
+    const TempFile file("count_test.gsc");
+    // chr1：10 块，每块 10 行，POS = 1..1000 每 10 个一行
+    std::vector<std::vector<std::string>> blocks(10);
+    for (int b = 0; b < 10; ++b)
+    {
+        for (int r = 0; r < 10; ++r)
+        {
+            int pos = (b * 10 + r) * 10 + 1;
+            blocks[b].push_back("chr1\t" + std::to_string(pos) + "\t.\tA\tG\t" + std::to_string(pos) +
+                                "\tPASS\t.\tGT\t0|1");
+        }
+    }
+    blocks.push_back({"chr2\t5\t.\tA\tC\t1\tPASS\t.\tGT\t1|1"});
+    writeTestArchive(file.path, testHeader({"S1"}), blocks);
+
+    GscReader reader(file.path);
+    const GscIndex &index = reader.index();
+    ASSERT_EQ(index.chromSummaries.size(), 2u);
+    EXPECT_EQ(index.chromSummaries[0].records, 100u);
+    EXPECT_EQ(index.chromSummaries[0].blocks, 10u);
+    EXPECT_EQ(index.chromSummaries[0].minPos, 1);
+    EXPECT_EQ(index.chromSummaries[0].maxPos, 991);
+    EXPECT_EQ(index.chromSummaries[1].records, 1u);
+
+    const WhereFilter none;
+    RegionCount whole = countRegion(reader, parseRegion("chr1"), none);
+    EXPECT_EQ(whole.records, 100u);
+    EXPECT_EQ(whole.decodedBlocks, 0u);
+
+    // 151..651：块 1 与块 6 被切开，块 2..5 整块计入
+    RegionCount cut = countRegion(reader, parseRegion("chr1:151-651"), none);
+    EXPECT_EQ(cut.records, 51u);
+    EXPECT_EQ(cut.decodedBlocks, 2u);
+
+    // 块边界对齐时不解码
+    RegionCount aligned = countRegion(reader, parseRegion("chr1:101-400"), none);
+    EXPECT_EQ(aligned.records, 30u);
+    EXPECT_EQ(aligned.decodedBlocks, 0u);
+
+    // where 由块摘要排除 QUAL 不可能满足的块
+    RegionCount filtered = countRegion(reader, parseRegion("chr1"), WhereFilter::parse("QUAL>900"));
+    EXPECT_EQ(filtered.records, 10u);
+    EXPECT_EQ(filtered.decodedBlocks, 1u);
+
+    EXPECT_EQ(countRegion(reader, parseRegion("chr3"), none).records, 0u);
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include "../src/format_matrix.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    // cells[r][s] 为空指针表示该格无此键
+    std::vector<std::vector<std::string>> roundTrip(const std::vector<std::vector<const char *>> &cells, bool expectInt)
+    {
+        const uint32_t nRows = static_cast<uint32_t>(cells.size());
+        const uint32_t nSamples = static_cast<uint32_t>(cells[0].size());
+        FormatKeyEncoder enc(nSamples);
+        for (uint32_t r = 0; r < nRows; ++r)
+        {
+            for (uint32_t s = 0; s < nSamples; ++s)
+            {
+                if (cells[r][s])
+                {
+                    enc.add(r, s, cells[r][s]);
+                }
+            }
+        }
+        EXPECT_EQ(enc.isInteger(), expectInt);
+        FormatKeyDecoder dec(enc.finish(nRows), nRows, nSamples);
+        EXPECT_EQ(dec.isInteger(), expectInt);
+        std::vector<std::vector<std::string>> out(nRows);
+        for (uint32_t r = 0; r < nRows; ++r)
+        {
+            for (uint32_t s = 0; s < nSamples; ++s)
+            {
+                std::string v;
+                dec.appendValue(r, s, v);
+                out[r].push_back(v);
+            }
+        }
+        return out;
+    }
+
+    std::vector<std::vector<std::string>> expected(const std::vector<std::vector<const char *>> &cells)
+    {
+        std::vector<std::vector<std::string>> out;
+        for (const auto &row : cells)
+        {
+            out.emplace_back();
+            for (const char *c : row)
+            {
+                out.back().push_back(c ? c : "");
+            }
+        }
+        return out;
+    }
+}
+
+TEST(FormatMatrix, IntegerVectorsWithMissingAndAbsent)
+{
+    std::vector<std::vector<const char *>> cells = {
+        {"10,2", "0,0", ".", "-3,7,8", nullptr},
+        {"11,2", "1,.", "5,5", nullptr, "0,1"},
+        {nullptr, nullptr, nullptr, nullptr, nullptr},
+        {"12,3", "2,0", "6,5", "-1,2", "0,0"},
+    };
+    EXPECT_EQ(roundTrip(cells, true), expected(cells));
+}
+
+TEST(FormatMatrix, LargeMatrixAcrossTiles)
+{
+    std::vector<std::string> storage;
+    storage.reserve(300 * 200);
+    std::vector<std::vector<const char *>> cells(300, std::vector<const char *>(200, nullptr));
+    for (uint32_t r = 0; r < 300; ++r)
+    {
+        for (uint32_t s = 0; s < 200; ++s)
+        {
+            if ((r * 7 + s) % 31 == 0)
+            {
+                continue;
+            }
+            storage.push_back(std::to_string(r + s % 5) + "," + std::to_string((r * s) % 97));
+            cells[r][s] = storage.back().c_str();
+        }
+    }
+    EXPECT_EQ(roundTrip(cells, true), expected(cells));
+}
+
+TEST(FormatMatrix, NonCanonicalValuesFallBackToText)
+{
+    std::vector<std::vector<const char *>> cells = {
+        {"1", "2", "3"},
+        {"4", "05", "0.5"},
+        {"", "-0", nullptr},
+    };
+    EXPECT_EQ(roundTrip(cells, false), expected(cells));
+}
@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+
+#include "../src/genotype.hpp"
+#include "../src/itoa.hpp"
+#include "../src/transpose.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 编码若干行 GT 文本后逐行还原
+    std::vector<std::vector<std::string>> roundTrip(const std::vector<std::vector<std::string>> &rows, uint32_t nSamples,
+                                                    GenotypeDecoder **keep = nullptr,
+                                                    GenotypeLayout layout = GenotypeLayout::VariantMajor)
+    {
+        GenotypeEncoder enc(nSamples);
+        for (const auto &row : rows)
+        {
+            enc.beginRow(!row.empty());
+            for (const auto &gt : row)
+            {
+                enc.addGenotype(gt);
+            }
+        }
+        GenotypeDecoder dec(enc.finish(layout));
+        std::vector<std::vector<std::string>> out;
+        GenotypeRow gtRow;
+        for (uint32_t r = 0; r < dec.rows(); ++r)
+        {
+            out.emplace_back();
+            if (!dec.hasGt(r))
+            {
+                continue;
+            }
+            dec.decodeRow(r, gtRow);
+            for (uint32_t s = 0; s < nSamples; ++s)
+            {
+                // 按块特化的输出与通用路径一致
+                std::string text;
+                std::string generic;
+                dec.appender()(gtRow, s, text);
+                appendGenotype(gtRow, s, dec.ploidy(), generic);
+                EXPECT_EQ(text, generic);
+                out.back().push_back(text);
+            }
+        }
+        if (keep)
+        {
+            *keep = new GenotypeDecoder(std::move(dec));
+        }
+        return out;
+    }
+}
+
+TEST(GenotypeCodec, MixedColumnRoundTrip)
+{
+    std::vector<std::vector<std::string>> rows = {
+        {"0|1", "0/1", "./.", "1", ".|0"},
+        {"0|0", "1|1", "0|0", "0", "0|0"},
+        {},
+        {"2|3", "0/1|2", "", "1|.", "10|0"},
+        {"0|1|2", "0|0", "1|1", ".", "0/0"},
+    };
+    EXPECT_EQ(roundTrip(rows, 5), rows);
+}
+
+TEST(GenotypeCodec, CommonCaseHasNoSideChannels)
+{
+    std::vector<std::vector<std::string>> rows(64, std::vector<std::string>(130, "0|1"));
+    rows[3][7] = "1|1";
+    GenotypeDecoder *dec = nullptr;
+    EXPECT_EQ(roundTrip(rows, 130, &dec), rows);
+    ASSERT_NE(dec, nullptr);
+    EXPECT_EQ(dec->ploidy(), 2);
+    EXPECT_EQ(dec->alleleBits(), 1);
+    EXPECT_TRUE(dec->defaultPhased());
+    delete dec;
+}
+
+TEST(GenotypeCodec, UnphasedMajorityAndHaploidRows)
+{
+    std::vector<std::vector<std::string>> rows = {
+        {"0/1", "1/1", "0|1", "0"},
+        {"0/0", "./.", "1", "1"},
+    };
+    GenotypeDecoder *dec = nullptr;
+    EXPECT_EQ(roundTrip(rows, 4, &dec), rows);
+    EXPECT_FALSE(dec->defaultPhased());
+    delete dec;
+}
+
+TEST(GenotypeCodec, Transpose64)
+{
+    uint64_t a[64];
+    uint64_t b[64];
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+    for (int i = 0; i < 64; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        a[i] = b[i] = x;
+    }
+    transpose64(b);
+    for (int i = 0; i < 64; ++i)
+    {
+        for (int j = 0; j < 64; ++j)
+        {
+            ASSERT_EQ((a[i] >> j) & 1, (b[j] >> i) & 1);
+        }
+    }
+}
+
+TEST(GenotypeCodec, SampleMajorRowsAndColumns)
+{
+    // 行数、槽位数都不是 64 的倍数，覆盖补齐部分
+    const uint32_t nSamples = 45;
+    std::vector<std::vector<std::string>> rows;
+    for (uint32_t r = 0; r < 150; ++r)
+    {
+        rows.emplace_back();
+        if (r % 37 == 5)
+        {
+            continue;
+        }
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            uint32_t v = (r * 7 + s * 13) % 11;
+            std::string gt = std::to_string(v % 4) + (v == 3 ? "/" : "|") + std::to_string(v % 3);
+            if (v == 10)
+            {
+                gt = "./1";
+            }
+            else if (v == 9 && s % 2)
+            {
+                gt = "2";
+            }
+            else if (r == 77 && s == 3)
+            {
+                gt = "0/1|2";
+            }
+            rows.back().push_back(gt);
+        }
+    }
+    GenotypeDecoder *dec = nullptr;
+    EXPECT_EQ(roundTrip(rows, nSamples, &dec, GenotypeLayout::SampleMajor), rows);
+    ASSERT_NE(dec, nullptr);
+    EXPECT_EQ(dec->layout(), GenotypeLayout::SampleMajor);
+
+    // 按样本提取与按行解码一致
+    GenotypeRow row;
+    GenotypeColumn col;
+    for (uint32_t s : {0u, 3u, 44u})
+    {
+        dec->decodeSample(s, col);
+        for (uint32_t r = 0; r < dec->rows(); ++r)
+        {
+            if (!dec->hasGt(r))
+            {
+                continue;
+            }
+            dec->decodeRow(r, row);
+            ASSERT_EQ(col.ploidy[r], row.ploidy[s]);
+            ASSERT_EQ(col.phased[r], row.phased[s]);
+            for (uint8_t k = 0; k < row.ploidy[s]; ++k)
+            {
+                ASSERT_EQ(col.alleles[r * dec->ploidy() + k], row.alleles[s * dec->ploidy() + k]);
+            }
+        }
+        EXPECT_EQ(col.ploidy[77] == 0, s == 3);
+    }
+    delete dec;
+}
+
+TEST(GenotypeCodec, RowTextFromTokenTables)
+{
+    // 9 个样本跨越 3 个平面字节；含缺失、相位例外、单倍体、非常规文本与多等位行
+    const std::vector<std::vector<std::string>> rows = {
+        {"0|0", "0|1", "1|0", "1|1", "0|0", "1|1", "0|1", "0|0", "1|0"},
+        {"0|0", "0/1", ".|.", "1", "0|0", "1|.", "0|1", "0|0", "1|0"},
+        {"0|2", "3|1", "1|0", "1|1", "0|0", "1|1", "0|1", "0|0", "7|0"},
+        {"0|0", "0|1", "1|0", "1|1", "0|0", "1|1", "0|1", "0|0", "1|0"},
+        {"0/0", "0/1", "1/0", "1/1", "0/1|2", "1|1", "0/1", "0/0", "1/0"},
+    };
+    for (GenotypeLayout layout : {GenotypeLayout::VariantMajor, GenotypeLayout::SampleMajor})
+    {
+        GenotypeEncoder enc(9);
+        for (const auto &row : rows)
+        {
+            enc.beginRow(true);
+            for (const auto &gt : row)
+            {
+                enc.addGenotype(gt);
+            }
+        }
+        GenotypeDecoder dec(enc.finish(layout));
+        for (uint32_t r = 0; r < rows.size(); ++r)
+        {
+            std::string expected;
+            for (const auto &gt : rows[r])
+            {
+                expected += '\t' + gt;
+            }
+            std::string out = "x";
+            ASSERT_TRUE(dec.appendRowText(r, out));
+            EXPECT_EQ(out, "x" + expected) << "row " << r;
+        }
+    }
+
+    GenotypeEncoder haploid(10);
+    haploid.beginRow(true);
+    for (const char *gt : {"0", "1", "1", "0", "0", "0", "1", "1", "1", "."})
+    {
+        haploid.addGenotype(gt);
+    }
+    GenotypeDecoder dec(haploid.finish());
+    std::string out;
+    ASSERT_TRUE(dec.appendRowText(0, out));
+    EXPECT_EQ(out, "\t0\t1\t1\t0\t0\t0\t1\t1\t1\t.");
+}
+
+TEST(GenotypeCodec, AppendDecimal)
+{
+    for (uint64_t v : {0ull, 7ull, 9ull, 10ull, 99ull, 100ull, 12345ull, 999999999ull, 1000000000ull,
+                       18446744073709551615ull})
+    {
+        std::string out = "p";
+        appendUnsigned(v, out);
+        EXPECT_EQ(out, "p" + std::to_string(v));
+    }
+    std::string out;
+    appendSigned(-42, out);
+    appendSigned(INT64_MIN, out);
+    EXPECT_EQ(out, "-42" + std::to_string(INT64_MIN));
+}
+
+TEST(IndexSet, DenseAndSparseRoundTrip)
+{
+    for (uint64_t step : {1u, 3u, 1000u})
+    {
+        std::vector<uint64_t> items;
+        for (uint64_t v = 5; v < 5000; v += step)
+        {
+            items.push_back(v);
+        }
+        ByteWriter w;
+        IndexSet(items, 5000).write(w);
+        ByteReader r(w.data);
+        IndexSet s = IndexSet::read(r);
+        EXPECT_EQ(s.size(), items.size());
+        std::vector<uint64_t> got;
+        s.forEachInRange(0, 5000, [&](uint64_t v) { got.push_back(v); });
+        EXPECT_EQ(got, items);
+        EXPECT_TRUE(s.contains(5));
+        EXPECT_FALSE(s.contains(4));
+    }
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+#include "../src/gvcf.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    const std::vector<std::string> kLines = {
+        "chr1\t1\t.\tA\t<NON_REF>\t.\t.\tEND=100\tGT:DP:GQ:MIN_DP:PL\t0/0:20:60:18:0,60,600",
+        "chr1\t101\t.\tC\tT,<NON_REF>\t50.2\t.\tDP=12\tGT:AD:DP:GQ:PL\t0/1:6,6,0:12:40:40,0,40,90,90,180",
+        "chr1\t102\t.\tG\t<NON_REF>\t.\t.\tEND=2000\tGT:DP:GQ:MIN_DP:PL\t0/0:31:99:25:0,99,990",
+        "chr1\t2001\t.\tT\t<*>\t.\t.\tEND=2001\tGT:DP:GQ:MIN_DP:PL\t0/0:.:.:.:.",
+        "chr1\t2002\t.\tA\t<NON_REF>\t.\t.\tEND=02005\tGT:DP:GQ:MIN_DP:PL\t0/0:3:0:1:0,0,0",
+    };
+
+    std::string joined()
+    {
+        std::string text;
+        for (const auto &l : kLines)
+        {
+            text += l + "\n";
+        }
+        return text;
+    }
+}
+
+TEST(GvcfRefBlocks, Detection)
+{
+    int64_t end = 0;
+    uint8_t code = 0;
+    EXPECT_TRUE(parseRefBlock("<NON_REF>", "END=100", 1, end, code));
+    EXPECT_EQ(end, 100);
+    EXPECT_TRUE(parseRefBlock("<*>", "END=5", 5, end, code));
+    EXPECT_EQ(refBlockAlt(code), "<*>");
+    EXPECT_FALSE(parseRefBlock("T,<NON_REF>", "END=100", 1, end, code));
+    EXPECT_FALSE(parseRefBlock("<NON_REF>", "END=100;DP=3", 1, end, code));
+    EXPECT_FALSE(parseRefBlock("<NON_REF>", "END=0100", 1, end, code));
+    EXPECT_FALSE(parseRefBlock("<NON_REF>", "END=4", 5, end, code));
+}
+
+TEST(GvcfRefBlocks, BlockRoundTripAndCoverageTrack)
+{
+    BlockParams params;
+    EncodedBlock encoded = encodeBlock(kLines, 1, params);
+    EXPECT_EQ(encoded.minPos, 1);
+    EXPECT_EQ(encoded.maxPos, 2002);
+
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    EXPECT_TRUE(view.segment(0).has(StreamId::RefBlockRows));
+    std::string text;
+    renderBlockVcf(view, "chr1", 1, text);
+    EXPECT_EQ(text, joined());
+
+    // 最后一行 END 写法不规范，按普通变异行保存
+    std::vector<RefBlockRecord> track = decodeRefBlocks(view, 1);
+    ASSERT_EQ(track.size(), 3u);
+    EXPECT_EQ(track[0].start, 1);
+    EXPECT_EQ(track[0].end, 100);
+    EXPECT_EQ(track[0].minDp, 18);
+    EXPECT_EQ(track[0].gq, 60);
+    EXPECT_EQ(track[1].start, 102);
+    EXPECT_EQ(track[1].end, 2000);
+    EXPECT_EQ(track[1].minDp, 25);
+    EXPECT_EQ(track[1].gq, 99);
+    EXPECT_EQ(track[2].minDp, -1);
+    EXPECT_EQ(track[2].gq, -1);
+}
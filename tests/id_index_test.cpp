@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "../src/id_index.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(IdIndex, SplitsMultiIdColumns)
+{
+    std::vector<std::string> ids;
+    forEachId("rs1;rs2;;COSM3", [&](std::string_view id) { ids.emplace_back(id); });
+    EXPECT_EQ(ids, (std::vector<std::string>{"rs1", "rs2", "COSM3"}));
+    ids.clear();
+    forEachId(".", [&](std::string_view id) { ids.emplace_back(id); });
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(IdIndex, LookupAcrossBuckets)
+{
+    IdIndexBuilder builder;
+    for (uint32_t i = 0; i < 5000; ++i)
+    {
+        builder.add(idHash("rs" + std::to_string(i)), i / 100, i % 100);
+    }
+    // 同一 ID 出现在两处
+    builder.add(idHash("rs42"), 77, 3);
+    std::vector<uint8_t> bytes = builder.finish();
+    IdIndexView view(bytes.data(), bytes.size());
+    ASSERT_TRUE(view.valid());
+
+    for (uint32_t i : {0u, 1u, 999u, 4999u})
+    {
+        std::vector<IdLocation> hits = view.find("rs" + std::to_string(i));
+        ASSERT_EQ(hits.size(), 1u);
+        EXPECT_EQ(hits[0].block, i / 100);
+        EXPECT_EQ(hits[0].row, i % 100);
+    }
+    std::vector<IdLocation> twice = view.find("rs42");
+    ASSERT_EQ(twice.size(), 2u);
+    EXPECT_EQ(twice[1].block, 77u);
+    EXPECT_TRUE(view.find("rs5000").empty());
+    EXPECT_THROW(IdIndexView(bytes.data(), 20), std::runtime_error);
+}
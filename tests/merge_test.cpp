@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/merge.hpp"
+#include "../src/region.hpp"
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    // 行的前 9 列与 cells 中 [first, last) 列的样本
+    std::string sliceLine(const std::string &sites, const std::vector<std::string> &cells, size_t first, size_t last)
+    {
+        std::string line = sites;
+        for (size_t s = first; s < last; ++s)
+        {
+            line += "\t" + cells[s];
+        }
+        return line;
+    }
+
+    void writeArchive(const std::string &path, const std::vector<std::string> &samples,
+                      const std::vector<std::string> &lines, const std::string &extraMeta = "")
+    {
+        std::vector<std::string> meta = {"##fileformat=VCFv4.2",
+                                         "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"GT\">"};
+        if (!extraMeta.empty())
+        {
+            meta.push_back(extraMeta);
+        }
+        BlockParams params;
+        params.checkpointRows = 4;
+        params.sampleGroupSize = 2;
+        writeTestArchive(path, testHeader(samples, meta), {lines}, params);
+    }
+
+    std::string records(const std::string &path)
+    {
+        std::string out;
+        GscReader(path).query(parseRegion("chr1"), nullptr, out);
+        return out;
+    }
+}
+
+TEST(MergeSamples, ConcatenatesAlignedBlocksByColumn)
+{
+    const TempFile aFile("merge_a.gsc");
+    const TempFile bFile("merge_b.gsc");
+    const TempFile abFile("merge_ab.gsc");
+    const TempFile fullFile("merge_full.gsc");
+    const std::vector<std::string> names = {"A", "B", "C", "D", "E"};
+    std::vector<std::string> full;
+    std::vector<std::string> left;
+    std::vector<std::string> right;
+    for (int r = 0; r < 10; ++r)
+    {
+        const std::string sites = "chr1\t" + std::to_string(100 + r * 10) + "\trs" + std::to_string(r) +
+                                  "\tA\tG\t50\tPASS\tDP=" + std::to_string(r) + "\tGT:DP";
+        std::vector<std::string> cells;
+        for (int s = 0; s < 5; ++s)
+        {
+            // 个别样本格多一个字段，检验样本格形状的格号换算
+            const std::string extra = r == 3 && s == 4 ? ":9" : "";
+            cells.push_back(std::to_string((r + s) % 2) + "|1:" + std::to_string(r * s) + extra);
+        }
+        full.push_back(sliceLine(sites, cells, 0, 5));
+        left.push_back(sliceLine(sites, cells, 0, 3));
+        right.push_back(sliceLine(sites, cells, 3, 5));
+    }
+    writeArchive(fullFile.path, names, full);
+    writeArchive(aFile.path, {"A", "B", "C"}, left);
+    writeArchive(bFile.path, {"D", "E"}, right, "##source=b");
+
+    MergeSummary summary = mergeSamples({aFile.path, bFile.path}, abFile.path, MergeOptions());
+    EXPECT_EQ(summary.copiedBlocks, 1u);
+    EXPECT_EQ(summary.mergedRows, 0u);
+    EXPECT_EQ(summary.records, 10u);
+
+    const GscReader reader(abFile.path);
+    EXPECT_EQ(reader.samples(), names);
+    EXPECT_NE(reader.headerText().find("##source=b\n"), std::string::npos);
+    // 样本组为 2+1+2，列号按不等长的组定位
+    EXPECT_EQ(blockSampleGroups(reader.block(0).segment(0), 5).size(1), 1u);
+    EXPECT_EQ(records(abFile.path), records(fullFile.path));
+    EXPECT_EQ(reader.index().blocks[0].minPos, 100);
+    EXPECT_EQ(reader.index().blocks[0].maxPos, 190);
+}
+
+TEST(MergeSamples, AlignsRowsAndFillsMissing)
+{
+    const TempFile aFile("merge_a.gsc");
+    const TempFile bFile("merge_b.gsc");
+    const TempFile abFile("merge_ab.gsc");
+    const TempFile aaFile("merge_aa.gsc");
+    writeArchive(aFile.path, {"A", "B"},
+                 {"chr1\t100\trs1\tA\tG\t50\tPASS\t.\tGT:DP\t0|1:3\t1|1:4",
+                  "chr1\t200\trs2\tC\tT\t50\tPASS\t.\tGT\t0|0\t0|1"});
+    writeArchive(bFile.path, {"C"},
+                 {"chr1\t100\trs1\tA\tG\t50\tPASS\t.\tGT:GQ\t1|0:20",
+                  "chr1\t150\trs9\tG\tC\t30\tq10\t.\tGT\t1|1",
+                  "chr1\t200\trs2\tC\tA\t50\tPASS\t.\tGT\t0|1"});
+
+    MergeSummary summary = mergeSamples({aFile.path, bFile.path}, abFile.path, MergeOptions());
+    EXPECT_EQ(summary.copiedBlocks, 0u);
+    EXPECT_EQ(summary.mergedRows, 4u);
+    EXPECT_EQ(records(abFile.path), "chr1\t100\trs1\tA\tG\t50\tPASS\t.\tGT:DP:GQ\t0|1:3:.\t1|1:4:.\t1|0:.:20\n"
+                                    "chr1\t150\trs9\tG\tC\t30\tq10\t.\tGT\t./.\t./.\t1|1\n"
+                                    "chr1\t200\trs2\tC\tT\t50\tPASS\t.\tGT\t0|0\t0|1\t./.\n"
+                                    "chr1\t200\trs2\tC\tA\t50\tPASS\t.\tGT\t./.\t./.\t0|1\n");
+
+    EXPECT_THROW(mergeSamples({aFile.path, aFile.path}, aaFile.path, MergeOptions()), std::runtime_error);
+    EXPECT_THROW(mergeSamples({aFile.path}, aaFile.path, MergeOptions()), std::runtime_error);
+    EXPECT_THROW(mergeSamples({aFile.path, bFile.path}, aFile.path, MergeOptions()), std::runtime_error);
+}
+
+TEST(MergeSamples, SamePosKeepsInputRowOrder)
+{
+    const TempFile aFile("merge_a.gsc");
+    const TempFile bFile("merge_b.gsc");
+    const TempFile abFile("merge_ab.gsc");
+    // A 只有同一 POS 上的第二个变异；输出仍按 B 中的行序，rs1161 在前
+    writeArchive(aFile.path, {"A"},
+                 {"chr1\t1000\trs1162\tA\tT\t50\tPASS\t.\tGT\t0|1",
+                  "chr1\t2000\trs2\tC\tT\t50\tPASS\t.\tGT\t1|1"});
+    writeArchive(bFile.path, {"B"},
+                 {"chr1\t1000\trs1161\tA\tG\t50\tPASS\t.\tGT\t1|0",
+                  "chr1\t1000\trs1162\tA\tT\t50\tPASS\t.\tGT\t0|0",
+                  "chr1\t2000\trs2\tC\tT\t50\tPASS\t.\tGT\t0|1"});
+
+    MergeSummary summary = mergeSamples({aFile.path, bFile.path}, abFile.path, MergeOptions());
+    EXPECT_EQ(summary.mergedRows, 3u);
+    EXPECT_EQ(records(abFile.path), "chr1\t1000\trs1161\tA\tG\t50\tPASS\t.\tGT\t./.\t1|0\n"
+                                    "chr1\t1000\trs1162\tA\tT\t50\tPASS\t.\tGT\t0|1\t0|0\n"
+                                    "chr1\t2000\trs2\tC\tT\t50\tPASS\t.\tGT\t1|1\t0|1\n");
+}
+
+namespace
+{
+    // 12 行、5 个样本；第 6 行为 gVCF 参考块。按样本拆为 A-C 与 D-E 两个输入，alter 改写右侧输入的行（返回 false 删去）
+    struct SplitRows
+    {
+        std::vector<std::string> left;
+        std::vector<std::string> right;
+        std::vector<std::string> sites;
+        std::vector<std::vector<std::string>> cells;
+    };
+
+    SplitRows splitRows()
+    {
+        SplitRows out;
+        for (int r = 0; r < 12; ++r)
+        {
+            const std::string pos = std::to_string(100 + r * 10);
+            const std::string sites = r == 6 ? "chr1\t" + pos + "\t.\tA\t<NON_REF>\t.\t.\tEND=165\tGT:DP"
+                                             : "chr1\t" + pos + "\trs" + std::to_string(r) + "\tA\tG\t50\tPASS\tDP=" +
+                                                   std::to_string(r) + "\tGT:DP";
+            std::vector<std::string> cells;
+            for (int s = 0; s < 5; ++s)
+            {
+                cells.push_back(std::to_string((r + s) % 2) + "|1:" + std::to_string(r * s));
+            }
+            out.sites.push_back(sites);
+            out.cells.push_back(cells);
+            out.left.push_back(sliceLine(sites, cells, 0, 3));
+            out.right.push_back(sliceLine(sites, cells, 3, 5));
+        }
+        return out;
+    }
+}
+
+TEST(MergeSamples, ResyncsSegmentsAfterMismatch)
+{
+    const TempFile aFile("merge_a.gsc");
+    const TempFile bFile("merge_b.gsc");
+    const TempFile abFile("merge_ab.gsc");
+    SplitRows rows = splitRows();
+    // 右侧第 5 行 ALT 不同：第 1 段逐行合并，其余段按列拼接
+    rows.right[5] = sliceLine("chr1\t150\trs5\tA\tT\t50\tPASS\tDP=5\tGT:DP", rows.cells[5], 3, 5);
+    writeArchive(aFile.path, {"A", "B", "C"}, rows.left);
+    writeArchive(bFile.path, {"D", "E"}, rows.right);
+
+    MergeSummary summary = mergeSamples({aFile.path, bFile.path}, abFile.path, MergeOptions());
+    EXPECT_EQ(summary.copiedBlocks, 0u);
+    EXPECT_EQ(summary.copiedSegments, 2u);
+    EXPECT_EQ(summary.mergedRows, 5u);
+    EXPECT_EQ(summary.records, 13u);
+
+    std::string expected;
+    for (size_t r = 0; r < 12; ++r)
+    {
+        std::vector<std::string> cells = rows.cells[r];
+        if (r == 5)
+        {
+            cells[3] = cells[4] = "./.";
+        }
+        expected += sliceLine(rows.sites[r], cells, 0, 5) + "\n";
+        if (r == 5)
+        {
+            expected += "chr1\t150\trs5\tA\tT\t50\tPASS\tDP=5\tGT:DP\t./.\t./.\t./.\t" + rows.cells[5][3] + "\t" +
+                        rows.cells[5][4] + "\n";
+        }
+    }
+    EXPECT_EQ(records(abFile.path), expected);
+    const GscReader reader(abFile.path);
+    ASSERT_EQ(reader.blockCount(), 1u);
+    EXPECT_EQ(reader.block(0).segments().size(), 3u);
+    EXPECT_EQ(reader.block(0).segments()[1].nRows, 5u);
+}
+
+TEST(MergeSamples, ReusesSiteStreamsOfCarrierSegment)
+{
+    const TempFile aFile("merge_a.gsc");
+    const TempFile bFile("merge_b.gsc");
+    const TempFile abFile("merge_ab.gsc");
+    SplitRows rows = splitRows();
+    // 右侧缺少第 5 行：之后右侧的段划分错开一行，各行站点都取自左侧，输出段与左侧的段一一对应
+    rows.right.erase(rows.right.begin() + 5);
+    writeArchive(aFile.path, {"A", "B", "C"}, rows.left);
+    writeArchive(bFile.path, {"D", "E"}, rows.right);
+
+    MergeSummary summary = mergeSamples({aFile.path, bFile.path}, abFile.path, MergeOptions());
+    EXPECT_EQ(summary.copiedSegments, 1u);
+    EXPECT_EQ(summary.mergedRows, 8u);
+
+    std::string expected;
+    for (size_t r = 0; r < 12; ++r)
+    {
+        std::vector<std::string> cells = rows.cells[r];
+        if (r == 5)
+        {
+            cells[3] = cells[4] = "./.";
+        }
+        expected += sliceLine(rows.sites[r], cells, 0, 5) + "\n";
+    }
+    EXPECT_EQ(records(abFile.path), expected);
+
+    const GscReader reader(abFile.path);
+    const GscReader left(aFile.path);
+    ASSERT_EQ(reader.block(0).segments().size(), 3u);
+    for (size_t i = 1; i < 3; ++i)
+    {
+        const SegmentView out = reader.block(0).segment(i);
+        const SegmentView in = left.block(0).segment(i);
+        for (StreamId id : {StreamId::Pos, StreamId::Id, StreamId::Info, StreamId::RefBlockRows, StreamId::RefInterval})
+        {
+            const uint32_t n = static_cast<uint32_t>(id);
+            ASSERT_EQ(out.has(n), in.has(n));
+            if (in.has(n))
+            {
+                EXPECT_EQ(out.entry(n).hash, in.entry(n).hash);
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+#include "../src/npy.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(Npy, HeaderIsAligned)
+{
+    std::string header = npyHeader("|i1", 3, 50);
+    EXPECT_EQ(header.size() % 64, 0u);
+    EXPECT_EQ(header.substr(0, 8), std::string("\x93NUMPY\x01\x00", 8));
+    EXPECT_EQ(static_cast<size_t>(static_cast<uint8_t>(header[8]) | (static_cast<uint8_t>(header[9]) << 8)),
+              header.size() - 10);
+    EXPECT_NE(header.find("{'descr': '|i1', 'fortran_order': False, 'shape': (3, 50), }"), std::string::npos);
+    EXPECT_EQ(header.back(), '\n');
+}
+
+TEST(Npy, PacksMatrixRows)
+{
+    const std::vector<std::string> lines = {
+        "chr1\t100\t.\tA\tG\t.\tPASS\t.\tGT\t0|0\t0|1\t1|1\t./.\t1",
+        "chr1\t200\t.\tA\tG,T\t.\tPASS\t.\tGT:DP\t2|1:3\t0/0:1\t1|.:2\t0|0:4\t0:5",
+        "chr1\t300\t.\tC\tT\t.\tPASS\t.\tGT\t1|0\t0|0\t0|0\t0|0\t0",
+    };
+    const uint32_t n = 5;
+    EncodedBlock encoded = encodeBlock(lines, n, BlockParams());
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+
+    std::vector<uint8_t> dosage(3 * n);
+    RenderOptions all;
+    ASSERT_EQ(packBlockMatrix(view, n, all, MatrixKind::Dosage, dosage.data()), 3u);
+    const std::vector<int8_t> expected = {0, 1, 2, -1, 1, 2, 0, -1, 0, 0, 1, 0, 0, 0, 0};
+    EXPECT_EQ(std::vector<int8_t>(dosage.begin(), dosage.end()), expected);
+
+    // 第 200..300 行，样本 2 与 4：每行 4 个单倍型位
+    const std::vector<PositionRange> ranges = {{150, 400}};
+    const std::vector<uint32_t> samples = {2, 4};
+    RenderOptions subset;
+    subset.ranges = &ranges;
+    subset.samples = &samples;
+    std::vector<uint8_t> bits(2 * matrixRowBytes(MatrixKind::HaplotypeBits, samples.size()));
+    ASSERT_EQ(packBlockMatrix(view, n, subset, MatrixKind::HaplotypeBits, bits.data()), 2u);
+    EXPECT_EQ(bits, (std::vector<uint8_t>{0x80, 0x00}));
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::vector<uint8_t> codes(const PlinkRows &rows, size_t row, uint32_t nSamples)
+    {
+        const size_t rowBytes = (nSamples + 3) / 4;
+        std::vector<uint8_t> out;
+        for (uint32_t s = 0; s < nSamples; ++s)
+        {
+            out.push_back((rows.bed[row * rowBytes + s / 4] >> (2 * (s % 4))) & 3);
+        }
+        return out;
+    }
+}
+
+TEST(Plink, PacksBitPlanesDirectly)
+{
+    const std::vector<std::string> lines = {
+        "chr1\t100\trs1\tA\tG\t.\tPASS\t.\tGT\t0|0\t0|1\t1|0\t1|1\t./.\t1\t0\t0/1\t1|1",
+        "chr1\t200\trs2\tA\tG,T\t.\tPASS\t.\tGT\t0|2\t0|1\t1|0\t1|1\t0|0\t1\t0\t0/1\t1|1",
+        "chr1\t300\t.\tC\tT\t.\tPASS\t.\tGT:DP\t1|1:3\t.|1:4\t0:5\t0|0:6\t1/0:7\t0|0:8\t0|0:9\t0|0:1\t0|0:2",
+        "chr1\t400\t.\tC\t.\t.\tPASS\t.\tGT\t0/0\t0/0\t0/0\t0/0\t0/0\t0/0\t0/0\t0/0\t0/0",
+    };
+    const uint32_t n = 9;
+    const std::vector<uint8_t> row0 = {kPlinkHomRef, kPlinkHet, kPlinkHet, kPlinkHomAlt, kPlinkMissing,
+                                       kPlinkHomAlt, kPlinkHomRef, kPlinkHet, kPlinkHomAlt};
+    const std::vector<uint8_t> row1 = {kPlinkHomAlt, kPlinkMissing, kPlinkHomRef, kPlinkHomRef, kPlinkHet,
+                                       kPlinkHomRef, kPlinkHomRef, kPlinkHomRef, kPlinkHomRef};
+
+    for (GenotypeLayout layout : {GenotypeLayout::VariantMajor, GenotypeLayout::SampleMajor})
+    {
+        for (uint32_t groupSize : {kDefaultSampleGroupSize, 3u, 4u})
+        {
+            BlockParams params;
+            params.gtLayout = layout;
+            params.sampleGroupSize = groupSize;
+            EncodedBlock encoded = encodeBlock(lines, n, params);
+            PlinkRows rows;
+            packBlockPlink(BlockView(encoded.bytes.data(), encoded.bytes.size()), "chr1", n, rows);
+            EXPECT_EQ(rows.variants, 3u);
+            EXPECT_EQ(rows.skipped, 1u);
+            EXPECT_EQ(rows.bim, "chr1\trs1\t0\t100\tG\tA\n"
+                                "chr1\t.\t0\t300\tT\tC\n"
+                                "chr1\t.\t0\t400\t0\tC\n");
+            ASSERT_EQ(rows.bed.size(), 9u);
+            EXPECT_EQ(codes(rows, 0, n), row0);
+            EXPECT_EQ(codes(rows, 1, n), row1);
+            EXPECT_EQ(codes(rows, 2, n), std::vector<uint8_t>(n, kPlinkHomRef));
+            // 末字节中第 9 个样本之后的位为 0
+            EXPECT_EQ(rows.bed[2] & 0xFC, 0);
+        }
+    }
+}
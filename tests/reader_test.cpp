@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/region.hpp"
+#include "test_util.hpp"
+
+#include <fstream>
+#include <oneapi/tbb/parallel_for.h>
+#include <string>
+#include <vector>
+
+TEST(GscReader, LazyConcurrentQueries)
+{
+    const TempFile file("reader_test.gsc");
+    const VcfHeader header = testHeader({"S1", "S2", "S3"});
+    std::vector<std::string> all;
+    std::vector<std::vector<std::string>> blocks;
+    for (const char *chrom : {"chr1", "chr2"})
+    {
+        for (int b = 0; b < 4; ++b)
+        {
+            std::vector<std::string> lines;
+            for (int r = 0; r < 25; ++r)
+            {
+                int pos = b * 500 + r * 20 + 1;
+                lines.push_back(std::string(chrom) + "\t" + std::to_string(pos) + "\trs" + std::to_string(pos) +
+                                "\tG\tA\t30\tPASS\tAC=1\tGT\t0|1\t0|0\t1|" + std::to_string(r % 2));
+            }
+            all.insert(all.end(), lines.begin(), lines.end());
+            blocks.push_back(std::move(lines));
+        }
+    }
+    writeTestArchive(file.path, header, blocks);
+
+    {
+        GscReader reader(file.path);
+        EXPECT_EQ(reader.blockCount(), 8u);
+        GscReader copy = reader;
+        EXPECT_EQ(copy.samples(), header.samples);
+
+        // 多个线程同时首次访问并查询，与逐行筛选的结果一致
+        const std::vector<std::string> regions = {"chr1:400-1100", "chr2:1-30", "chr2:1981-5000", "chr1"};
+        std::vector<std::string> got(regions.size() * 8);
+        tbb::parallel_for(size_t(0), got.size(),
+                          [&](size_t i)
+                          {
+                              const GscReader &r = i % 2 ? copy : reader;
+                              r.query(parseRegion(regions[i % regions.size()]), nullptr, got[i]);
+                          });
+        for (size_t i = 0; i < got.size(); ++i)
+        {
+            GenomicRegion region = parseRegion(regions[i % regions.size()]);
+            std::string expected;
+            for (const auto &line : all)
+            {
+                VcfRecord rec;
+                ASSERT_TRUE(parseVcfRecord(line, 3, rec));
+                int64_t pos = parsePos(rec.pos);
+                if (rec.chrom == region.chrom && pos >= region.start && pos <= region.end)
+                {
+                    expected += line + "\n";
+                }
+            }
+            EXPECT_EQ(got[i], expected) << regions[i % regions.size()];
+        }
+
+        const std::vector<uint32_t> subset = {2};
+        std::string text;
+        reader.query(parseRegion("chr2:1-1"), &subset, text);
+        EXPECT_EQ(text, "chr2\t1\trs1\tG\tA\t30\tPASS\tAC=1\tGT\t1|0\n");
+    }
+}
+
+TEST(GscReader, PartialReadVerifiesLoadedStreams)
+{
+    const TempFile file("reader_sites_test.gsc");
+    const std::string &path = file.path;
+    writeTestArchive(path, testHeader({"S1", "S2"}), {{"chr1\t5\t.\tA\tC\t1\tPASS\t.\tGT\t0|1\t1|1"}});
+    // 分别改写 GT 流与 REF 流中的一个字节
+    auto patch = [&](StreamId id)
+    {
+        uint64_t at = 0;
+        {
+            GscReader reader(path);
+            const BlockView view = reader.block(0, BlockPart::Partial);
+            const SegmentView segment = view.segment(0);
+            for (const StreamEntry &e : segment.streams())
+            {
+                if (e.id == static_cast<uint32_t>(id))
+                {
+                    at = reader.index().blocks[0].offset + view.segments()[0].offset + e.offset;
+                }
+            }
+        }
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(static_cast<std::streamoff>(at));
+        char c = static_cast<char>(file.get() ^ 1);
+        file.seekp(static_cast<std::streamoff>(at));
+        file.put(c);
+    };
+
+    patch(StreamId::Genotype);
+    {
+        GscReader reader(path);
+        EXPECT_THROW(reader.block(0), std::runtime_error);
+        const BlockView view = reader.block(0, BlockPart::Partial);
+        EXPECT_NO_THROW(view.segment(0).load(StreamId::Ref));
+        EXPECT_THROW(view.segment(0).load(StreamId::Genotype), std::runtime_error);
+        // 样本子集同样要加载 GT 流，损坏仍被发现
+        const std::vector<uint32_t> subset = {0};
+        std::string text;
+        EXPECT_THROW(reader.query(parseRegion("chr1"), &subset, text), std::runtime_error);
+    }
+    patch(StreamId::Ref);
+    {
+        GscReader reader(path);
+        const BlockView view = reader.block(0, BlockPart::Partial);
+        EXPECT_THROW(view.segment(0).load(StreamId::Ref), std::runtime_error);
+    }
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+#include "../src/region.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::string renderRange(const BlockView &view, int64_t start, int64_t end)
+    {
+        const std::vector<PositionRange> ranges = {{start, end}};
+        RenderOptions options;
+        options.ranges = &ranges;
+        std::string text;
+        renderBlockVcf(view, "chr1", 2, options, text);
+        return text;
+    }
+}
+
+TEST(Region, Parse)
+{
+    GenomicRegion r = parseRegion("chr20:1000-2000");
+    EXPECT_EQ(r.chrom, "chr20");
+    EXPECT_EQ(r.start, 1000);
+    EXPECT_EQ(r.end, 2000);
+    r = parseRegion("chrX");
+    EXPECT_EQ(r.start, 1);
+    EXPECT_EQ(r.end, INT64_MAX);
+    r = parseRegion("2:500");
+    EXPECT_EQ(r.start, 500);
+    EXPECT_EQ(r.end, 500);
+    r = parseRegion("2:500-");
+    EXPECT_EQ(r.end, INT64_MAX);
+    EXPECT_EQ(parseRegion("HLA-A*01:01N").chrom, "HLA-A*01:01N");
+    EXPECT_THROW(parseRegion("chr1:20-10"), std::runtime_error);
+}
+
+TEST(Region, OverlappingBlocks)
+{
+    GscIndex index;
+    index.chroms = {"chr1", "chr2"};
+    // chr1 第二块含一条跨到 450 的长缺失
+    index.blocks = {
+        {0, 0, 0, 10, 0, 1, 100},
+        {0, 0, 0, 10, 0, 101, 450},
+        {0, 0, 0, 10, 0, 201, 300},
+        {0, 0, 0, 10, 0, 301, 400},
+        {0, 0, 0, 10, 1, 1, 1000},
+    };
+    RegionIndex regions(index);
+    EXPECT_EQ(regions.blocksFor(parseRegion("chr1:150-160")), (std::vector<size_t>{1}));
+    EXPECT_EQ(regions.blocksFor(parseRegion("chr1:420-500")), (std::vector<size_t>{1}));
+    EXPECT_EQ(regions.blocksFor(parseRegion("chr1:100-301")), (std::vector<size_t>{0, 1, 2, 3}));
+    EXPECT_EQ(regions.blocksFor(parseRegion("chr1:451-900")), (std::vector<size_t>{}));
+    EXPECT_EQ(regions.blocksFor(parseRegion("chr2")), (std::vector<size_t>{4}));
+    EXPECT_TRUE(regions.blocksFor(parseRegion("chr3")).empty());
+}
+
+TEST(Region, EdgeRecordsAreTrimmed)
+{
+    const std::vector<std::string> lines = {
+        "chr1\t100\t.\tACGTACGT\tA\t.\tPASS\t.\tGT:DP\t0|1:5\t1|1:7",
+        "chr1\t110\t.\tC\tT\t.\tPASS\t.\tGT:DP\t0|0:3\t0|1",
+        "chr1\t120\t.\tG\t<NON_REF>\t.\t.\tEND=150\tGT:DP\t0/0:9\t0/0:8",
+        "chr1\t200\t.\tT\tA\t.\tPASS\t.\tGT:DP\t1|0:2:x\t0|0:1",
+    };
+    BlockParams params;
+    EncodedBlock encoded = encodeBlock(lines, 2, params);
+    EXPECT_EQ(encoded.maxPos, 200);
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+
+    // 107 落在第一行 REF 覆盖范围内，140 落在参考块内
+    EXPECT_EQ(renderRange(view, 107, 140), lines[0] + "\n" + lines[1] + "\n" + lines[2] + "\n");
+
+    // 跳过带字段数例外的行后，后续行仍正确还原
+    EXPECT_EQ(renderRange(view, 200, 200), lines[3] + "\n");
+    EXPECT_EQ(renderRange(view, 108, 115), lines[1] + "\n");
+}
+
+TEST(Region, BedIntervalsAreMergedInFileOrder)
+{
+    const std::string path = "region_test.bed";
+    {
+        std::ofstream bed(path);
+        bed << "track name=test\n# comment\nchr2\t0\t10\nchr1\t199\t300\nchr1\t99\t150\nchr1\t150\t160\n"
+            << "chrUn\t0\t5\nchr1\t299\t400\r\n";
+    }
+    std::vector<GenomicRegion> bed = readBedFile(path);
+    std::remove(path.c_str());
+    ASSERT_EQ(bed.size(), 6u);
+    EXPECT_EQ(bed[1].start, 200);
+    EXPECT_EQ(bed[1].end, 300);
+
+    GscIndex index;
+    index.chroms = {"chr1", "chr2"};
+    index.blocks = {{0, 0, 0, 1, 0, 1, 500}, {0, 0, 0, 1, 1, 1, 500}};
+    std::vector<GenomicRegion> merged = RegionIndex(index).merge(bed);
+    ASSERT_EQ(merged.size(), 3u);
+    EXPECT_EQ(merged[0].chrom, "chr1");
+    EXPECT_EQ(merged[0].start, 100);
+    EXPECT_EQ(merged[0].end, 160);
+    EXPECT_EQ(merged[1].start, 200);
+    EXPECT_EQ(merged[1].end, 400);
+    EXPECT_EQ(merged[2].chrom, "chr2");
+}
+
+TEST(Region, OverlapsAnyRange)
+{
+    const std::vector<PositionRange> ranges = {{10, 20}, {30, 40}, {100, 100}};
+    EXPECT_TRUE(overlapsAny(ranges, 5, 10));
+    EXPECT_FALSE(overlapsAny(ranges, 21, 29));
+    EXPECT_TRUE(overlapsAny(ranges, 25, 31));
+    EXPECT_TRUE(overlapsAny(ranges, 100, 100));
+    EXPECT_FALSE(overlapsAny(ranges, 101, 200));
+}
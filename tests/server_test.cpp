@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/server.hpp"
+#include "test_util.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    // 连接 serve() 线程刚开始监听的套接字，尚未就绪时重试
+    std::unique_ptr<GscClient> connectClient(const std::string &socketPath)
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            try
+            {
+                return std::make_unique<GscClient>(socketPath);
+            }
+            catch (const std::runtime_error &)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+        return nullptr;
+    }
+
+    // 不经 GscClient 的原始连接，用来发送不完整的帧
+    int connectRaw(const std::string &socketPath)
+    {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+        return fd;
+    }
+}
+
+TEST(GscServer, RequestRoundTrip)
+{
+    ServeRequest request;
+    request.file = "a.gsc";
+    request.view.regions = {"chr1:1-100", "chr2"};
+    request.view.samples = {"S2"};
+    request.view.sampleSubset = true;
+    request.view.where = "QUAL>10";
+    request.view.header = false;
+    request.view.dropGenotypes = true;
+    std::vector<uint8_t> bytes = encodeServeRequest(request);
+    ServeRequest back = decodeServeRequest(bytes.data(), bytes.size());
+    EXPECT_EQ(back.op, ServeOp::Query);
+    EXPECT_EQ(back.file, "a.gsc");
+    EXPECT_EQ(back.view.regions, request.view.regions);
+    EXPECT_EQ(back.view.samples, request.view.samples);
+    EXPECT_TRUE(back.view.sampleSubset);
+    EXPECT_EQ(back.view.where, "QUAL>10");
+    EXPECT_FALSE(back.view.header);
+    EXPECT_TRUE(back.view.dropGenotypes);
+
+    bytes.push_back(0);
+    EXPECT_THROW(decodeServeRequest(bytes.data(), bytes.size()), std::runtime_error);
+}
+
+TEST(GscServer, AnswersOverSocket)
+{
+    const TempFile file("server_test.gsc");
+    const TempFile bigFile("server_test_big.gsc");
+    const TempFile socketFile("server_test.sock");
+    const std::string &path = file.path;
+    const std::string &bigPath = bigFile.path;
+    const std::string &socketPath = socketFile.path;
+    const VcfHeader header = testHeader({"S1", "S2"});
+    std::vector<std::string> lines;
+    for (int r = 0; r < 40; ++r)
+    {
+        lines.push_back("chr1\t" + std::to_string(100 + r * 10) + "\t.\tC\tT\t" + std::to_string(r) +
+                        "\tPASS\tAF=0.1\tGT\t0|1\t1|" + std::to_string(r % 2));
+    }
+    writeTestArchive(path, header, {lines});
+    // 应答超过 kServeChunk，分多帧发送
+    std::string bigText;
+    std::vector<std::vector<std::string>> big(1);
+    for (int r = 0; r < 40000; ++r)
+    {
+        if (big.back().size() == 8192)
+        {
+            big.emplace_back();
+        }
+        big.back().push_back("chr2\t" + std::to_string(r + 1) + "\t.\tG\tA\t50\tPASS\tAF=0.5\tGT\t0|1\t1|" +
+                             std::to_string(r % 2));
+        bigText += big.back().back() + "\n";
+    }
+    writeTestArchive(bigPath, header, big);
+    ASSERT_GT(bigText.size(), kServeChunk);
+
+    {
+        GscServer server({path, bigPath}, 1 << 20);
+        std::thread serving([&] { server.serve(socketPath); });
+        std::unique_ptr<GscClient> client = connectClient(socketPath);
+        ASSERT_TRUE(client);
+
+        ServeRequest query;
+        query.file = path;
+        query.view.regions = {"chr1:150-180"};
+        query.view.samples = {"S2"};
+        query.view.sampleSubset = true;
+        query.view.header = false;
+        EXPECT_EQ(client->request(query), "chr1\t150\t.\tC\tT\t5\tPASS\tAF=0.1\tGT\t1|1\n"
+                                          "chr1\t160\t.\tC\tT\t6\tPASS\tAF=0.1\tGT\t1|0\n"
+                                          "chr1\t170\t.\tC\tT\t7\tPASS\tAF=0.1\tGT\t1|1\n"
+                                          "chr1\t180\t.\tC\tT\t8\tPASS\tAF=0.1\tGT\t1|0\n");
+        // 同一连接上的第二个请求命中缓存
+        query.view.where = "QUAL>=7";
+        EXPECT_EQ(client->request(query), "chr1\t170\t.\tC\tT\t7\tPASS\tAF=0.1\tGT\t1|1\n"
+                                          "chr1\t180\t.\tC\tT\t8\tPASS\tAF=0.1\tGT\t1|0\n");
+
+        ServeRequest samples;
+        samples.op = ServeOp::Samples;
+        samples.file = path;
+        EXPECT_EQ(client->request(samples), "S1\nS2\n");
+
+        ServeRequest stats;
+        stats.op = ServeOp::Stats;
+        stats.file = path;
+        EXPECT_NE(client->request(stats).find("records\t40\n"), std::string::npos);
+
+        stats.file = "missing.gsc";
+        EXPECT_THROW(client->request(stats), std::runtime_error);
+
+        ServeRequest all;
+        all.file = bigPath;
+        all.view.header = false;
+        EXPECT_EQ(client->request(all), bigText);
+        // 出错后同一连接仍可继续请求
+        all.view.where = "QUAL>=";
+        EXPECT_THROW(client->request(all), std::runtime_error);
+        EXPECT_EQ(client->request(samples), "S1\nS2\n");
+
+        server.stop();
+        serving.join();
+    }
+}
+
+TEST(GscServer, SurvivesClientDisconnectMidFrame)
+{
+    const TempFile file("server_test_big.gsc");
+    const TempFile socketFile("server_test.sock");
+    const VcfHeader header = testHeader({"S1", "S2"});
+    std::vector<std::vector<std::string>> blocks(1);
+    for (int r = 0; r < 40000; ++r)
+    {
+        if (blocks.back().size() == 8192)
+        {
+            blocks.emplace_back();
+        }
+        blocks.back().push_back("chr2\t" + std::to_string(r + 1) + "\t.\tG\tA\t50\tPASS\tAF=0.5\tGT\t0|1\t1|0");
+    }
+    writeTestArchive(file.path, header, blocks);
+
+    GscServer server({file.path}, 1 << 20);
+    std::thread serving([&] { server.serve(socketFile.path); });
+    std::unique_ptr<GscClient> client = connectClient(socketFile.path);
+    ASSERT_TRUE(client);
+
+    ServeRequest query;
+    query.file = file.path;
+    query.view.header = false;
+    const std::vector<uint8_t> payload = encodeServeRequest(query);
+    const uint32_t size = static_cast<uint32_t>(payload.size());
+    const uint8_t length[4] = {static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+                               static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 24)};
+
+    // 请求帧只发了一半就断开：服务端读帧失败后结束该连接
+    int fd = connectRaw(socketFile.path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, length, sizeof(length)), static_cast<ssize_t>(sizeof(length)));
+    ASSERT_EQ(::write(fd, payload.data(), payload.size() / 2), static_cast<ssize_t>(payload.size() / 2));
+    ::close(fd);
+
+    // 应答的第一帧未读完就断开：服务端发送失败（EPIPE，不产生 SIGPIPE）后中止查询
+    fd = connectRaw(socketFile.path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(::write(fd, length, sizeof(length)), static_cast<ssize_t>(sizeof(length)));
+    ASSERT_EQ(::write(fd, payload.data(), payload.size()), static_cast<ssize_t>(payload.size()));
+    uint8_t partial[64];
+    ASSERT_GT(::read(fd, partial, sizeof(partial)), 0);
+    ::close(fd);
+
+    // 已有连接与新连接都不受影响
+    ServeRequest samples;
+    samples.op = ServeOp::Samples;
+    samples.file = file.path;
+    EXPECT_EQ(client->request(samples), "S1\nS2\n");
+    EXPECT_EQ(GscClient(socketFile.path).request(samples), "S1\nS2\n");
+
+    server.stop();
+    serving.join();
+}
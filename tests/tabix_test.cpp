@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "../src/tabix.hpp"
+
+#include <cstring>
+#include <string>
+#include <zlib.h>
+
+namespace
+{
+    // 索引很小，只有一个数据 member
+    std::string inflateFirstMember(const std::string &data)
+    {
+        z_stream zs{};
+        EXPECT_EQ(inflateInit2(&zs, 15 + 16), Z_OK);
+        std::string out(1 << 16, '\0');
+        zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        zs.avail_in = static_cast<uInt>(data.size());
+        zs.next_out = reinterpret_cast<Bytef *>(&out[0]);
+        zs.avail_out = static_cast<uInt>(out.size());
+        EXPECT_EQ(inflate(&zs, Z_FINISH), Z_STREAM_END);
+        out.resize(zs.total_out);
+        inflateEnd(&zs);
+        return out;
+    }
+
+    uint32_t u32At(const std::string &s, size_t at)
+    {
+        uint32_t v;
+        std::memcpy(&v, s.data() + at, 4);
+        return v;
+    }
+}
+
+TEST(Tabix, BinsAndSpans)
+{
+    EXPECT_EQ(tabixRegionBin(0, 1, kTbiDepth), 4681u);
+    EXPECT_EQ(tabixRegionBin(16384, 16385, kTbiDepth), 4682u);
+    EXPECT_EQ(tabixRegionBin(16000, 17000, kTbiDepth), 585u);
+    EXPECT_EQ(tabixRegionBin(0, kTbiMaxPos, kTbiDepth), 0u);
+    EXPECT_EQ(tabixRegionBin(0, 1, kCsiDepth), 37449u);
+
+    int64_t beg = 0;
+    int64_t end = 0;
+    ASSERT_TRUE(vcfRecordSpan("chr1\t100\t.\tACG\tA\t.\tPASS\tDP=3", beg, end));
+    EXPECT_EQ(beg, 99);
+    EXPECT_EQ(end, 102);
+    ASSERT_TRUE(vcfRecordSpan("chr1\t100\t.\tA\t<NON_REF>\t.\t.\tEND=250;DP=1\tGT\t0/0", beg, end));
+    EXPECT_EQ(end, 250);
+    EXPECT_FALSE(vcfRecordSpan("chr1\t100", beg, end));
+}
+
+TEST(Tabix, WritesTbiLayout)
+{
+    TabixIndexBuilder builder(false);
+    builder.add("chr1", 99, 100, 0x10000, 0x10020);
+    builder.add("chr1", 40000, 40001, 0x10020, 0x10040);
+    builder.add("chr2", 5, 6, 0x10040, 0x10060);
+    EXPECT_THROW(builder.add("chr2", 4, 5, 0x10060, 0x10080), std::runtime_error);
+    EXPECT_THROW(builder.add("chr1", 50000, 50001, 0x10060, 0x10080), std::runtime_error);
+
+    std::string raw = inflateFirstMember(builder.finish());
+    ASSERT_GE(raw.size(), 40u);
+    EXPECT_EQ(raw.substr(0, 4), std::string("TBI\1", 4));
+    EXPECT_EQ(u32At(raw, 4), 2u);  // 染色体数
+    EXPECT_EQ(u32At(raw, 8), 2u);  // TBX_VCF
+    EXPECT_EQ(u32At(raw, 24), static_cast<uint32_t>('#'));
+    EXPECT_EQ(u32At(raw, 32), 10u); // "chr1\0chr2\0"
+    EXPECT_EQ(raw.substr(36, 10), std::string("chr1\0chr2\0", 10));
+    // chr1：两个箱 + 伪箱
+    EXPECT_EQ(u32At(raw, 46), 3u);
+    EXPECT_EQ(u32At(raw, 50), 4681u);
+
+    TabixIndexBuilder csi(true);
+    csi.add("chr1", kTbiMaxPos + 10, kTbiMaxPos + 11, 0, 0x20);
+    raw = inflateFirstMember(csi.finish());
+    EXPECT_EQ(raw.substr(0, 4), std::string("CSI\1", 4));
+    EXPECT_EQ(u32At(raw, 8), static_cast<uint32_t>(kCsiDepth));
+
+    TabixIndexBuilder tbi(false);
+    EXPECT_THROW(tbi.add("chr1", kTbiMaxPos, kTbiMaxPos + 1, 0, 0x20), std::runtime_error);
+}
@@ -2,7 +2,7 @@
 
 #include "../src/mmap.hpp"
 
-int main()
+int main(int argc, char **argv)
 {
     int rc = testMmap();
     if (rc != 0)
@@ -11,7 +11,10 @@ int main()
         return EXIT_FAILURE;
     }
     std::cout << "testMmap OK\n";
-    return EXIT_SUCCESS;
+
+    // 其余 tests/*.cpp 中的 gtest 用例
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
 }
 
 // // 基本示例测试
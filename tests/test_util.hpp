@@ -0,0 +1,60 @@
+#pragma once
+
+#include "../src/archive.hpp"
+#include "../src/vcf.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// 测试用的临时文件：放在系统临时目录下，文件名带进程号与序号，并行运行的测试互不覆盖；析构时删除
+class TempFile
+{
+public:
+    explicit TempFile(const std::string &name)
+        : path((std::filesystem::temp_directory_path() /
+                ("gsc_" + std::to_string(::getpid()) + "_" + std::to_string(counter++) + "_" + name))
+                   .string())
+    {
+    }
+    ~TempFile() { std::remove(path.c_str()); }
+
+    TempFile(const TempFile &) = delete;
+    TempFile &operator=(const TempFile &) = delete;
+
+    const std::string path;
+
+private:
+    static inline std::atomic<uint32_t> counter{0};
+};
+
+// 列行与样本名一致的头部
+inline VcfHeader testHeader(const std::vector<std::string> &samples,
+                            const std::vector<std::string> &metaLines = {"##fileformat=VCFv4.2"})
+{
+    VcfHeader header;
+    header.metaLines = metaLines;
+    header.columnLine = "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT";
+    for (const std::string &s : samples)
+    {
+        header.columnLine += "\t" + s;
+    }
+    header.samples = samples;
+    return header;
+}
+
+// blocks 中每组行编码为一块，依次写入 path
+inline void writeTestArchive(const std::string &path, const VcfHeader &header,
+                             const std::vector<std::vector<std::string>> &blocks,
+                             const BlockParams &params = BlockParams())
+{
+    GscWriter writer(path, header, CodecParams());
+    for (const auto &lines : blocks)
+    {
+        writer.writeBlock(encodeBlock(lines, static_cast<uint32_t>(header.samples.size()), params));
+    }
+    writer.close();
+}
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "../src/archive.hpp"
+#include "../src/region.hpp"
+#include "../src/transcode.hpp"
+#include "test_util.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(Codec, StreamRoundTrip)
+{
+    std::string text;
+    for (int i = 0; i < 500; ++i)
+    {
+        text += "AC=" + std::to_string(i % 7) + ";AF=0." + std::to_string(i % 13) + "\n";
+    }
+    const auto *data = reinterpret_cast<const uint8_t *>(text.data());
+    for (Codec codec : {Codec::Store, Codec::Brotli, Codec::Bsc, Codec::Zlib})
+    {
+        EXPECT_EQ(parseCodec(codecName(codec)), codec);
+        CodecParams params;
+        params.codec = codec;
+        Codec used = Codec::Store;
+        std::vector<uint8_t> packed = compressStream(params, data, text.size(), used);
+        EXPECT_EQ(used, codec);
+        std::vector<uint8_t> raw = decompressStream(used, packed.data(), packed.size(), text.size());
+        EXPECT_EQ(std::string(raw.begin(), raw.end()), text);
+        // 很短的流直接存储
+        compressStream(params, data, 10, used);
+        EXPECT_EQ(used, Codec::Store);
+    }
+    EXPECT_THROW(parseCodec("zstd"), std::runtime_error);
+}
+
+TEST(Transcode, KeepsIndexAndRecords)
+{
+    const TempFile inputFile("transcode_in.gsc");
+    const std::string &input = inputFile.path;
+    std::vector<std::vector<std::string>> blocks;
+    for (const char *chrom : {"chr1", "chr2"})
+    {
+        for (int b = 0; b < 3; ++b)
+        {
+            std::vector<std::string> lines;
+            for (int r = 0; r < 40; ++r)
+            {
+                int pos = b * 1000 + r * 20 + 1;
+                lines.push_back(std::string(chrom) + "\t" + std::to_string(pos) + "\trs" + std::to_string(pos) +
+                                "\tG\tA\t" + std::to_string(r) + "\t" + (r % 5 ? "PASS" : "q10") +
+                                "\tAC=1\tGT:DP\t0|1:" + std::to_string(r) + "\t0|0:3\t1|" + std::to_string(r % 2) +
+                                ":7");
+            }
+            blocks.push_back(std::move(lines));
+        }
+    }
+    BlockParams blockParams;
+    blockParams.collectIds = true;
+    blockParams.checkpointRows = 16;
+    blockParams.sampleGroupSize = 2;
+    writeTestArchive(input, testHeader({"S1", "S2", "S3"}), blocks, blockParams);
+
+    const GscReader original(input);
+    std::string expected;
+    original.query(parseRegion("chr1"), nullptr, expected);
+    original.query(parseRegion("chr2"), nullptr, expected);
+    for (Codec codec : {Codec::Bsc, Codec::Zlib})
+    {
+        const TempFile outputFile(std::string("transcode_") + codecName(codec) + ".gsc");
+        const std::string &output = outputFile.path;
+        CodecParams params;
+        params.codec = codec;
+        TranscodeSummary summary = transcodeGsc(input, output, params);
+        EXPECT_EQ(summary.blocks, 6u);
+
+        const GscReader reader(output);
+        EXPECT_EQ(reader.headerText(), original.headerText());
+        ASSERT_EQ(reader.blockCount(), original.blockCount());
+        for (size_t b = 0; b < reader.blockCount(); ++b)
+        {
+            const BlockIndexEntry &a = original.index().blocks[b];
+            const BlockIndexEntry &e = reader.index().blocks[b];
+            EXPECT_EQ(e.nRows, a.nRows);
+            EXPECT_EQ(e.minPos, a.minPos);
+            EXPECT_EQ(e.maxPos, a.maxPos);
+            EXPECT_EQ(e.zone.maxQual, a.zone.maxQual);
+            EXPECT_EQ(e.zone.filterMask, a.zone.filterMask);
+            const SegmentView segment = reader.block(b).segment(1);
+            EXPECT_EQ(segment.streams().size(), original.block(b).segment(1).streams().size());
+        }
+        std::string got;
+        reader.query(parseRegion("chr1"), nullptr, got);
+        reader.query(parseRegion("chr2"), nullptr, got);
+        EXPECT_EQ(got, expected);
+        ASSERT_EQ(reader.findId("rs2021").size(), 2u);
+        EXPECT_EQ(reader.findId("rs2021")[1].block, 5u);
+        EXPECT_EQ(reader.findId("rs2021")[1].row, 1u);
+    }
+    EXPECT_THROW(transcodeGsc(input, input, CodecParams()), std::runtime_error);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+
+#include "../src/block.hpp"
+#include "../src/zone_map.hpp"
+
+#include <string>
+#include <vector>
+
+TEST(ZoneMap, VariantTypes)
+{
+    EXPECT_EQ(variantTypeMask("A", "G"), kTypeSnp);
+    EXPECT_EQ(variantTypeMask("AC", "GT"), kTypeMnp);
+    EXPECT_EQ(variantTypeMask("A", "AT,G"), kTypeIndel | kTypeSnp);
+    EXPECT_EQ(variantTypeMask("A", "<DEL>"), kTypeOther);
+    EXPECT_EQ(variantTypeMask("A", "."), kTypeRef);
+    EXPECT_EQ(variantTypeMask("A", "<NON_REF>"), kTypeRef);
+    EXPECT_EQ(variantTypeMask("A", "G,<NON_REF>"), kTypeSnp);
+}
+
+TEST(ZoneMap, BlockSummary)
+{
+    std::vector<std::string> lines = {
+        "chr1\t100\t.\tA\tG\t50\tPASS\tAF=0.2,0.01;DP=3",
+        "chr1\t200\t.\tA\tAT\t.\tq10;LowQual\tDP=4",
+        "chr1\t300\t.\tC\tT\t12.5\tPASS\tAF=.",
+    };
+    EncodedBlock block = encodeBlock(lines, 0, BlockParams());
+    EXPECT_DOUBLE_EQ(block.zone.minQual, 12.5);
+    EXPECT_DOUBLE_EQ(block.zone.maxQual, 50);
+    EXPECT_DOUBLE_EQ(block.zone.minAf, 0.01);
+    EXPECT_DOUBLE_EQ(block.zone.maxAf, 0.2);
+    EXPECT_EQ(block.zone.typeMask, kTypeSnp | kTypeIndel);
+    EXPECT_EQ(block.filters, (std::vector<std::string>{"PASS", "q10", "LowQual"}));
+}
+
+TEST(ZoneMap, WhereSkipsBlocksAndRows)
+{
+    const std::vector<std::string> filters = {"PASS", "LowQual"};
+    ZoneMap zone;
+    zone.add({"A", "G", "30", "PASS", "AF=0.005"}, kTypeSnp);
+    zone.add({"A", "G", "60", "PASS", "AF=0.2"}, kTypeSnp);
+    zone.filterMask = filterBit(0);
+
+    EXPECT_TRUE(WhereFilter::parse("FILTER=PASS && AF>0.01").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("AF>0.5").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("FILTER=LowQual").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("FILTER!=PASS").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("FILTER=NoSuchFilter").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("TYPE=indel").mayMatch(zone, filters));
+    EXPECT_TRUE(WhereFilter::parse("TYPE=indel || QUAL >= 60").mayMatch(zone, filters));
+    EXPECT_FALSE(WhereFilter::parse("QUAL<10").mayMatch(ZoneMap(), filters));
+
+    WhereFilter where = WhereFilter::parse("FILTER=PASS && AF>0.01");
+    EXPECT_TRUE(where.matches({"A", "G,T", "30", "PASS", "DP=1;AF=0.001,0.3"}));
+    EXPECT_FALSE(where.matches({"A", "G", "30", "PASS", "AF=0.001"}));
+    EXPECT_FALSE(where.matches({"A", "G", "30", "q10;PASS2", "AF=0.3"}));
+    EXPECT_TRUE(WhereFilter::parse("FILTER!=PASS").matches({"A", "G", ".", "q10", "."}));
+    EXPECT_FALSE(WhereFilter::parse("QUAL!=3").matches({"A", "G", ".", "PASS", "."}));
+
+    EXPECT_THROW(WhereFilter::parse("DP>3"), std::runtime_error);
+    EXPECT_THROW(WhereFilter::parse("TYPE>snp"), std::runtime_error);
+    EXPECT_THROW(WhereFilter::parse("QUAL>abc"), std::runtime_error);
+}
+
+TEST(ZoneMap, RenderFiltersBeforeSamples)
+{
+    std::vector<std::string> lines = {
+        "chr1\t100\trs1\tA\tG\t50\tPASS\tAF=0.2\tGT\t0|1\t1|1",
+        "chr1\t200\trs2\tA\tAT\t5\tLowQual\tAF=0.4\tGT\t0|0\t0|1",
+        "chr1\t300\trs3\tC\tT\t80\tPASS\tAF=0.001\tGT\t1|0\t0|0",
+    };
+    EncodedBlock encoded = encodeBlock(lines, 2, BlockParams());
+    BlockView view(encoded.bytes.data(), encoded.bytes.size());
+    WhereFilter where = WhereFilter::parse("FILTER=PASS && AF>0.01");
+    RenderOptions options;
+    options.where = &where;
+    std::string out;
+    renderBlockVcf(view, "chr1", 2, options, out);
+    EXPECT_EQ(out, lines[0] + "\n");
+
+    out.clear();
+    WhereFilter none = WhereFilter::parse("QUAL>1000");
+    options.where = &none;
+    renderBlockVcf(view, "chr1", 2, options, out);
+    EXPECT_TRUE(out.empty());
+}